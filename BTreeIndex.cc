@@ -9,9 +9,38 @@
  
 #include "BTreeIndex.h"
 #include "BTreeNode.h"
+#include <algorithm>
+#include <climits>
 
 using namespace std;
 
+// a (key, RecordId) entry of a leaf
+typedef pair<int, RecordId> LeafEntry;
+
+// the state of a merge
+struct BTreeIndex::MergeState {
+	vector<PageId>    leaves;     // the leaves of the old tree in key order
+	vector<int>       seps;       // the separator key before every leaf. seps[0] is unused
+	vector<PageId>    freePids;   // the non-leaf nodes of the old tree
+	PageId            nextPid;    // the first page past the end of the file
+
+	vector<PageId>    newLeaves;  // the leaves of the new tree in key order
+	vector<int>       newSeps;    // the separator key before every new leaf
+	unsigned          copied;     // # old leaves moved to the new tree
+
+	int               leaf;       // the old leaf being merged into, or -1
+	vector<LeafEntry> old;        // the entries of that leaf
+	unsigned          nextOld;    // its first entry not added yet
+	PageId            oldNext;    // the leaf after it
+
+	vector<LeafEntry> out;        // the entries of the leaf being filled
+	PageId            outPid;     // the page of the leaf being filled
+};
+
+// write entries [first, last) to a new leaf at page pid
+static RC writeLeaf(PageFile& pf, PageId pid, const vector<LeafEntry>& entries,
+                    unsigned first, unsigned last, PageId next);
+
 /*
  * BTreeIndex constructor
  */
@@ -19,6 +48,7 @@ BTreeIndex::BTreeIndex()
 {
     rootPid = 1;    //initial root stored in pid 1
     treeHeight = 1;
+    mode = 'r';
 }
 
 /*
@@ -35,6 +65,7 @@ RC BTreeIndex::open(const string& indexname, char mode)
 	if ((rc = pf.open(indexname,mode))<0){
 		return rc;
 	}
+	this->mode = mode;
 	//the index is empty, initialize a empty root.
 	if(pf.endPid()<=0){
 		BTLeafNode lNode;
@@ -45,7 +76,7 @@ RC BTreeIndex::open(const string& indexname, char mode)
 	// index already exists.
 	// read rootPid, treeHeight from PID 0
 	else{
-		char *buf = new char[PageFile::PAGE_SIZE];
+		char buf[PageFile::PAGE_SIZE];
 		if ((rc = pf.read(0,buf))<0)
 			return rc;
 		memcpy(&rootPid,buf,sizeof(PageId));
@@ -60,13 +91,18 @@ RC BTreeIndex::open(const string& indexname, char mode)
  */
 RC BTreeIndex::close()
 {
-	//write rootPid, treeHeight back into Pid 0
+	//write rootPid, treeHeight back into Pid 0.
+	//an index opened for reading is left as it is.
 	RC rc;
-	char *buf = new char[PageFile::PAGE_SIZE];
-    memcpy(buf,&rootPid,sizeof(PageId));
-    memcpy(buf+sizeof(PageId),&treeHeight,sizeof(int));
-    if ((rc = pf.write(0,buf))<0)
-		return rc;
+	if (mode == 'w') {
+		char buf[PageFile::PAGE_SIZE];
+		memcpy(buf,&rootPid,sizeof(PageId));
+		memcpy(buf+sizeof(PageId),&treeHeight,sizeof(int));
+		if ((rc = pf.write(0,buf))<0) {
+			pf.close();
+			return rc;
+		}
+	}
 	if ((rc = pf.close())<0)
 		return rc;
     return 0;
@@ -202,13 +238,17 @@ RC BTreeIndex::locate(int searchKey, IndexCursor& cursor)
 	RC rc;
 	int eid=0;
 	//cout<<" treeHEIGHT: "<<treeHeight<<" rootPid: "<<rootPid<<endl;
+	//the entries with searchKey may start left of a separator equal to it,
+	//so the search follows the child left of such a separator. if the
+	//entries start in the next leaf, readForward() moves on to them.
+	int childKey = (searchKey == INT_MIN) ? INT_MIN : searchKey - 1;
 	for (int i = 0; i < treeHeight-1; ++i)
 	{	//cout<<"in the for"<<endl;
 		if((rc=nlNode.read(pid,pf))<0){
 		//	cout<<"return 1"<<endl;
 			return rc;
 		}
-		if ((rc=nlNode.locateChildPtr(searchKey,pid))<0){
+		if ((rc=nlNode.locateChildPtr(childKey,pid))<0){
 		//	cout<<"return 2"<<endl;
 			return rc;
 		}
@@ -260,3 +300,337 @@ RC BTreeIndex::readForward(IndexCursor& cursor, int& key, RecordId& rid)
 	cursor.eid++;
     return 0;
 }
+
+/*
+ * Find the last index entry whose key is not larger than searchKey.
+ * The search descends to the leaf where searchKey would be inserted.
+ * @param searchKey[IN] the largest key to find
+ * @param key[OUT] the key of the entry found
+ * @param rid[OUT] the RecordId of the entry found
+ * @return 0 if found. RC_NO_SUCH_RECORD if that leaf has no such entry
+ */
+RC BTreeIndex::locateLast(int searchKey, int& key, RecordId& rid)
+{
+	PageId pid = rootPid;
+	BTNonLeafNode nlNode;
+	BTLeafNode lNode;
+	RC rc;
+
+	for (int i = 0; i < treeHeight-1; ++i)
+	{
+		if ((rc=nlNode.read(pid,pf))<0)
+			return rc;
+		if ((rc=nlNode.locateChildPtr(searchKey,pid))<0)
+			return rc;
+	}
+	if ((rc=lNode.read(pid,pf))<0)
+		return rc;
+
+	//the entries of a leaf are sorted. keep the last one up to searchKey.
+	bool found = false;
+	for (int eid = 0; eid < lNode.getKeyCount(); eid++)
+	{
+		int ekey; RecordId erid;
+		if ((rc=lNode.readEntry(eid,ekey,erid))<0)
+			return rc;
+		if (ekey > searchKey)
+			break;
+		key = ekey;
+		rid = erid;
+		found = true;
+	}
+	return found ? 0 : RC_NO_SUCH_RECORD;
+}
+
+RC BTreeIndex::splitRange(int lo, int hi, int parts, vector<int>& bounds)
+{
+	BTNonLeafNode nlNode;
+	RC rc;
+
+	bounds.clear();
+
+	// walk the non-leaf levels top down through the nodes overlapping
+	// [lo, hi], collecting their separator keys inside the range, until
+	// a level yields enough keys for the parts
+	vector<PageId> level(1, rootPid), children;
+	for (int h = 0; h < treeHeight-1 && (int) bounds.size() + 1 < parts; ++h)
+	{
+		children.clear();
+		for (unsigned n = 0; n < level.size(); n++)
+		{
+			if ((rc=nlNode.read(level[n],pf))<0)
+				return rc;
+
+			// the child holding lo, then the children right of the
+			// separator keys in (lo, hi]
+			PageId child;
+			if ((rc=nlNode.locateChildPtr(lo,child))<0)
+				return rc;
+			children.push_back(child);
+			for (int i = 0; i < nlNode.getKeyCount(); i++)
+			{
+				int ekey; PageId epid;
+				if ((rc=nlNode.readEntry(i,ekey,epid))<0)
+					return rc;
+				if (ekey <= lo)
+					continue;
+				if (ekey > hi)
+					break;
+				bounds.push_back(ekey);
+				children.push_back(epid);
+			}
+		}
+		level.swap(children);
+	}
+
+	// a key may separate the nodes of several levels. keep parts-1 of the
+	// distinct keys, evenly spread.
+	sort(bounds.begin(), bounds.end());
+	bounds.erase(unique(bounds.begin(), bounds.end()), bounds.end());
+	if ((int) bounds.size() >= parts)
+	{
+		vector<int> picked;
+		for (int p = 1; p < parts; p++)
+			picked.push_back(bounds[(long long) p * bounds.size() / parts]);
+		bounds.swap(picked);
+	}
+	return 0;
+}
+
+RC BTreeIndex::merge(ExternalSorter& entries)
+{
+	MergeState m;
+	RC rc;
+	int key, lastKey = INT_MIN;
+	string value;
+	RecordId rid;
+
+	if (mode != 'w')
+		return RC_INVALID_FILE_MODE;
+	if ((rc=entries.next(key,value))<0)
+		return (rc == RC_END_OF_TREE) ? 0 : rc;
+	if ((rc=readLevels(m))<0)
+		return rc;
+	m.copied = 0;
+	m.leaf = -1;
+
+	do
+	{
+		if (value.size() != sizeof(RecordId))
+			return RC_INVALID_FILE_FORMAT;
+		if (key < lastKey)  //the entries must come in key order
+			return RC_INVALID_ATTRIBUTE;
+		lastKey = key;
+		memcpy(&rid, value.data(), sizeof(RecordId));
+
+		//the leaf the entry goes to: the last leaf whose separator is <= key,
+		//so that the entry follows every entry with its key. locate() instead
+		//descends to the first leaf that may hold the key, and reads forward.
+		int i = upper_bound(m.seps.begin()+1, m.seps.end(), key) - (m.seps.begin()+1);
+		if (i != m.leaf)
+		{
+			if ((rc=closeLeaf(m))<0 || (rc=openLeaf(m,i))<0)
+				return rc;
+		}
+
+		//the entries of the leaf up to the key go first
+		while (m.nextOld < m.old.size() && m.old[m.nextOld].first <= key)
+		{
+			if ((rc=emit(m,m.old[m.nextOld].first,m.old[m.nextOld].second))<0)
+				return rc;
+			m.nextOld++;
+		}
+		if ((rc=emit(m,key,rid))<0)
+			return rc;
+	} while ((rc=entries.next(key,value)) == 0);
+	if (rc != RC_END_OF_TREE)
+		return rc;
+	if ((rc=closeLeaf(m))<0)
+		return rc;
+
+	//the leaves after the last one merged into are kept as they are
+	for (; m.copied < m.leaves.size(); m.copied++)
+	{
+		m.newLeaves.push_back(m.leaves[m.copied]);
+		m.newSeps.push_back(m.seps[m.copied]);
+	}
+	return buildLevels(m);
+}
+
+RC BTreeIndex::readLevels(MergeState& m)
+{
+	BTNonLeafNode nlNode;
+	RC rc;
+
+	//walk the non-leaf levels top down, listing the children of every
+	//level in key order with the separator key before each of them
+	vector<PageId> level(1, rootPid), children;
+	vector<int> seps(1, INT_MIN), childSeps;
+	for (int h = 0; h < treeHeight-1; ++h)
+	{
+		children.clear();
+		childSeps.clear();
+		for (unsigned n = 0; n < level.size(); n++)
+		{
+			if ((rc=nlNode.read(level[n],pf))<0)
+				return rc;
+			m.freePids.push_back(level[n]);
+			children.push_back(nlNode.getFirstPtr());
+			childSeps.push_back(seps[n]);
+			for (int i = 0; i < nlNode.getKeyCount(); i++)
+			{
+				int ekey; PageId epid;
+				if ((rc=nlNode.readEntry(i,ekey,epid))<0)
+					return rc;
+				children.push_back(epid);
+				childSeps.push_back(ekey);
+			}
+		}
+		level.swap(children);
+		seps.swap(childSeps);
+	}
+	m.leaves.swap(level);
+	m.seps.swap(seps);
+	m.nextPid = pf.endPid();
+	return 0;
+}
+
+RC BTreeIndex::openLeaf(MergeState& m, int i)
+{
+	BTLeafNode lNode;
+	RC rc;
+
+	for (; m.copied < (unsigned) i; m.copied++)
+	{
+		m.newLeaves.push_back(m.leaves[m.copied]);
+		m.newSeps.push_back(m.seps[m.copied]);
+	}
+	m.copied = i + 1;
+
+	if ((rc=lNode.read(m.leaves[i],pf))<0)
+		return rc;
+	m.old.resize(lNode.getKeyCount());
+	for (int eid = 0; eid < lNode.getKeyCount(); eid++)
+	{
+		if ((rc=lNode.readEntry(eid,m.old[eid].first,m.old[eid].second))<0)
+			return rc;
+	}
+	m.nextOld = 0;
+	m.oldNext = lNode.getNextNodePtr();
+	m.leaf = i;
+
+	//the merged entries start in the old leaf, keeping its separator key
+	m.out.clear();
+	m.outPid = m.leaves[i];
+	m.newLeaves.push_back(m.outPid);
+	m.newSeps.push_back(m.seps[i]);
+	return 0;
+}
+
+RC BTreeIndex::emit(MergeState& m, int key, const RecordId& rid)
+{
+	RC rc;
+
+	if ((int) m.out.size() >= BTLeafNode::MAX_LEAF_COUNT)
+	{
+		//a run of the key at the end of the leaf moves to the next leaf,
+		//unless it fills the leaf, so that locate() finds all of the key
+		unsigned k = m.out.size();
+		while (k > 0 && m.out[k-1].first == key)
+			k--;
+		if (k == 0)
+			k = m.out.size();
+
+		PageId pid = allocate(m);
+		if ((rc=writeLeaf(pf,m.outPid,m.out,0,k,pid))<0)
+			return rc;
+		m.out.erase(m.out.begin(), m.out.begin()+k);
+		m.outPid = pid;
+		m.newLeaves.push_back(pid);
+		m.newSeps.push_back(m.out.empty() ? key : m.out[0].first);
+	}
+	m.out.push_back(make_pair(key, rid));
+	return 0;
+}
+
+RC BTreeIndex::closeLeaf(MergeState& m)
+{
+	RC rc;
+
+	if (m.leaf < 0)
+		return 0;
+	for (; m.nextOld < m.old.size(); m.nextOld++)
+	{
+		if ((rc=emit(m,m.old[m.nextOld].first,m.old[m.nextOld].second))<0)
+			return rc;
+	}
+	m.leaf = -1;
+
+	//the last leaf filled links to the leaf after the old one
+	return writeLeaf(pf,m.outPid,m.out,0,m.out.size(),m.oldNext);
+}
+
+RC BTreeIndex::buildLevels(MergeState& m)
+{
+	const int fanOut = BTNonLeafNode::MAX_NONLEAF_COUNT + 1;  //# children of a full node
+	RC rc;
+
+	//every level is built over the one below it, spreading the children
+	//evenly over as few nodes as hold them, up to a single root
+	vector<PageId> level, up;
+	vector<int> seps, upSeps;
+	level.swap(m.newLeaves);
+	seps.swap(m.newSeps);
+	int height = 1;
+	while (level.size() > 1)
+	{
+		int n = level.size();
+		int nodes = (n + fanOut - 1) / fanOut;
+		up.clear();
+		upSeps.clear();
+		for (int g = 0; g < nodes; g++)
+		{
+			int first = (long long) g * n / nodes;
+			int last = (long long) (g + 1) * n / nodes;
+			BTNonLeafNode nlNode;
+			nlNode.initializeRoot(level[first], seps[first+1], level[first+1]);
+			for (int c = first + 2; c < last; c++)
+				nlNode.append(seps[c], level[c]);
+			PageId pid = allocate(m);
+			if ((rc=nlNode.write(pid,pf))<0)
+				return rc;
+			up.push_back(pid);
+			upSeps.push_back(seps[first]);
+		}
+		level.swap(up);
+		seps.swap(upSeps);
+		height++;
+	}
+
+	//the old non-leaf nodes not reused stay unused in the file
+	rootPid = level[0];
+	treeHeight = height;
+	return 0;
+}
+
+PageId BTreeIndex::allocate(MergeState& m)
+{
+	if (!m.freePids.empty())
+	{
+		PageId pid = m.freePids.back();
+		m.freePids.pop_back();
+		return pid;
+	}
+	return m.nextPid++;
+}
+
+static RC writeLeaf(PageFile& pf, PageId pid, const vector<LeafEntry>& entries,
+                    unsigned first, unsigned last, PageId next)
+{
+	BTLeafNode lNode;
+
+	for (unsigned i = first; i < last; i++)
+		lNode.append(entries[i].first, entries[i].second);
+	lNode.setNextNodePtr(next);
+	return lNode.write(pid, pf);
+}
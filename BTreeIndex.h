@@ -13,7 +13,9 @@
 #include "Bruinbase.h"
 #include "PageFile.h"
 #include "RecordFile.h"
+#include "ExternalSorter.h"
 #include <iostream> 
+#include <vector>
 /**
  * The data structure to point to a particular entry at a b+tree leaf node.
  * An IndexCursor consists of pid (PageId of the leaf node) and 
@@ -89,9 +91,74 @@ class BTreeIndex {
    * @return error code. 0 if no error
    */
   RC readForward(IndexCursor& cursor, int& key, RecordId& rid);
+
+  /**
+   * Find the last index entry whose key is not larger than searchKey,
+   * looking in the leaf node where searchKey would be inserted.
+   * @param searchKey[IN] the largest key to find
+   * @param key[OUT] the key of the entry found
+   * @param rid[OUT] the RecordId of the entry found
+   * @return 0 if found. RC_NO_SUCH_RECORD if the leaf has no such entry
+   */
+  RC locateLast(int searchKey, int& key, RecordId& rid);
+
+  /**
+   * Split the key range [lo, hi] into at most parts sub-ranges of about
+   * the same # leaves, using the separator keys of the non-leaf nodes.
+   * Only the non-leaf levels are read, from the root down to the first
+   * level with enough separator keys in the range.
+   * @param lo[IN] the smallest key of the range
+   * @param hi[IN] the largest key of the range
+   * @param parts[IN] the largest # sub-ranges
+   * @param bounds[OUT] the first keys of the sub-ranges after the first,
+   *                    in increasing order. empty if the range is not split
+   * @return error code. 0 if no error
+   */
+  RC splitRange(int lo, int hi, int parts, std::vector<int>& bounds);
+
+  /**
+   * Merge a batch of (key, RecordId) pairs into the index in bulk.
+   * The pairs are merged into the leaf chain in one pass: only the leaves
+   * that receive pairs are read and rewritten, a leaf that overflows is
+   * continued in new leaves, and the non-leaf levels are rebuilt over the
+   * leaves. The cost follows the size of the batch and the # non-leaf
+   * nodes, not the # leaves. Pairs with equal keys follow those already
+   * in the index. The index must be opened in 'w' mode.
+   * The merge is not atomic: the leaves that receive pairs are rewritten
+   * in place, and the new non-leaf nodes overwrite the pages of the old
+   * ones before page 0 points to the new root on close(). A crash during
+   * a merge therefore corrupts an existing index, which then has to be
+   * rebuilt from the table with CREATE INDEX.
+   * @param entries[IN] the finished sort of the pairs on key. the value
+   *                    of every tuple holds the bytes of its RecordId
+   * @return error code. 0 if no error
+   */
+  RC merge(ExternalSorter& entries);
   
  private:
+  // the state of merge(), defined in BTreeIndex.cc
+  struct MergeState;
+
+  // read the leaves in key order and the non-leaf nodes of the tree
+  RC readLevels(MergeState& m);
+
+  // move the leaves before leaf i to the new tree, and start merging into leaf i
+  RC openLeaf(MergeState& m, int i);
+
+  // add an entry to the leaf being filled, writing the leaf when it is full
+  RC emit(MergeState& m, int key, const RecordId& rid);
+
+  // add the rest of the leaf being merged and write the last leaf filled
+  RC closeLeaf(MergeState& m);
+
+  // build the non-leaf levels over the leaves of the new tree
+  RC buildLevels(MergeState& m);
+
+  // a page for a new node, reusing the non-leaf nodes of the old tree first
+  PageId allocate(MergeState& m);
+
   PageFile pf;         /// the PageFile used to store the actual b+tree in disk
+  char     mode;       /// the mode the file was opened in
 
   PageId   rootPid;    /// the PageId of the root node
   int      treeHeight; /// the height of the tree
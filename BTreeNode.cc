@@ -130,6 +130,26 @@ RC BTLeafNode::insertAndSplit(int key, const RecordId& rid,
 
 }
 
+/*
+ * Append the (key, rid) pair after the last entry of the node.
+ * @param key[IN] the key to append, not smaller than the keys in the node
+ * @param rid[IN] the RecordId to append
+ * @return 0 if successful. Return an error code if the node is full.
+ */
+RC BTLeafNode::append(int key, const RecordId& rid)
+{
+	int keyCount = getKeyCount();
+	if (keyCount >= MAX_LEAF_COUNT)
+		return RC_NODE_FULL;
+	LeafEntry le;
+	le.key = key;
+	le.rid = rid;
+	memcpy(buffer+keyCount*sizeof(LeafEntry),&le,sizeof(LeafEntry));
+	keyCount++;
+	memcpy(buffer+PageFile::PAGE_SIZE-8,&keyCount,sizeof(int));
+	return 0;
+}
+
 /**
  * If searchKey exists in the node, set eid to the index entry
  * with searchKey and return 0. If not, set eid to the index entry
@@ -356,6 +376,26 @@ RC BTNonLeafNode::insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, in
 	return 0; 
 }
 
+/*
+ * Append the (key, pid) pair after the last entry of the node.
+ * @param key[IN] the key to append, not smaller than the keys in the node
+ * @param pid[IN] the PageId to append behind the key
+ * @return 0 if successful. Return an error code if the node is full.
+ */
+RC BTNonLeafNode::append(int key, PageId pid)
+{
+	int keyCount = getKeyCount();
+	if (keyCount >= MAX_NONLEAF_COUNT)
+		return RC_NODE_FULL;
+	NonLeafEntry nle;
+	nle.key = key;
+	nle.pid = pid;
+	memcpy(buffer + sizeof(PageId) + keyCount*sizeof(NonLeafEntry), &nle, sizeof(NonLeafEntry));
+	keyCount++;
+	memcpy(buffer + PageFile::PAGE_SIZE - 4, &keyCount, sizeof(int));
+	return 0;
+}
+
 /*
  * Given the searchKey, find the child-node pointer to follow and
  * output it in pid.
@@ -409,6 +449,17 @@ RC BTNonLeafNode::initializeRoot(PageId pid1, int key, PageId pid2)
 	return 0;
 }
 
+/*
+ * Return the PageId before the first key of the node.
+ * @return the PageId of the leftmost child node
+ */
+PageId BTNonLeafNode::getFirstPtr()
+{
+	PageId pid;
+	memcpy(&pid, buffer, sizeof(PageId));
+	return pid;
+}
+
 /*
 * Read the (pid, key) pair from the eid entry.
 * @return 0 if successful. Return an error code if there is an error.
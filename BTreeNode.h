@@ -46,6 +46,15 @@ class BTLeafNode {
     */
     RC insertAndSplit(int key, const RecordId& rid, BTLeafNode& sibling, int& siblingKey);
 
+   /**
+    * Append the (key, rid) pair after the last entry of the node.
+    * The caller keeps the keys sorted, as when the node is filled in bulk.
+    * @param key[IN] the key to append, not smaller than the keys in the node
+    * @param rid[IN] the RecordId to append
+    * @return 0 if successful. Return an error code if the node is full.
+    */
+    RC append(int key, const RecordId& rid);
+
    /**
     * If searchKey exists in the node, set eid to the index entry
     * with searchKey and return 0. If not, set eid to the index entry
@@ -155,6 +164,16 @@ class BTNonLeafNode {
     */
     RC insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, int& midKey);
 
+   /**
+    * Append the (key, pid) pair after the last entry of the node.
+    * The caller keeps the keys sorted, as when the node is filled in bulk.
+    * The node must hold its first PageId already (see initializeRoot()).
+    * @param key[IN] the key to append, not smaller than the keys in the node
+    * @param pid[IN] the PageId to append behind the key
+    * @return 0 if successful. Return an error code if the node is full.
+    */
+    RC append(int key, PageId pid);
+
    /**
     * Given the searchKey, find the child-node pointer to follow and
     * output it in pid.
@@ -174,6 +193,12 @@ class BTNonLeafNode {
     */
     RC initializeRoot(PageId pid1, int key, PageId pid2);
 
+   /**
+    * Return the PageId before the first key of the node.
+    * @return the PageId of the leftmost child node
+    */
+    PageId getFirstPtr();
+
    /**
     * Return the number of keys stored in the node.
     * @return the number of keys in the node
@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include "ClusteredFile.h"
+#include "BTreeNode.h"
+
+using namespace std;
+
+// the header of a leaf page: next leaf PageId, # tuples
+static const int LEAF_HEADER_SIZE = sizeof(PageId) + sizeof(short);
+
+// the space taken by a tuple in a leaf, including its offset
+static int tupleSize(const ClusteredFile::Tuple& t)
+{
+  return sizeof(short) + sizeof(int) + 1 + t.second.size();
+}
+
+static bool keyLess(const ClusteredFile::Tuple& a, const ClusteredFile::Tuple& b)
+{
+  return a.first < b.first;
+}
+
+// the number of tuples in a leaf page
+static int getTupleCount(const char* page)
+{
+  short count;
+  memcpy(&count, page + sizeof(PageId), sizeof(short));
+  return count;
+}
+
+// the i'th tuple of a leaf page
+static const char* getTuple(const char* page, int i)
+{
+  short offset;
+  memcpy(&offset, page + LEAF_HEADER_SIZE + i*sizeof(short), sizeof(short));
+  return page + offset;
+}
+
+
+ClusteredFile::ClusteredFile()
+{
+  mode = 'r';
+  rootPid = 1;
+  treeHeight = 1;
+}
+
+RC ClusteredFile::open(const string& filename, char mode)
+{
+  RC   rc;
+  char page[PageFile::PAGE_SIZE];
+
+  if ((rc = pf.open(filename, mode)) < 0) return rc;
+  this->mode = mode;
+
+  // the file is empty. initialize an empty leaf as the root.
+  if (pf.endPid() == 0) {
+    vector<Tuple> none;
+    return build(none);
+  }
+
+  // page 0 stores rootPid and treeHeight
+  if ((rc = pf.read(0, page)) < 0) {
+    pf.close();
+    return rc;
+  }
+  memcpy(&rootPid, page, sizeof(PageId));
+  memcpy(&treeHeight, page + sizeof(PageId), sizeof(int));
+
+  return 0;
+}
+
+RC ClusteredFile::close()
+{
+  RC   rc;
+  char page[PageFile::PAGE_SIZE];
+
+  if (mode == 'w' || mode == 'W') {
+    memset(page, 0, PageFile::PAGE_SIZE);
+    memcpy(page, &rootPid, sizeof(PageId));
+    memcpy(page + sizeof(PageId), &treeHeight, sizeof(int));
+    if ((rc = pf.write(0, page)) < 0) return rc;
+  }
+
+  return pf.close();
+}
+
+RC ClusteredFile::build(vector<Tuple>& tuples)
+{
+  RC          rc;
+  vector<int> keys;
+
+  stable_sort(tuples.begin(), tuples.end(), keyLess);
+
+  // pack the leaves from page 1, and remember the first key of each leaf
+  vector<PageId> pids;
+  vector<PageId> freePids;
+  PageId         pid = 1;
+  if ((rc = writeLeaves(tuples, RC_END_OF_TREE, pid, freePids, keys, pids)) < 0) return rc;
+
+  return writeLevels(keys, pids, freePids, pid);
+}
+
+RC ClusteredFile::merge(vector<Tuple>& tuples)
+{
+  RC             rc;
+  char           page[PageFile::PAGE_SIZE];
+  vector<int>    seps;      // the separator key before every leaf. seps[0] is unused
+  vector<PageId> leaves;    // the leaves in key order
+  vector<PageId> freePids;  // the non-leaf nodes, rewritten by writeLevels()
+
+  if (mode != 'w' && mode != 'W') return RC_INVALID_FILE_MODE;
+  if (tuples.empty()) return 0;
+  stable_sort(tuples.begin(), tuples.end(), keyLess);
+
+  // read the leaves and their separators from the non-leaf levels, level
+  // by level, without reading any leaf
+  leaves.push_back(rootPid);
+  seps.push_back(0);
+  for (int h = 1; h < treeHeight; h++) {
+    vector<int>    downSeps;
+    vector<PageId> down;
+    for (unsigned i = 0; i < leaves.size(); i++) {
+      BTNonLeafNode node;
+      PageId        child;
+      int           key;
+      if ((rc = node.read(leaves[i], pf)) < 0) return rc;
+      freePids.push_back(leaves[i]);
+      node.locateChildPtr(INT_MIN, child);
+      down.push_back(child);
+      downSeps.push_back(seps[i]);
+      for (int j = 0; j < node.getKeyCount(); j++) {
+        node.readEntry(j, key, child);
+        down.push_back(child);
+        downSeps.push_back(key);
+      }
+    }
+    leaves.swap(down);
+    seps.swap(downSeps);
+  }
+
+  // a tuple goes to the last leaf whose separator is <= its key, so that
+  // it follows the tuples with the same key. every leaf that receives
+  // tuples is merged with them and rewritten in place, continued in new
+  // leaves if it overflows.
+  vector<int>    newKeys;
+  vector<PageId> newLeaves;
+  PageId         nextPid = pf.endPid();
+  unsigned       t = 0;
+  for (unsigned i = 0; i < leaves.size(); i++) {
+    unsigned end = t;
+    if (i + 1 == leaves.size()) end = tuples.size();
+    else while (end < tuples.size() && tuples[end].first < seps[i + 1]) end++;
+    if (end == t) {
+      newKeys.push_back(seps[i]);
+      newLeaves.push_back(leaves[i]);
+      continue;
+    }
+
+    // the tuples of the leaf come before the new ones with the same key
+    vector<Tuple> merged;
+    Tuple         tuple;
+    if ((rc = pf.read(leaves[i], page)) < 0) return rc;
+    PageId next;
+    memcpy(&next, page, sizeof(PageId));
+    int n = getTupleCount(page);
+    for (int j = 0; j < n; j++) {
+      const char* p = getTuple(page, j);
+      memcpy(&tuple.first, p, sizeof(int));
+      tuple.second.assign(p + sizeof(int) + 1, (unsigned char) p[sizeof(int)]);
+      while (t < end && tuples[t].first < tuple.first) merged.push_back(tuples[t++]);
+      merged.push_back(tuple);
+    }
+    while (t < end) merged.push_back(tuples[t++]);
+
+    // the first page of the leaf keeps its place and its separator
+    vector<int>    keys;
+    vector<PageId> pids;
+    PageId         pid = leaves[i];
+    freePids.insert(freePids.begin(), pid);
+    if ((rc = writeLeaves(merged, next, nextPid, freePids, keys, pids)) < 0) return rc;
+    keys[0] = seps[i];
+    newKeys.insert(newKeys.end(), keys.begin(), keys.end());
+    newLeaves.insert(newLeaves.end(), pids.begin(), pids.end());
+  }
+
+  return writeLevels(newKeys, newLeaves, freePids, nextPid);
+}
+
+RC ClusteredFile::writeLeaves(const vector<Tuple>& tuples, PageId last, PageId& nextPid,
+                              vector<PageId>& freePids, vector<int>& keys, vector<PageId>& pids)
+{
+  RC   rc;
+  char page[PageFile::PAGE_SIZE];
+
+  // the pages of the leaves are known before they are written, so that
+  // every leaf can point to the next one
+  unsigned n = tuples.size();
+  unsigned begin = 0;
+  PageId   pid = allocate(freePids, nextPid);
+  do {
+    unsigned end = begin;
+    int      size = LEAF_HEADER_SIZE;
+    while (end < n && size + tupleSize(tuples[end]) <= PageFile::PAGE_SIZE) {
+      size += tupleSize(tuples[end++]);
+    }
+    // a tuple that does not fit in an empty leaf can never be stored
+    if (end == begin && end < n) return RC_NODE_FULL;
+
+    short  count = end - begin;
+    short  offset = LEAF_HEADER_SIZE + count*sizeof(short);
+    PageId next = (end < n) ? allocate(freePids, nextPid) : last;
+    memset(page, 0, PageFile::PAGE_SIZE);
+    memcpy(page, &next, sizeof(PageId));
+    memcpy(page + sizeof(PageId), &count, sizeof(short));
+    for (unsigned i = begin; i < end; i++) {
+      memcpy(page + LEAF_HEADER_SIZE + (i - begin)*sizeof(short), &offset, sizeof(short));
+      memcpy(page + offset, &tuples[i].first, sizeof(int));
+      page[offset + sizeof(int)] = (char) tuples[i].second.size();
+      memcpy(page + offset + sizeof(int) + 1, tuples[i].second.data(), tuples[i].second.size());
+      offset += sizeof(int) + 1 + tuples[i].second.size();
+    }
+    if ((rc = pf.write(pid, page)) < 0) return rc;
+
+    keys.push_back((count > 0) ? tuples[begin].first : 0);
+    pids.push_back(pid);
+    begin = end;
+    pid = next;
+  } while (begin < n);
+
+  return 0;
+}
+
+RC ClusteredFile::writeLevels(vector<int>& keys, vector<PageId>& pids,
+                              vector<PageId>& freePids, PageId& nextPid)
+{
+  RC rc;
+
+  // build the non-leaf levels bottom up until a single node is left.
+  // the children are spread evenly, so that every node has two or more.
+  treeHeight = 1;
+  while (pids.size() > 1) {
+    vector<int>    upKeys;
+    vector<PageId> upPids;
+    int m = pids.size();
+    int nodes = (m + BTNonLeafNode::MAX_NONLEAF_COUNT) / (BTNonLeafNode::MAX_NONLEAF_COUNT + 1);
+
+    int begin = 0;
+    for (int j = 0; j < nodes; j++) {
+      int end = begin + m/nodes + ((j < m % nodes) ? 1 : 0);
+
+      BTNonLeafNode node;
+      PageId        pid = allocate(freePids, nextPid);
+      node.initializeRoot(pids[begin], keys[begin + 1], pids[begin + 1]);
+      for (int i = begin + 2; i < end; i++) {
+        node.insert(keys[i], pids[i]);
+      }
+      if ((rc = node.write(pid, pf)) < 0) return rc;
+
+      upKeys.push_back(keys[begin]);
+      upPids.push_back(pid);
+      begin = end;
+    }
+
+    keys.swap(upKeys);
+    pids.swap(upPids);
+    treeHeight++;
+  }
+  rootPid = pids[0];
+
+  return 0;
+}
+
+PageId ClusteredFile::allocate(vector<PageId>& freePids, PageId& nextPid)
+{
+  if (freePids.empty()) return nextPid++;
+  PageId pid = freePids.front();
+  freePids.erase(freePids.begin());
+  return pid;
+}
+
+RC ClusteredFile::locate(int searchKey, IndexCursor& cursor)
+{
+  RC     rc;
+  char   page[PageFile::PAGE_SIZE];
+  PageId pid = rootPid;
+
+  // a key equal to a separator goes to the right child, but the tuples
+  // with that key may start in the left child. search for a smaller key.
+  int childKey = (searchKey > INT_MIN) ? searchKey - 1 : searchKey;
+  for (int h = 1; h < treeHeight; h++) {
+    BTNonLeafNode node;
+    if ((rc = node.read(pid, pf)) < 0) return rc;
+    node.locateChildPtr(childKey, pid);
+  }
+
+  // find the first tuple with the key in the leaf
+  if ((rc = pf.read(pid, page)) < 0) return rc;
+  int lo = 0;
+  int hi = getTupleCount(page);
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    int key;
+    memcpy(&key, getTuple(page, mid), sizeof(int));
+    if (key < searchKey) lo = mid + 1;
+    else hi = mid;
+  }
+  cursor.pid = pid;
+  cursor.eid = lo;
+
+  // the tuple may be at the beginning of the next leaf
+  while (cursor.eid == getTupleCount(page)) {
+    memcpy(&pid, page, sizeof(PageId));
+    if (pid == RC_END_OF_TREE) return RC_NO_SUCH_RECORD;
+    if ((rc = pf.read(pid, page)) < 0) return rc;
+    cursor.pid = pid;
+    cursor.eid = 0;
+  }
+
+  int key;
+  memcpy(&key, getTuple(page, cursor.eid), sizeof(int));
+  return (key == searchKey) ? 0 : RC_NO_SUCH_RECORD;
+}
+
+RC ClusteredFile::readForward(IndexCursor& cursor, int& key, string& value)
+{
+  RC   rc;
+  char page[PageFile::PAGE_SIZE];
+
+  if (cursor.pid == RC_END_OF_TREE) return RC_END_OF_TREE;
+  if ((rc = pf.read(cursor.pid, page)) < 0) return rc;
+
+  // skip to the next leaf at the end of a leaf
+  while (cursor.eid >= getTupleCount(page)) {
+    memcpy(&cursor.pid, page, sizeof(PageId));
+    cursor.eid = 0;
+    if (cursor.pid == RC_END_OF_TREE) return RC_END_OF_TREE;
+    if ((rc = pf.read(cursor.pid, page)) < 0) return rc;
+  }
+
+  const char* tuple = getTuple(page, cursor.eid);
+  memcpy(&key, tuple, sizeof(int));
+  value.assign(tuple + sizeof(int) + 1, (unsigned char) tuple[sizeof(int)]);
+  cursor.eid++;
+
+  return 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef CLUSTEREDFILE_H
+#define CLUSTEREDFILE_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include "Bruinbase.h"
+#include "PageFile.h"
+#include "BTreeIndex.h"
+
+/**
+ * An index-organized table: the (key, value) tuples are stored in the
+ * leaves of a B+tree on key, so a key range is read by a sequential scan
+ * of the leaves without any lookup into a separate RecordFile.
+ *
+ * A leaf is laid out as
+ *   [next leaf PageId][# tuples (short)][tuple offsets (short) * # tuples]
+ *   ... [tuples]
+ * where a tuple is [key][value length (1 byte)][value]. The non-leaf
+ * nodes are BTNonLeafNode's, whose separator is the first key of the
+ * child on its right. Page 0 stores rootPid and treeHeight.
+ *
+ * build() bulk-builds the tree from the tuples sorted by key, so the
+ * leaves are packed full and stored sequentially. merge() adds tuples to
+ * an existing tree: only the leaves that receive tuples are rewritten, in
+ * place, and continued in new pages at the end of the file when they
+ * overflow, after which the non-leaf levels are rebuilt. The leaves are
+ * rewritten in place, so a merge that fails midway can leave the file
+ * inconsistent.
+ */
+class ClusteredFile {
+ public:
+  typedef std::pair<int, std::string> Tuple;
+
+  ClusteredFile();
+
+  /**
+   * open the file in read or write mode.
+   * under 'w' mode, the file is created if it does not exist.
+   * @param filename[IN] the name of the file
+   * @param mode[IN] 'r' for read, 'w' for write
+   * @return error code. 0 if no error
+   */
+  RC open(const std::string& filename, char mode);
+
+  /**
+   * close the file.
+   * @return error code. 0 if no error
+   */
+  RC close();
+
+  /**
+   * replace the content of the file with the tuples.
+   * the tuples are sorted by key, keeping the order of equal keys.
+   * @param tuples[IN/OUT] the tuples to store
+   * @return error code. RC_NODE_FULL if a tuple does not fit in a leaf.
+   *         0 if no error
+   */
+  RC build(std::vector<Tuple>& tuples);
+
+  /**
+   * add the tuples to the file. a tuple is stored after the tuples
+   * already in the file with the same key.
+   * the tuples are sorted by key, keeping the order of equal keys.
+   * @param tuples[IN/OUT] the tuples to add
+   * @return error code. RC_NODE_FULL if a tuple does not fit in a leaf.
+   *         0 if no error
+   */
+  RC merge(std::vector<Tuple>& tuples);
+
+  /**
+   * set the cursor to the first tuple whose key is >= searchKey.
+   * @param searchKey[IN] the key to find
+   * @param cursor[OUT] the cursor pointing to the tuple
+   * @return 0 if searchKey is found. Otherwise, an error code
+   */
+  RC locate(int searchKey, IndexCursor& cursor);
+
+  /**
+   * read the tuple at the cursor and move the cursor to the next tuple,
+   * following the leaf chain if needed.
+   * @param cursor[IN/OUT] the cursor pointing to a tuple
+   * @param key[OUT] the key of the tuple
+   * @param value[OUT] the value of the tuple
+   * @return error code. RC_END_OF_TREE after the last tuple. 0 if no error
+   */
+  RC readForward(IndexCursor& cursor, int& key, std::string& value);
+
+ private:
+  /**
+   * write the tuples to a chain of leaves, packed full.
+   * @param tuples[IN] the tuples sorted by key
+   * @param last[IN] the next leaf of the last leaf written
+   * @param nextPid[IN/OUT] the first unused PageId at the end of the file
+   * @param freePids[IN/OUT] the pages to use before the end of the file
+   * @param keys[OUT] the first key of every leaf written is appended
+   * @param pids[OUT] the PageId of every leaf written is appended
+   * @return error code. 0 if no error
+   */
+  RC writeLeaves(const std::vector<Tuple>& tuples, PageId last, PageId& nextPid,
+                 std::vector<PageId>& freePids, std::vector<int>& keys,
+                 std::vector<PageId>& pids);
+
+  /**
+   * build the non-leaf levels over the leaves and set rootPid and treeHeight.
+   * @param keys[IN] the separator of every leaf. keys[0] is unused
+   * @param pids[IN] the PageId of every leaf in key order
+   * @param freePids[IN/OUT] the pages to use before the end of the file
+   * @param nextPid[IN/OUT] the first unused PageId at the end of the file
+   * @return error code. 0 if no error
+   */
+  RC writeLevels(std::vector<int>& keys, std::vector<PageId>& pids,
+                 std::vector<PageId>& freePids, PageId& nextPid);
+
+  static PageId allocate(std::vector<PageId>& freePids, PageId& nextPid);
+
+  PageFile pf;          /// the PageFile used to store the tree
+  char     mode;        /// the mode the file was opened in
+  PageId   rootPid;     /// the PageId of the root node
+  int      treeHeight;  /// the height of the tree. stored in page 0
+};
+
+#endif /* CLUSTEREDFILE_H */
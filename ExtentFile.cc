@@ -0,0 +1,400 @@
+/**
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "Bruinbase.h"
+#include "ExtentFile.h"
+#include "LzCodec.h"
+#include <cstring>
+
+using std::string;
+using std::vector;
+
+// the first four bytes of the header page of a compressed file.
+// it cannot be the record count at the beginning of a RecordFile page.
+static const int EXTENT_MAGIC = 0x54584542;
+
+// the header page of a compressed file
+struct ExtentHeader {
+  int    magic;        // EXTENT_MAGIC
+  int    extentPages;  // # pages in an extent
+  PageId epid;         // (last page id + 1)
+  int    extentCount;  // # extents in the directory
+  PageId dirPid;       // the first disk page of the directory
+  int    freeCount;    // # free runs stored behind the directory
+};
+
+// # directory entries or free runs in a disk page
+static const int ENTRIES_PER_PAGE = PageFile::PAGE_SIZE / (2*sizeof(int));
+
+// # disk pages that store size bytes
+static int diskPages(int size)
+{
+  return (size + PageFile::PAGE_SIZE - 1) / PageFile::PAGE_SIZE;
+}
+
+
+ExtentFile::ExtentFile()
+{
+  mode = 'r';
+  compressed = false;
+  extentPages = EXTENT_PAGES;
+  epid = 0;
+  freePid = 1;
+  writeExt = -1;
+  writeDirty = false;
+  readExt = -1;
+}
+
+RC ExtentFile::open(const string& filename, char mode)
+{
+  RC   rc;
+  char page[PageFile::PAGE_SIZE];
+
+  if ((rc = pf.open(filename, mode)) < 0) return rc;
+
+  this->mode = mode;
+  compressed = false;
+  directory.clear();
+  freeRuns.clear();
+  writeExt = readExt = -1;
+  writeDirty = false;
+
+  // an empty file or a file without the header is a plain file
+  if (pf.endPid() == 0) return 0;
+  if ((rc = pf.read(0, page)) < 0) {
+    pf.close();
+    return rc;
+  }
+
+  ExtentHeader header;
+  memcpy(&header, page, sizeof(header));
+  if (header.magic != EXTENT_MAGIC) return 0;
+
+  // a header that does not fit the file is not trusted
+  int dirPages = (header.extentCount + ENTRIES_PER_PAGE - 1) / ENTRIES_PER_PAGE;
+  int freePages = (header.freeCount + ENTRIES_PER_PAGE - 1) / ENTRIES_PER_PAGE;
+  if (header.extentPages <= 0 || header.epid < 0 || header.extentCount < 0 ||
+      header.freeCount < 0 || header.dirPid < 1 ||
+      header.dirPid + dirPages + freePages > pf.endPid() ||
+      header.extentCount < (header.epid + header.extentPages - 1) / header.extentPages) {
+    pf.close();
+    return RC_INVALID_FILE_FORMAT;
+  }
+
+  compressed = true;
+  extentPages = header.extentPages;
+  epid = header.epid;
+
+  // load the extent directory
+  directory.resize(header.extentCount);
+  for (int i = 0; i < header.extentCount; i += ENTRIES_PER_PAGE) {
+    if ((rc = pf.read(header.dirPid + i/ENTRIES_PER_PAGE, page)) < 0) {
+      pf.close();
+      return rc;
+    }
+    int n = header.extentCount - i;
+    if (n > ENTRIES_PER_PAGE) n = ENTRIES_PER_PAGE;
+    memcpy(&directory[i], page, n*sizeof(ExtentEntry));
+  }
+  for (unsigned i = 0; i < directory.size(); i++) {
+    const ExtentEntry& e = directory[i];
+    if (e.pid < 1 || e.size < 0 || e.pid + diskPages(e.size) > header.dirPid) {
+      pf.close();
+      return RC_INVALID_FILE_FORMAT;
+    }
+  }
+
+  // load the free runs behind the directory. they are sorted by pid.
+  freeRuns.resize(header.freeCount);
+  for (int i = 0; i < header.freeCount; i += ENTRIES_PER_PAGE) {
+    if ((rc = pf.read(header.dirPid + dirPages + i/ENTRIES_PER_PAGE, page)) < 0) {
+      pf.close();
+      return rc;
+    }
+    int n = header.freeCount - i;
+    if (n > ENTRIES_PER_PAGE) n = ENTRIES_PER_PAGE;
+    memcpy(&freeRuns[i], page, n*sizeof(FreeRun));
+  }
+  for (unsigned i = 0; i < freeRuns.size(); i++) {
+    const FreeRun& r = freeRuns[i];
+    if (r.pid < 1 || r.pages <= 0 || r.pid + r.pages > header.dirPid ||
+        (i > 0 && r.pid < freeRuns[i-1].pid + freeRuns[i-1].pages)) {
+      pf.close();
+      return RC_INVALID_FILE_FORMAT;
+    }
+  }
+
+  // new extents overwrite the directory, which is rewritten on close
+  freePid = header.dirPid;
+
+  return 0;
+}
+
+RC ExtentFile::close()
+{
+  RC rc;
+
+  if (compressed && (mode == 'w' || mode == 'W')) {
+    // write the last extent and the directory behind it
+    if (writeDirty && (rc = flushExtent()) < 0) return rc;
+    if ((rc = writeHeader()) < 0) return rc;
+  }
+
+  compressed = false;
+  epid = 0;
+  directory.clear();
+  freeRuns.clear();
+  writeBuffer.clear();
+  readBuffer.clear();
+  writeExt = readExt = -1;
+  writeDirty = false;
+
+  return pf.close();
+}
+
+RC ExtentFile::compress(int extentPages)
+{
+  if (mode != 'w' && mode != 'W') return RC_INVALID_FILE_MODE;
+  if (compressed) return 0;
+  if (pf.endPid() > 0) return RC_FILE_NOT_EMPTY;
+
+  compressed = true;
+  this->extentPages = extentPages;
+  epid = 0;
+  freePid = 1;
+
+  // the header of the empty file is written right away, so that the
+  // file is not taken for a plain file if it is never closed
+  return writeHeader();
+}
+
+RC ExtentFile::writeHeader()
+{
+  RC           rc;
+  char         page[PageFile::PAGE_SIZE];
+  ExtentHeader header;
+
+  header.magic = EXTENT_MAGIC;
+  header.extentPages = extentPages;
+  header.epid = epid;
+  header.extentCount = directory.size();
+  header.dirPid = freePid;
+  header.freeCount = freeRuns.size();
+
+  PageId pid = freePid;
+  for (unsigned i = 0; i < directory.size(); i += ENTRIES_PER_PAGE) {
+    memset(page, 0, PageFile::PAGE_SIZE);
+    int n = directory.size() - i;
+    if (n > ENTRIES_PER_PAGE) n = ENTRIES_PER_PAGE;
+    memcpy(page, &directory[i], n*sizeof(ExtentEntry));
+    if ((rc = pf.write(pid++, page)) < 0) return rc;
+  }
+  for (unsigned i = 0; i < freeRuns.size(); i += ENTRIES_PER_PAGE) {
+    memset(page, 0, PageFile::PAGE_SIZE);
+    int n = freeRuns.size() - i;
+    if (n > ENTRIES_PER_PAGE) n = ENTRIES_PER_PAGE;
+    memcpy(page, &freeRuns[i], n*sizeof(FreeRun));
+    if ((rc = pf.write(pid++, page)) < 0) return rc;
+  }
+
+  memset(page, 0, PageFile::PAGE_SIZE);
+  memcpy(page, &header, sizeof(header));
+  return pf.write(0, page);
+}
+
+PageId ExtentFile::endPid() const
+{
+  return compressed ? epid : pf.endPid();
+}
+
+RC ExtentFile::read(PageId pid, void* buffer) const
+{
+  RC rc;
+
+  if (!compressed) return pf.read(pid, buffer);
+
+  if (pid < 0 || pid >= epid) return RC_INVALID_PID;
+
+  int ext = pid / extentPages;
+  int offset = (pid % extentPages) * PageFile::PAGE_SIZE;
+
+  // the page may be in the extent being written
+  if (ext == writeExt) {
+    memcpy(buffer, &writeBuffer[offset], PageFile::PAGE_SIZE);
+    return 0;
+  }
+
+  // decompress the extent unless it was the last one read
+  if (ext != readExt) {
+    readExt = -1;
+    if ((rc = readExtent(ext, readBuffer)) < 0) return rc;
+    readExt = ext;
+  }
+  memcpy(buffer, &readBuffer[offset], PageFile::PAGE_SIZE);
+
+  return 0;
+}
+
+RC ExtentFile::write(PageId pid, const void* buffer)
+{
+  RC rc;
+
+  if (!compressed) return pf.write(pid, buffer);
+
+  if (pid < 0) return RC_INVALID_PID;
+
+  int ext = pid / extentPages;
+
+  // bring the extent of the page into the write buffer
+  if (ext != writeExt) {
+    if (writeDirty && (rc = flushExtent()) < 0) return rc;
+
+    writeExt = -1;
+    if (ext < (int) directory.size()) {
+      if ((rc = readExtent(ext, writeBuffer)) < 0) return rc;
+    } else {
+      writeBuffer.assign(extentPages * PageFile::PAGE_SIZE, 0);
+    }
+    writeExt = ext;
+  }
+
+  memcpy(&writeBuffer[(pid % extentPages) * PageFile::PAGE_SIZE], buffer, PageFile::PAGE_SIZE);
+  writeDirty = true;
+  if (ext == readExt) readExt = -1;
+
+  // if the written pid >= end pid, update the end pid
+  if (pid >= epid) epid = pid + 1;
+
+  return 0;
+}
+
+RC ExtentFile::flushExtent()
+{
+  RC   rc;
+  char page[PageFile::PAGE_SIZE];
+
+  // compress the pages of the extent
+  int rawSize = extentPageCount(writeExt) * PageFile::PAGE_SIZE;
+  vector<char> block(LzCodec::compressBound(rawSize));
+  int size = LzCodec::compress(&writeBuffer[0], rawSize, &block[0]);
+  int pages = diskPages(size);
+
+  // the extents that precede it must exist in the directory.
+  // an empty extent has no disk page.
+  while ((int) directory.size() < writeExt) {
+    ExtentEntry empty = { 1, 0 };
+    directory.push_back(empty);
+  }
+
+  ExtentEntry entry = { 0, size };
+  if (writeExt == (int) directory.size()) {
+    entry.pid = allocate(pages);
+    directory.push_back(entry);
+  } else {
+    // a rewritten extent stays in its old pages if it still fits in them
+    // or is the last one on the disk. otherwise it moves, and its old
+    // pages are freed for the extents written later.
+    ExtentEntry old = directory[writeExt];
+    int oldPages = diskPages(old.size);
+    if (pages <= oldPages) {
+      entry.pid = old.pid;
+      release(old.pid + pages, oldPages - pages);
+    } else if (old.pid + oldPages == freePid) {
+      entry.pid = old.pid;
+      freePid = old.pid + pages;
+    } else {
+      entry.pid = allocate(pages);
+      release(old.pid, oldPages);
+    }
+    directory[writeExt] = entry;
+  }
+
+  // store the compressed extent in consecutive disk pages
+  for (int i = 0; i < pages; i++) {
+    int off = i * PageFile::PAGE_SIZE;
+    int n = size - off;
+    if (n > PageFile::PAGE_SIZE) n = PageFile::PAGE_SIZE;
+    memset(page, 0, PageFile::PAGE_SIZE);
+    memcpy(page, &block[off], n);
+    if ((rc = pf.write(entry.pid + i, page)) < 0) return rc;
+  }
+
+  writeDirty = false;
+  return 0;
+}
+
+PageId ExtentFile::allocate(int pages)
+{
+  // take the first free run that is large enough
+  for (unsigned i = 0; i < freeRuns.size(); i++) {
+    FreeRun& r = freeRuns[i];
+    if (r.pages < pages) continue;
+    PageId pid = r.pid;
+    r.pid += pages;
+    r.pages -= pages;
+    if (r.pages == 0) freeRuns.erase(freeRuns.begin() + i);
+    return pid;
+  }
+
+  PageId pid = freePid;
+  freePid += pages;
+  return pid;
+}
+
+void ExtentFile::release(PageId pid, int pages)
+{
+  if (pages <= 0) return;
+
+  // keep the runs sorted and join the neighbours of the freed run
+  unsigned i = 0;
+  while (i < freeRuns.size() && freeRuns[i].pid < pid) i++;
+  FreeRun run = { pid, pages };
+  if (i < freeRuns.size() && run.pid + run.pages == freeRuns[i].pid) {
+    run.pages += freeRuns[i].pages;
+    freeRuns.erase(freeRuns.begin() + i);
+  }
+  if (i > 0 && freeRuns[i-1].pid + freeRuns[i-1].pages == run.pid) {
+    run.pid = freeRuns[i-1].pid;
+    run.pages += freeRuns[i-1].pages;
+    freeRuns.erase(freeRuns.begin() + --i);
+  }
+
+  // a run at the end of the extents is given back to freePid
+  if (run.pid + run.pages == freePid) {
+    freePid = run.pid;
+  } else {
+    freeRuns.insert(freeRuns.begin() + i, run);
+  }
+}
+
+RC ExtentFile::readExtent(int ext, vector<char>& buffer) const
+{
+  RC rc;
+
+  buffer.assign(extentPages * PageFile::PAGE_SIZE, 0);
+  if (ext >= (int) directory.size()) return RC_INVALID_PID;
+
+  // read the disk pages holding the compressed extent
+  const ExtentEntry& entry = directory[ext];
+  int npages = diskPages(entry.size);
+  vector<char> block(npages * PageFile::PAGE_SIZE);
+  for (int i = 0; i < npages; i++) {
+    if ((rc = pf.read(entry.pid + i, &block[i * PageFile::PAGE_SIZE])) < 0) return rc;
+  }
+
+  if (entry.size > 0 &&
+      LzCodec::decompress(&block[0], entry.size, &buffer[0], buffer.size()) < 0) {
+    return RC_INVALID_FILE_FORMAT;
+  }
+
+  return 0;
+}
+
+int ExtentFile::extentPageCount(int ext) const
+{
+  int n = epid - ext * extentPages;
+  return (n < extentPages) ? n : extentPages;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef EXTENTFILE_H
+#define EXTENTFILE_H
+
+#include <string>
+#include <vector>
+#include "Bruinbase.h"
+#include "PageFile.h"
+
+/**
+ * read/write a file in the unit of a page, optionally storing the pages
+ * in LZ-compressed extents.
+ *
+ * A plain file is read and written through to a PageFile. In a compressed
+ * file, every group of extentPages consecutive pages (an extent) is
+ * compressed by LzCodec and stored in as few disk pages as possible:
+ *   page 0: header (magic, extentPages, endPid, # extents, directory pid)
+ *   page 1-: the compressed extents, each starting at a page boundary
+ *   then:    the extent directory of (first disk page, compressed size) pairs
+ *   then:    the free runs of (first disk page, # pages) pairs
+ * A rewritten extent is stored back in its old disk pages when it fits
+ * there; otherwise it moves and its old pages become a free run, which
+ * later extents reuse before the file grows.
+ * The extent being written and the extent last read are kept decompressed
+ * in memory, so a sequential scan decompresses every extent only once.
+ */
+class ExtentFile {
+ public:
+
+  static const int EXTENT_PAGES = 16;  // default # pages in an extent
+
+  ExtentFile();
+
+  /**
+   * open a file in read or write mode.
+   * when opened in 'w' mode, if the file does not exist, it is created.
+   * @param filename[IN] the name of the file to open
+   * @param mode[IN] 'r' for read, 'w' for write
+   * @return error code. 0 if no error
+   */
+  RC open(const std::string& filename, char mode);
+
+  /**
+   * close the file. the extent directory of a compressed file
+   * is written to the disk.
+   * @return error code. 0 if no error
+   */
+  RC close();
+
+  /**
+   * store the pages in compressed extents from now on.
+   * only an empty file opened in 'w' mode can be compressed.
+   * @param extentPages[IN] # pages in an extent
+   * @return error code. 0 if no error
+   */
+  RC compress(int extentPages = EXTENT_PAGES);
+
+  /**
+   * @return true if the pages are stored in compressed extents
+   */
+  bool isCompressed() const { return compressed; }
+
+  /**
+   * read a page into memory buffer.
+   * @param pid[IN] the page to read
+   * @param buffer[OUT] pointer to memory buffer
+   * @return error code. 0 if no error
+   */
+  RC read(PageId pid, void *buffer) const;
+
+  /**
+   * write the memory buffer to the page.
+   * if (pid >= endPid()), the file is expanded such that
+   * endPid() becomes (pid + 1).
+   * @param pid[IN] page to write to
+   * @param buffer[IN] the content to write
+   * @return error code. 0 if no error
+   */
+  RC write(PageId pid, const void *buffer);
+
+  /**
+   * @return the id of the last page in the file (+ 1)
+   */
+  PageId endPid() const;
+
+ private:
+  /**
+   * compress the extent in the write buffer and store it to the disk.
+   * @return error code. 0 if no error
+   */
+  RC flushExtent();
+
+  /**
+   * allocate consecutive disk pages, from a free run if one is large enough.
+   * @param pages[IN] # pages to allocate
+   * @return the first allocated page
+   */
+  PageId allocate(int pages);
+
+  /**
+   * add consecutive disk pages to the free runs.
+   * @param pid[IN] the first page to free
+   * @param pages[IN] # pages to free
+   */
+  void release(PageId pid, int pages);
+
+  /**
+   * write the header, the extent directory and the free runs behind the
+   * last extent.
+   * @return error code. 0 if no error
+   */
+  RC writeHeader();
+
+  /**
+   * read and decompress an extent.
+   * @param ext[IN] the extent to read
+   * @param buffer[OUT] the decompressed pages of the extent
+   * @return error code. 0 if no error
+   */
+  RC readExtent(int ext, std::vector<char>& buffer) const;
+
+  /**
+   * @return # pages stored in the extent
+   */
+  int extentPageCount(int ext) const;
+
+  // a directory entry, locating a compressed extent in the disk
+  struct ExtentEntry {
+    PageId pid;   // the first disk page of the extent
+    int    size;  // the size of the compressed extent in bytes
+  };
+
+  // consecutive disk pages that no extent uses
+  struct FreeRun {
+    PageId pid;    // the first disk page of the run
+    int    pages;  // # disk pages in the run
+  };
+
+  PageFile pf;           // the PageFile used to store the pages or extents
+  char     mode;         // the mode the file was opened in
+  bool     compressed;   // are the pages stored in compressed extents?
+  int      extentPages;  // # pages in an extent
+  PageId   epid;         // (last page id + 1) of the compressed file
+  PageId   freePid;      // the disk page where the next extent is stored
+
+  std::vector<ExtentEntry> directory;  // the location of each extent
+  std::vector<FreeRun>     freeRuns;   // the free disk pages, sorted by pid
+
+  std::vector<char> writeBuffer;  // the extent being written, decompressed
+  int               writeExt;     // the extent in writeBuffer. -1 if none
+  bool              writeDirty;   // is writeBuffer modified?
+
+  mutable std::vector<char> readBuffer;  // the extent last read, decompressed
+  mutable int               readExt;     // the extent in readBuffer. -1 if none
+};
+
+#endif // EXTENTFILE_H
@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include <cstdio>
+#include <algorithm>
+#include "ExternalSorter.h"
+
+using namespace std;
+
+typedef pair<int, string> Tuple;
+
+// the orders of the tuples. ties are broken by stable_sort and by the
+// run numbers in the merge, never by the other attribute.
+static bool keyAscending(const Tuple& a, const Tuple& b)    { return a.first < b.first; }
+static bool keyDescending(const Tuple& a, const Tuple& b)   { return a.first > b.first; }
+static bool valueAscending(const Tuple& a, const Tuple& b)  { return a.second < b.second; }
+static bool valueDescending(const Tuple& a, const Tuple& b) { return a.second > b.second; }
+
+typedef bool (*TupleOrder)(const Tuple& a, const Tuple& b);
+
+static TupleOrder tupleOrder(int attr, bool descending)
+{
+  if (attr == 1) return descending ? keyDescending : keyAscending;
+  return descending ? valueDescending : valueAscending;
+}
+
+ExternalSorter::ExternalSorter(const string& prefix, int attr, bool descending, int memoryBudget)
+{
+  this->prefix = prefix;
+  this->attr = attr;
+  this->descending = descending;
+  this->memoryBudget = memoryBudget;
+  memoryUsed = 0;
+  nextTuple = 0;
+  runCount = 0;
+  firstRun = 0;
+}
+
+ExternalSorter::~ExternalSorter()
+{
+  closeMerge();
+  for (int i = 0; i < runCount; i++) {
+    remove(runName(i).c_str());
+  }
+}
+
+RC ExternalSorter::add(int key, const string& value)
+{
+  tuples.push_back(Tuple(key, value));
+  memoryUsed += sizeof(Tuple) + value.size();
+
+  // the budget is used up. spill the tuples to a run.
+  if (memoryUsed >= memoryBudget) return writeRun();
+  return 0;
+}
+
+RC ExternalSorter::finish()
+{
+  RC rc;
+
+  // the tuples fit in memory. no run is written.
+  if (runCount == 0) {
+    stable_sort(tuples.begin(), tuples.end(), tupleOrder(attr, descending));
+    nextTuple = 0;
+    return 0;
+  }
+
+  if (!tuples.empty() && (rc = writeRun()) < 0) return rc;
+
+  // every run being merged takes a page buffer out of the budget
+  int fanIn = memoryBudget / PageFile::PAGE_SIZE;
+  if (fanIn > MAX_FAN_IN) fanIn = MAX_FAN_IN;
+  if (fanIn < 2) fanIn = 2;
+
+  // merge the runs in passes until a single merge can take them all.
+  // the runs of a pass are merged in the order they were written, so
+  // that tuples that compare equal keep their order.
+  while (runCount - firstRun > fanIn) {
+    int last = runCount;
+    for (int first = firstRun; first < last; first += fanIn) {
+      if ((rc = mergeRuns(first, min(first + fanIn, last))) < 0) return rc;
+    }
+    firstRun = last;
+  }
+
+  return openMerge(firstRun, runCount);
+}
+
+RC ExternalSorter::next(int& key, string& value)
+{
+  if (runCount > 0) return popMerge(key, value);
+
+  if (nextTuple >= tuples.size()) return RC_END_OF_TREE;
+  key = tuples[nextTuple].first;
+  value.swap(tuples[nextTuple].second);
+  nextTuple++;
+  return 0;
+}
+
+bool ExternalSorter::less(const Tuple& a, const Tuple& b) const
+{
+  return tupleOrder(attr, descending)(a, b);
+}
+
+bool ExternalSorter::beats(int a, int b) const
+{
+  if (a < 0) return true;
+  if (b < 0) return false;
+  if (inputs[a]->exhausted) return false;
+  if (inputs[b]->exhausted) return true;
+  if (less(inputs[a]->tuple, inputs[b]->tuple)) return true;
+  if (less(inputs[b]->tuple, inputs[a]->tuple)) return false;
+  return a < b;
+}
+
+void ExternalSorter::adjust(int s)
+{
+  // the winner of each match moves up, the loser stays in the node
+  int k = inputs.size();
+  for (int t = (s + k) / 2; t > 0; t /= 2) {
+    if (beats(tree[t], s)) swap(s, tree[t]);
+  }
+  tree[0] = s;
+}
+
+RC ExternalSorter::writeRun()
+{
+  RC        rc;
+  RunWriter w;
+
+  stable_sort(tuples.begin(), tuples.end(), tupleOrder(attr, descending));
+
+  if ((rc = w.open(runName(runCount))) < 0) return rc;
+  for (unsigned i = 0; i < tuples.size(); i++) {
+    if ((rc = w.append(tuples[i].first, tuples[i].second)) < 0) {
+      w.close();
+      return rc;
+    }
+  }
+  if ((rc = w.close()) < 0) return rc;
+  runCount++;
+
+  tuples.clear();
+  memoryUsed = 0;
+  return 0;
+}
+
+RC ExternalSorter::mergeRuns(int first, int last)
+{
+  RC        rc;
+  RunWriter w;
+  Tuple     t;
+
+  if ((rc = openMerge(first, last)) < 0) return rc;
+  if ((rc = w.open(runName(runCount))) < 0) {
+    closeMerge();
+    return rc;
+  }
+  while ((rc = popMerge(t.first, t.second)) == 0) {
+    if ((rc = w.append(t.first, t.second)) < 0) break;
+  }
+  closeMerge();
+  if (rc != RC_END_OF_TREE) {
+    w.close();
+    return rc;
+  }
+  if ((rc = w.close()) < 0) return rc;
+  runCount++;
+
+  // the merged runs are no longer needed
+  for (int i = first; i < last; i++) {
+    remove(runName(i).c_str());
+  }
+  return 0;
+}
+
+RC ExternalSorter::openMerge(int first, int last)
+{
+  RC rc;
+
+  for (int i = first; i < last; i++) {
+    MergeInput* in = new MergeInput;
+    if ((rc = in->run.open(runName(i))) < 0) {
+      delete in;
+      closeMerge();
+      return rc;
+    }
+    inputs.push_back(in);
+    in->exhausted = false;
+    if ((rc = advance(*in)) < 0) {
+      closeMerge();
+      return rc;
+    }
+  }
+
+  // play the matches from the last leaf to the first. -1 is an
+  // imaginary run that beats all others, and is pushed out of the tree
+  // by the real ones.
+  tree.assign(inputs.size(), -1);
+  for (int s = inputs.size() - 1; s >= 0; s--) {
+    adjust(s);
+  }
+  return 0;
+}
+
+RC ExternalSorter::popMerge(int& key, string& value)
+{
+  RC rc;
+
+  if (inputs.empty()) return RC_END_OF_TREE;
+  MergeInput* in = inputs[tree[0]];
+  if (in->exhausted) return RC_END_OF_TREE;
+
+  key = in->tuple.first;
+  value.swap(in->tuple.second);
+  if ((rc = advance(*in)) < 0) return rc;
+  adjust(tree[0]);
+  return 0;
+}
+
+void ExternalSorter::closeMerge()
+{
+  for (unsigned i = 0; i < inputs.size(); i++) {
+    inputs[i]->run.close();
+    delete inputs[i];
+  }
+  inputs.clear();
+  tree.clear();
+}
+
+RC ExternalSorter::advance(MergeInput& in)
+{
+  RC rc = in.run.next(in.tuple.first, in.tuple.second);
+
+  if (rc == RC_END_OF_TREE) {
+    in.exhausted = true;
+    return 0;
+  }
+  return rc;
+}
+
+string ExternalSorter::runName(int run) const
+{
+  char suffix[16];
+  sprintf(suffix, ".run%d", run);
+  return prefix + suffix;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef EXTERNALSORTER_H
+#define EXTERNALSORTER_H
+
+#include <string>
+#include <vector>
+#include "Bruinbase.h"
+#include "PageFile.h"
+#include "RunFile.h"
+
+/**
+ * sorts (key, value) tuples on key or on value within a memory budget.
+ *
+ * The tuples are collected in memory until the budget is used up. Then
+ * they are sorted and written to a run file through PageFile. When all
+ * tuples are added, the runs are merged with a loser tree: at most
+ * MAX_FAN_IN runs at a time, and no more than the budget has pages for,
+ * in as many passes as needed. A sort that
+ * fits in the budget writes no run. Tuples that compare equal keep the
+ * order in which they were added.
+ */
+class ExternalSorter {
+ public:
+  static const int MAX_FAN_IN = 64;  // # runs merged at a time
+
+  /**
+   * @param prefix[IN] the prefix of the names of the run files
+   * @param attr[IN] the attribute to sort on (1: key, 2: value)
+   * @param descending[IN] true to sort in descending order
+   * @param memoryBudget[IN] # bytes of tuples kept in memory
+   */
+  ExternalSorter(const std::string& prefix, int attr, bool descending, int memoryBudget);
+
+  /**
+   * remove the run files.
+   */
+  ~ExternalSorter();
+
+  /**
+   * add a tuple to the sort.
+   * @param key[IN] the key of the tuple
+   * @param value[IN] the value of the tuple
+   * @return error code. 0 if no error
+   */
+  RC add(int key, const std::string& value);
+
+  /**
+   * sort the tuples added so far, after which they are read by next().
+   * @return error code. 0 if no error
+   */
+  RC finish();
+
+  /**
+   * read the next tuple in the sort order.
+   * @param key[OUT] the key of the tuple
+   * @param value[OUT] the value of the tuple
+   * @return 0 if a tuple is read, RC_END_OF_TREE after the last tuple,
+   *         or an error code
+   */
+  RC next(int& key, std::string& value);
+
+  /**
+   * @return # run files written
+   */
+  int getRunCount() const { return runCount; }
+
+ private:
+  typedef std::pair<int, std::string> Tuple;
+
+  // a run being merged
+  struct MergeInput {
+    RunReader   run;
+    bool        exhausted;  // true after the last tuple is read
+    Tuple       tuple;      // the current tuple
+  };
+
+  // compare two tuples in the sort order
+  bool less(const Tuple& a, const Tuple& b) const;
+
+  // true if the current tuple of run a goes out before that of run b.
+  // -1 stands for a run that wins over all others.
+  bool beats(int a, int b) const;
+
+  // move the winner at the leaf s up the loser tree
+  void adjust(int s);
+
+  // sort the tuples in memory and write them to a new run
+  RC writeRun();
+
+  // merge runs [first, last) into a new run
+  RC mergeRuns(int first, int last);
+
+  // start merging the runs [first, last) with the loser tree
+  RC openMerge(int first, int last);
+
+  // pop the winner of the merge. RC_END_OF_TREE when all runs are exhausted.
+  RC popMerge(int& key, std::string& value);
+
+  // close the runs being merged
+  void closeMerge();
+
+  // read the next tuple of a run into its input
+  RC advance(MergeInput& in);
+
+  std::string runName(int run) const;
+
+  std::string prefix;      // the prefix of the names of the run files
+  int         attr;        // 1: key, 2: value
+  bool        descending;
+  int         memoryBudget;
+
+  std::vector<Tuple> tuples;  // the tuples in memory
+  int  memoryUsed;            // # bytes taken by the tuples in memory
+  unsigned nextTuple;         // the next tuple in memory read by next()
+
+  int  runCount;              // # runs written
+  int  firstRun;              // the first run that is not merged yet
+
+  std::vector<MergeInput*> inputs;  // the runs being merged
+  std::vector<int>         tree;    // tree[0]: the winner, tree[1..]: the losers
+};
+
+#endif // EXTERNALSORTER_H
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include <cstdio>
+#include "HashAggregator.h"
+
+using namespace std;
+
+static const int INITIAL_SLOTS = 1024;  // # slots of a new hash table
+
+HashAggregator::HashAggregator(const string& prefix, int attr, int memoryBudget, int level)
+{
+  this->prefix = prefix;
+  this->attr = attr;
+  this->memoryBudget = memoryBudget;
+  this->level = level;
+
+  Slot empty = { 0, -1 };
+  slots.assign(INITIAL_SLOTS, empty);
+  memoryUsed = INITIAL_SLOTS * sizeof(Slot);
+
+  for (int p = 0; p < PARTITION_COUNT; p++) {
+    partitions[p] = NULL;
+    spilled[p] = false;
+  }
+  nextGroup = 0;
+  nextPartition = 0;
+  child = NULL;
+}
+
+HashAggregator::~HashAggregator()
+{
+  delete child;
+  for (int p = 0; p < PARTITION_COUNT; p++) {
+    if (partitions[p] != NULL) {
+      partitions[p]->close();
+      delete partitions[p];
+    }
+    if (spilled[p]) remove(partitionName(p).c_str());
+  }
+}
+
+RC HashAggregator::add(int key, const string& value)
+{
+  unsigned h = hashOf(key, value);
+  unsigned mask = slots.size() - 1;
+  unsigned i = h & mask;
+
+  // probe for the group of the tuple
+  while (slots[i].group >= 0) {
+    if (slots[i].hash == h && matches(groups[slots[i].group], key, value)) {
+      Group& g = groups[slots[i].group];
+      g.count++;
+      g.sum += key;
+      if (key < g.min) g.min = key;
+      if (key > g.max) g.max = key;
+      return 0;
+    }
+    i = (i + 1) & mask;
+  }
+
+  // a new group that does not fit in memory is left to a partition.
+  // the top bits of the hash choose the partition, the bottom bits the slot.
+  int size = sizeof(Group) + ((attr == 2) ? value.size() : 0);
+  if (attr != 0 && level < MAX_LEVEL && memoryUsed + size > memoryBudget) {
+    int p = h >> 28;
+    RC  rc;
+    if (partitions[p] == NULL) {
+      partitions[p] = new RunWriter;
+      if ((rc = partitions[p]->open(partitionName(p))) < 0) return rc;
+      spilled[p] = true;
+    }
+    return partitions[p]->append(key, value);
+  }
+
+  Group g;
+  g.key = key;
+  if (attr == 2) g.value = value;
+  g.count = 1;
+  g.sum = key;
+  g.min = key;
+  g.max = key;
+  slots[i].hash = h;
+  slots[i].group = groups.size();
+  groups.push_back(g);
+  memoryUsed += size;
+
+  // keep the table at most half full
+  if (groups.size() * 2 > slots.size()) grow();
+  return 0;
+}
+
+RC HashAggregator::finish()
+{
+  RC rc;
+
+  for (int p = 0; p < PARTITION_COUNT; p++) {
+    if (partitions[p] == NULL) continue;
+    rc = partitions[p]->close();
+    delete partitions[p];
+    partitions[p] = NULL;
+    if (rc < 0) return rc;
+  }
+  return 0;
+}
+
+RC HashAggregator::next(Group& group)
+{
+  RC rc;
+
+  // the groups in memory come first
+  if (nextGroup < groups.size()) {
+    group = groups[nextGroup++];
+    return 0;
+  }
+
+  // then the groups of the partitions, aggregated one at a time
+  for (;;) {
+    if (child != NULL) {
+      if ((rc = child->next(group)) != RC_END_OF_TREE) return rc;
+      delete child;
+      child = NULL;
+      remove(partitionName(nextPartition - 1).c_str());
+      spilled[nextPartition - 1] = false;
+    }
+    while (nextPartition < PARTITION_COUNT && !spilled[nextPartition]) nextPartition++;
+    if (nextPartition == PARTITION_COUNT) return RC_END_OF_TREE;
+
+    RunReader r;
+    int       key;
+    string    value;
+    child = new HashAggregator(partitionName(nextPartition), attr, memoryBudget, level + 1);
+    nextPartition++;
+    if ((rc = r.open(partitionName(nextPartition - 1))) < 0) return rc;
+    while ((rc = r.next(key, value)) == 0) {
+      if ((rc = child->add(key, value)) < 0) break;
+    }
+    r.close();
+    if (rc != RC_END_OF_TREE) return rc;
+    if ((rc = child->finish()) < 0) return rc;
+  }
+}
+
+unsigned HashAggregator::hashOf(int key, const string& value) const
+{
+  // FNV-1a over the grouped attribute, seeded by the level, so that the
+  // tuples of a partition spread over all partitions of the next level
+  unsigned h = 2166136261u ^ (level * 0x9e3779b9u);
+  if (attr == 1) {
+    for (unsigned i = 0; i < sizeof(int); i++) {
+      h = (h ^ ((key >> (8 * i)) & 0xff)) * 16777619u;
+    }
+  } else if (attr == 2) {
+    for (unsigned i = 0; i < value.size(); i++) {
+      h = (h ^ (unsigned char) value[i]) * 16777619u;
+    }
+  }
+
+  // mix the bits, so that both the top and the bottom bits are usable
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+bool HashAggregator::matches(const Group& g, int key, const string& value) const
+{
+  if (attr == 1) return g.key == key;
+  if (attr == 2) return g.value.size() == value.size() && g.value == value;
+  return true;
+}
+
+void HashAggregator::grow()
+{
+  // move the slots to a table twice as large
+  Slot         empty = { 0, -1 };
+  vector<Slot> old(slots.size() * 2, empty);
+  unsigned     mask = old.size() - 1;
+
+  old.swap(slots);
+  for (unsigned j = 0; j < old.size(); j++) {
+    if (old[j].group < 0) continue;
+    unsigned i = old[j].hash & mask;
+    while (slots[i].group >= 0) i = (i + 1) & mask;
+    slots[i] = old[j];
+  }
+  memoryUsed += (slots.size() - old.size()) * sizeof(Slot);
+}
+
+string HashAggregator::partitionName(int p) const
+{
+  char suffix[16];
+  sprintf(suffix, ".%d", p);
+  return prefix + suffix;
+}
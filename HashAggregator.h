@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef HASHAGGREGATOR_H
+#define HASHAGGREGATOR_H
+
+#include <string>
+#include <vector>
+#include "Bruinbase.h"
+#include "RunFile.h"
+
+/**
+ * groups (key, value) tuples on key or on value, and computes the count
+ * and the sum, minimum and maximum of the keys of every group.
+ *
+ * The groups are found through an open-addressing hash table with linear
+ * probing. A slot holds the hash of a group and its position in a dense
+ * array of groups, so that a probe mostly reads consecutive slots.
+ *
+ * When the groups would take more memory than the budget, the tuples of
+ * the groups not in memory are written to one of PARTITION_COUNT
+ * partition files, chosen by their hash. Every partition is aggregated
+ * afterwards by another HashAggregator, which hashes with a different
+ * seed and may spill again, up to MAX_LEVEL levels.
+ */
+class HashAggregator {
+ public:
+  static const int PARTITION_COUNT = 16;  // # partitions of the spilled tuples
+  static const int MAX_LEVEL = 4;         // # times a tuple may be spilled
+
+  /**
+   * the aggregates of a group
+   */
+  struct Group {
+    int         key;     // the key of the group, if grouped on key
+    std::string value;   // the value of the group, if grouped on value
+    long long   count;   // # tuples in the group
+    long long   sum;     // the sum of their keys
+    int         min;     // the smallest key
+    int         max;     // the largest key
+  };
+
+  /**
+   * @param prefix[IN] the prefix of the names of the partition files
+   * @param attr[IN] the attribute to group on (1: key, 2: value),
+   *                 or 0 to aggregate all tuples into a single group
+   * @param memoryBudget[IN] # bytes of groups kept in memory
+   * @param level[IN] # times the tuples were spilled before
+   */
+  HashAggregator(const std::string& prefix, int attr, int memoryBudget, int level = 0);
+
+  /**
+   * remove the partition files.
+   */
+  ~HashAggregator();
+
+  /**
+   * add a tuple to its group.
+   * @param key[IN] the key of the tuple
+   * @param value[IN] the value of the tuple
+   * @return error code. 0 if no error
+   */
+  RC add(int key, const std::string& value);
+
+  /**
+   * end adding tuples, after which the groups are read by next().
+   * @return error code. 0 if no error
+   */
+  RC finish();
+
+  /**
+   * read the next group. the groups come in no particular order.
+   * @param group[OUT] the group
+   * @return 0 if a group is read, RC_END_OF_TREE after the last group,
+   *         or an error code
+   */
+  RC next(Group& group);
+
+ private:
+  // a slot of the hash table. group is -1 in an empty slot.
+  struct Slot {
+    unsigned hash;
+    int      group;
+  };
+
+  // the hash of the group of a tuple
+  unsigned hashOf(int key, const std::string& value) const;
+
+  // true if the tuple belongs to the group
+  bool matches(const Group& g, int key, const std::string& value) const;
+
+  // double the hash table
+  void grow();
+
+  std::string partitionName(int p) const;
+
+  std::string prefix;
+  int         attr;
+  int         memoryBudget;
+  int         level;
+
+  std::vector<Group> groups;  // the groups in memory
+  std::vector<Slot>  slots;   // the hash table. the size is a power of 2
+  int  memoryUsed;            // # bytes taken by the groups and the slots
+
+  RunWriter* partitions[PARTITION_COUNT];  // the spilled tuples, or NULL
+  bool       spilled[PARTITION_COUNT];     // true if a partition was written
+
+  unsigned        nextGroup;      // the next group in memory read by next()
+  int             nextPartition;  // the next partition aggregated by next()
+  HashAggregator* child;          // the aggregator of the current partition
+};
+
+#endif // HASHAGGREGATOR_H
@@ -0,0 +1,395 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include <cstring>
+#include "HashIndex.h"
+
+using namespace std;
+
+// the header in page 0
+struct HashHeader {
+  int    globalDepth;  // # hash bits used by the directory
+  PageId dirPid;       // the first directory page. -1 if in page 0
+  PageId freePid;      // the page where the next bucket is stored
+  PageId freeList;     // the first free page. -1 if none
+};
+
+// the header of a bucket page
+struct BucketHeader {
+  int    localDepth;   // # hash bits shared by the keys in the bucket
+  int    count;        // # entries in the page
+  PageId overflow;     // the next overflow page. -1 if none
+};
+
+// # directory entries in page 0 and in a directory page
+static const int HEADER_DIR_ENTRIES = (PageFile::PAGE_SIZE - sizeof(HashHeader)) / sizeof(PageId);
+static const int DIR_ENTRIES = PageFile::PAGE_SIZE / sizeof(PageId);
+
+// # entries in a bucket page
+static const int ENTRY_SIZE = sizeof(int) + sizeof(RecordId);
+static const int BUCKET_ENTRIES = (PageFile::PAGE_SIZE - sizeof(BucketHeader)) / ENTRY_SIZE;
+
+// beyond this depth, a full bucket always gets an overflow page
+static const int MAX_DEPTH = 20;
+
+// mix the bits of a key, so that its low bits select a bucket
+static unsigned hashKey(int key)
+{
+  unsigned h = (unsigned) key;
+  h ^= h >> 16;
+  h *= 0x85ebca6bU;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35U;
+  h ^= h >> 16;
+  return h;
+}
+
+
+HashIndex::HashIndex()
+{
+  mode = 'r';
+  globalDepth = 0;
+  dirPid = -1;
+  freePid = 1;
+  freeList = -1;
+}
+
+RC HashIndex::open(const string& indexname, char mode)
+{
+  RC         rc;
+  char       page[PageFile::PAGE_SIZE];
+  HashHeader header;
+
+  if ((rc = pf.open(indexname, mode)) < 0) return rc;
+  this->mode = mode;
+  directory.clear();
+
+  // the index is empty. a single bucket is pointed to by the directory.
+  if (pf.endPid() == 0) {
+    globalDepth = 0;
+    dirPid = -1;
+    freePid = 2;
+    freeList = -1;
+    directory.push_back(1);
+    vector<int>      keys;
+    vector<RecordId> rids;
+    // the header is written right away, so that an index that is never
+    // closed is still a valid empty index
+    if ((rc = writeBucket(1, 0, keys, rids)) < 0 || (rc = writeHeader()) < 0) {
+      pf.close();
+      return rc;
+    }
+    return 0;
+  }
+
+  if ((rc = pf.read(0, page)) < 0) {
+    pf.close();
+    return rc;
+  }
+  memcpy(&header, page, sizeof(header));
+  globalDepth = header.globalDepth;
+  dirPid = header.dirPid;
+  freePid = header.freePid;
+  freeList = header.freeList;
+  if (globalDepth < 0 || globalDepth > MAX_DEPTH || dirPid == 0 ||
+      dirPid >= pf.endPid() || freePid < 2 ||
+      freeList < -1 || freeList == 0 || freeList >= freePid) {
+    pf.close();
+    return RC_INVALID_FILE_FORMAT;
+  }
+
+  int size = 1 << globalDepth;
+  if (dirPid < 0) {
+    directory.resize(size);
+    memcpy(&directory[0], page + sizeof(header), size*sizeof(PageId));
+  } else if (mode == 'w' || mode == 'W') {
+    // the whole directory is needed to insert
+    directory.resize(size);
+    for (int i = 0; i < size; i += DIR_ENTRIES) {
+      if ((rc = pf.read(dirPid + i/DIR_ENTRIES, page)) < 0) {
+        pf.close();
+        return rc;
+      }
+      int n = (size - i < DIR_ENTRIES) ? size - i : DIR_ENTRIES;
+      memcpy(&directory[i], page, n*sizeof(PageId));
+    }
+    // new buckets overwrite the directory, which is rewritten on close
+    freePid = dirPid;
+  }
+
+  return 0;
+}
+
+RC HashIndex::close()
+{
+  RC rc;
+
+  if ((mode == 'w' || mode == 'W') && (rc = writeHeader()) < 0) return rc;
+
+  directory.clear();
+  return pf.close();
+}
+
+RC HashIndex::writeHeader()
+{
+  RC         rc;
+  char       page[PageFile::PAGE_SIZE];
+  HashHeader header;
+  int        size = directory.size();
+
+
+  // the directory goes to page 0 if it fits, or behind the buckets.
+  // the directory pages are written before the header that points to them.
+  header.globalDepth = globalDepth;
+  header.freePid = freePid;
+  header.freeList = freeList;
+  header.dirPid = (size <= HEADER_DIR_ENTRIES) ? -1 : freePid;
+  for (int i = 0; header.dirPid >= 0 && i < size; i += DIR_ENTRIES) {
+    int n = (size - i < DIR_ENTRIES) ? size - i : DIR_ENTRIES;
+    memset(page, 0, PageFile::PAGE_SIZE);
+    memcpy(page, &directory[i], n*sizeof(PageId));
+    if ((rc = pf.write(header.dirPid + i/DIR_ENTRIES, page)) < 0) return rc;
+  }
+
+  memset(page, 0, PageFile::PAGE_SIZE);
+  memcpy(page, &header, sizeof(header));
+  if (header.dirPid < 0) {
+    memcpy(page + sizeof(header), &directory[0], size*sizeof(PageId));
+  }
+  return pf.write(0, page);
+}
+
+RC HashIndex::insert(int key, const RecordId& rid)
+{
+  RC           rc;
+  char         page[PageFile::PAGE_SIZE];
+  BucketHeader bh;
+
+  if (mode != 'w' && mode != 'W') return RC_INVALID_FILE_MODE;
+
+  while (true) {
+    int    slot = hashKey(key) & ((1 << globalDepth) - 1);
+    PageId pid = directory[slot];
+
+    if ((rc = pf.read(pid, page)) < 0) return rc;
+    memcpy(&bh, page, sizeof(bh));
+
+    // the entry fits in the bucket page
+    if (bh.count < BUCKET_ENTRIES) {
+      char* entry = page + sizeof(bh) + bh.count*ENTRY_SIZE;
+      memcpy(entry, &key, sizeof(int));
+      memcpy(entry + sizeof(int), &rid, sizeof(RecordId));
+      bh.count++;
+      memcpy(page, &bh, sizeof(bh));
+      return pf.write(pid, page);
+    }
+
+    // split the bucket if the next hash bit divides its keys.
+    // otherwise a split would move nothing, e.g. for duplicate keys.
+    bool splittable = false;
+    if (bh.localDepth < MAX_DEPTH) {
+      unsigned bit = (hashKey(key) >> bh.localDepth) & 1;
+      for (int i = 0; i < bh.count; i++) {
+        int k;
+        memcpy(&k, page + sizeof(bh) + i*ENTRY_SIZE, sizeof(int));
+        if (((hashKey(k) >> bh.localDepth) & 1) != bit) {
+          splittable = true;
+          break;
+        }
+      }
+    }
+    if (splittable) {
+      if ((rc = split(slot)) < 0) return rc;
+      continue;
+    }
+
+    // add the entry to the overflow chain, in front of the full pages
+    char         opage[PageFile::PAGE_SIZE];
+    BucketHeader oh;
+    PageId       opid = bh.overflow;
+    if (opid >= 0) {
+      if ((rc = pf.read(opid, opage)) < 0) return rc;
+      memcpy(&oh, opage, sizeof(oh));
+    }
+    if (opid < 0 || oh.count >= BUCKET_ENTRIES) {
+      oh.localDepth = bh.localDepth;
+      oh.count = 0;
+      oh.overflow = bh.overflow;
+      if ((rc = allocate(opid)) < 0) return rc;
+      bh.overflow = opid;
+      memcpy(page, &bh, sizeof(bh));
+      if ((rc = pf.write(pid, page)) < 0) return rc;
+    }
+    char* entry = opage + sizeof(oh) + oh.count*ENTRY_SIZE;
+    memcpy(entry, &key, sizeof(int));
+    memcpy(entry + sizeof(int), &rid, sizeof(RecordId));
+    oh.count++;
+    memcpy(opage, &oh, sizeof(oh));
+    return pf.write(opid, opage);
+  }
+}
+
+RC HashIndex::lookup(int searchKey, vector<RecordId>& rids)
+{
+  RC           rc;
+  char         page[PageFile::PAGE_SIZE];
+  BucketHeader bh;
+  PageId       pid;
+
+  rids.clear();
+  if ((rc = getBucket(hashKey(searchKey) & ((1 << globalDepth) - 1), pid)) < 0) return rc;
+
+  // scan the bucket and its overflow pages. a page number outside the
+  // file, or page 0, means the index is corrupt and would be read forever.
+  while (pid != -1) {
+    if (pid <= 0 || pid >= pf.endPid()) return RC_INVALID_PID;
+    if ((rc = pf.read(pid, page)) < 0) return rc;
+    memcpy(&bh, page, sizeof(bh));
+    if (bh.count < 0 || bh.count > BUCKET_ENTRIES) return RC_INVALID_FILE_FORMAT;
+    for (int i = 0; i < bh.count; i++) {
+      const char* entry = page + sizeof(bh) + i*ENTRY_SIZE;
+      int key;
+      memcpy(&key, entry, sizeof(int));
+      if (key == searchKey) {
+        RecordId rid;
+        memcpy(&rid, entry + sizeof(int), sizeof(RecordId));
+        rids.push_back(rid);
+      }
+    }
+    pid = bh.overflow;
+  }
+
+  return rids.empty() ? RC_NO_SUCH_RECORD : 0;
+}
+
+RC HashIndex::split(int slot)
+{
+  RC               rc;
+  char             page[PageFile::PAGE_SIZE];
+  BucketHeader     bh;
+  PageId           pid = directory[slot];
+  vector<int>      keys[2];
+  vector<RecordId> rids[2];
+
+  // collect the entries of the bucket and its overflow pages
+  // and divide them on the next hash bit
+  if ((rc = pf.read(pid, page)) < 0) return rc;
+  memcpy(&bh, page, sizeof(bh));
+  int            depth = bh.localDepth;
+  vector<PageId> overflows;
+  for (PageId p = pid; p >= 0; p = bh.overflow) {
+    if (p != pid) {
+      if ((rc = pf.read(p, page)) < 0) return rc;
+      memcpy(&bh, page, sizeof(bh));
+      overflows.push_back(p);
+    }
+    for (int i = 0; i < bh.count; i++) {
+      int      key;
+      RecordId rid;
+      memcpy(&key, page + sizeof(bh) + i*ENTRY_SIZE, sizeof(int));
+      memcpy(&rid, page + sizeof(bh) + i*ENTRY_SIZE + sizeof(int), sizeof(RecordId));
+      int bit = (hashKey(key) >> depth) & 1;
+      keys[bit].push_back(key);
+      rids[bit].push_back(rid);
+    }
+  }
+
+  // double the directory if the bucket is pointed to by a single slot
+  if (depth == globalDepth) {
+    int size = directory.size();
+    directory.resize(2*size);
+    for (int i = 0; i < size; i++) directory[size + i] = directory[i];
+    globalDepth++;
+  }
+
+  // the overflow pages are freed, to be reused by the two buckets
+  for (unsigned i = 0; i < overflows.size(); i++) {
+    if ((rc = release(overflows[i])) < 0) return rc;
+  }
+
+  // the slots with the new bit set point to the new bucket
+  PageId newPid;
+  if ((rc = allocate(newPid)) < 0) return rc;
+  for (unsigned i = 0; i < directory.size(); i++) {
+    if (directory[i] == pid && ((i >> depth) & 1)) directory[i] = newPid;
+  }
+
+  if ((rc = writeBucket(pid, depth + 1, keys[0], rids[0])) < 0) return rc;
+  return writeBucket(newPid, depth + 1, keys[1], rids[1]);
+}
+
+RC HashIndex::writeBucket(PageId pid, int depth, const vector<int>& keys,
+                          const vector<RecordId>& rids)
+{
+  RC           rc;
+  char         page[PageFile::PAGE_SIZE];
+  BucketHeader bh;
+  unsigned     i = 0;
+
+  do {
+    memset(page, 0, PageFile::PAGE_SIZE);
+    bh.localDepth = depth;
+    bh.count = 0;
+    for (; i < keys.size() && bh.count < BUCKET_ENTRIES; i++, bh.count++) {
+      char* entry = page + sizeof(bh) + bh.count*ENTRY_SIZE;
+      memcpy(entry, &keys[i], sizeof(int));
+      memcpy(entry + sizeof(int), &rids[i], sizeof(RecordId));
+    }
+    bh.overflow = -1;
+    if (i < keys.size() && (rc = allocate(bh.overflow)) < 0) return rc;
+    memcpy(page, &bh, sizeof(bh));
+    if ((rc = pf.write(pid, page)) < 0) return rc;
+    pid = bh.overflow;
+  } while (pid >= 0);
+
+  return 0;
+}
+
+RC HashIndex::allocate(PageId& pid)
+{
+  RC   rc;
+  char page[PageFile::PAGE_SIZE];
+
+  if (freeList < 0) {
+    pid = freePid++;
+    return 0;
+  }
+
+  // take the first free page. it stores the next one.
+  pid = freeList;
+  if ((rc = pf.read(pid, page)) < 0) return rc;
+  memcpy(&freeList, page, sizeof(PageId));
+  if (freeList < -1 || freeList == 0 || freeList >= freePid) return RC_INVALID_FILE_FORMAT;
+  return 0;
+}
+
+RC HashIndex::release(PageId pid)
+{
+  RC   rc;
+  char page[PageFile::PAGE_SIZE];
+
+  memset(page, 0, PageFile::PAGE_SIZE);
+  memcpy(page, &freeList, sizeof(PageId));
+  if ((rc = pf.write(pid, page)) < 0) return rc;
+  freeList = pid;
+  return 0;
+}
+
+RC HashIndex::getBucket(int slot, PageId& pid)
+{
+  RC   rc;
+  char page[PageFile::PAGE_SIZE];
+
+  if (!directory.empty()) {
+    pid = directory[slot];
+    return 0;
+  }
+
+  // read the directory page holding the slot
+  if ((rc = pf.read(dirPid + slot/DIR_ENTRIES, page)) < 0) return rc;
+  memcpy(&pid, page + (slot % DIR_ENTRIES)*sizeof(PageId), sizeof(PageId));
+  return 0;
+}
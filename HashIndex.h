@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef HASHINDEX_H
+#define HASHINDEX_H
+
+#include <string>
+#include <vector>
+#include "Bruinbase.h"
+#include "PageFile.h"
+#include "RecordFile.h"
+
+/**
+ * An extendible hashing index on the key column, for point lookups.
+ *
+ * The directory maps the low globalDepth bits of the key hash to a bucket
+ * page, and several directory slots may share a bucket whose local depth
+ * is lower. A full bucket is split into two on the next hash bit, doubling
+ * the directory if needed. If the next bit does not divide the entries,
+ * e.g. for duplicate keys, the bucket gets a chain of overflow pages.
+ *   page 0: header (global depth, directory pid, free pid, free list)
+ *           and the directory if it fits in the page
+ *   a bucket: [local depth][# entries][overflow pid][(key, rid) * # entries]
+ *   a free page: [next free page]
+ * The overflow pages of a split bucket are put on the free list, from
+ * which new buckets and overflow pages are taken before the file grows.
+ * A lookup reads the header page, the directory page if the directory
+ * does not fit in the header page, and the bucket.
+ */
+class HashIndex {
+ public:
+  HashIndex();
+
+  /**
+   * Open the index file in read or write mode.
+   * Under 'w' mode, the index file should be created if it does not exist.
+   * @param indexname[IN] the name of the index file
+   * @param mode[IN] 'r' for read, 'w' for write
+   * @return error code. 0 if no error
+   */
+  RC open(const std::string& indexname, char mode);
+
+  /**
+   * Close the index file. the directory is written to the disk.
+   * @return error code. 0 if no error
+   */
+  RC close();
+
+  /**
+   * Insert (key, RecordId) pair to the index.
+   * @param key[IN] the key for the value inserted into the index
+   * @param rid[IN] the RecordId for the record being inserted into the index
+   * @return error code. 0 if no error
+   */
+  RC insert(int key, const RecordId& rid);
+
+  /**
+   * Find the RecordIds of all entries with searchKey.
+   * @param searchKey[IN] the key to find
+   * @param rids[OUT] the RecordIds of the entries with searchKey
+   * @return 0 if searchKey is found. RC_NO_SUCH_RECORD if not found.
+   *         Otherwise, an error code
+   */
+  RC lookup(int searchKey, std::vector<RecordId>& rids);
+
+ private:
+  /**
+   * Split the bucket of a directory slot into two buckets on the next
+   * hash bit, doubling the directory if needed.
+   * @param slot[IN] a directory slot pointing to the bucket
+   * @return error code. 0 if no error
+   */
+  RC split(int slot);
+
+  /**
+   * Write entries into a bucket and as many overflow pages as needed.
+   * @param pid[IN] the bucket page
+   * @param depth[IN] the local depth of the bucket
+   * @param keys[IN] the keys of the entries
+   * @param rids[IN] the RecordIds of the entries
+   * @return error code. 0 if no error
+   */
+  RC writeBucket(PageId pid, int depth, const std::vector<int>& keys,
+                 const std::vector<RecordId>& rids);
+
+  /**
+   * Allocate a page, from the free list if it is not empty.
+   * @param pid[OUT] the allocated page
+   * @return error code. 0 if no error
+   */
+  RC allocate(PageId& pid);
+
+  /**
+   * Add a page to the free list.
+   * @param pid[IN] the page to free
+   * @return error code. 0 if no error
+   */
+  RC release(PageId pid);
+
+  /**
+   * Write the header and the directory to the disk.
+   * @return error code. 0 if no error
+   */
+  RC writeHeader();
+
+  /**
+   * @return the bucket page of a directory slot
+   */
+  RC getBucket(int slot, PageId& pid);
+
+  PageFile pf;           /// the PageFile used to store the index
+  char     mode;         /// the mode the file was opened in
+  int      globalDepth;  /// # hash bits used by the directory
+  PageId   dirPid;       /// the first directory page. -1 if in page 0
+  PageId   freePid;      /// the page where the next bucket is stored
+  PageId   freeList;     /// the first free page. -1 if none
+
+  /// the directory. only loaded under 'w' mode or if it is in page 0
+  std::vector<PageId> directory;
+};
+
+#endif /* HASHINDEX_H */
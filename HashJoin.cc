@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include <cstdio>
+#include "HashJoin.h"
+
+using namespace std;
+
+static const int INITIAL_SLOTS = 1024;  // # slots of a new hash table
+
+HashJoin::HashJoin(const string& prefix, int memoryBudget, int level)
+{
+  this->prefix = prefix;
+  this->memoryBudget = memoryBudget;
+  this->level = level;
+
+  Slot empty = { 0, -1 };
+  slots.assign(INITIAL_SLOTS, empty);
+  keyCount = 0;
+  memoryUsed = INITIAL_SLOTS * sizeof(Slot);
+  spilled = false;
+
+  for (int input = 0; input < 2; input++) {
+    for (int p = 0; p < PARTITION_COUNT; p++) {
+      partitions[input][p] = NULL;
+      written[input][p] = false;
+    }
+  }
+  nextPartition = 0;
+  child = NULL;
+  probing = false;
+  nextMatch = 0;
+}
+
+HashJoin::~HashJoin()
+{
+  if (probing) probeRun.close();
+  delete child;
+  for (int input = 0; input < 2; input++) {
+    for (int p = 0; p < PARTITION_COUNT; p++) {
+      if (partitions[input][p] != NULL) {
+        partitions[input][p]->close();
+        delete partitions[input][p];
+      }
+      if (written[input][p]) remove(partitionName(input, p).c_str());
+    }
+  }
+}
+
+RC HashJoin::build(int key, const string& value)
+{
+  // the build tuples that do not fit in memory go to the partitions
+  int size = sizeof(Entry) + value.size();
+  if (!spilled && level < MAX_LEVEL && memoryUsed + size > memoryBudget) {
+    RC rc;
+    if ((rc = spill()) < 0) return rc;
+  }
+  if (spilled) return write(0, key, value);
+
+  unsigned i = find(key);
+  Entry    e;
+  e.key = key;
+  e.value = value;
+  e.next = slots[i].first;
+  if (slots[i].first < 0) {
+    slots[i].key = key;
+    keyCount++;
+  }
+  slots[i].first = entries.size();
+  entries.push_back(e);
+  memoryUsed += size;
+
+  // keep the table at most half full
+  if (keyCount * 2 > slots.size()) grow();
+  return 0;
+}
+
+RC HashJoin::probe(int key, const string& value, vector<const string*>& matches)
+{
+  if (spilled) return write(1, key, value);
+
+  for (int e = slots[find(key)].first; e >= 0; e = entries[e].next) {
+    matches.push_back(&entries[e].value);
+  }
+  return 0;
+}
+
+RC HashJoin::finish()
+{
+  RC rc;
+
+  for (int input = 0; input < 2; input++) {
+    for (int p = 0; p < PARTITION_COUNT; p++) {
+      if (partitions[input][p] == NULL) continue;
+      rc = partitions[input][p]->close();
+      delete partitions[input][p];
+      partitions[input][p] = NULL;
+      if (rc < 0) return rc;
+    }
+  }
+  return 0;
+}
+
+RC HashJoin::next(int& key, string& buildValue, string& probeValue)
+{
+  RC rc;
+
+  for (;;) {
+    // the matches of the current probe tuple
+    if (nextMatch < matches.size()) {
+      key = probeKey;
+      buildValue = *matches[nextMatch++];
+      probeValue = this->probeValue;
+      return 0;
+    }
+
+    // the next tuple of the current probe partition
+    if (probing) {
+      if ((rc = probeRun.next(probeKey, this->probeValue)) == 0) {
+        matches.clear();
+        nextMatch = 0;
+        if ((rc = child->probe(probeKey, this->probeValue, matches)) < 0) return rc;
+        continue;
+      }
+      probeRun.close();
+      probing = false;
+      if (rc != RC_END_OF_TREE) return rc;
+      if ((rc = child->finish()) < 0) return rc;
+    }
+
+    // the matches of the tuples the current join spilled again
+    if (child != NULL) {
+      if ((rc = child->next(key, buildValue, probeValue)) != RC_END_OF_TREE) return rc;
+      delete child;
+      child = NULL;
+      for (int input = 0; input < 2; input++) {
+        remove(partitionName(input, nextPartition - 1).c_str());
+        written[input][nextPartition - 1] = false;
+      }
+    }
+
+    // a pair of partitions joins only if both have tuples
+    while (nextPartition < PARTITION_COUNT &&
+           !(written[0][nextPartition] && written[1][nextPartition])) {
+      nextPartition++;
+    }
+    if (nextPartition == PARTITION_COUNT) return RC_END_OF_TREE;
+
+    // build the join of the pair from the build partition
+    RunReader r;
+    int       k;
+    string    v;
+    int       p = nextPartition++;
+    child = new HashJoin(partitionName(0, p), memoryBudget, level + 1);
+    if ((rc = r.open(partitionName(0, p))) < 0) return rc;
+    while ((rc = r.next(k, v)) == 0) {
+      if ((rc = child->build(k, v)) < 0) break;
+    }
+    r.close();
+    if (rc != RC_END_OF_TREE) return rc;
+
+    if ((rc = probeRun.open(partitionName(1, p))) < 0) return rc;
+    probing = true;
+  }
+}
+
+unsigned HashJoin::hashOf(int key) const
+{
+  // the key mixed with a seed of the level, so that the tuples of a
+  // partition spread over all partitions of the next level
+  unsigned h = (unsigned) key ^ (level * 0x9e3779b9u);
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+unsigned HashJoin::find(int key) const
+{
+  unsigned mask = slots.size() - 1;
+  unsigned i = hashOf(key) & mask;
+
+  while (slots[i].first >= 0 && slots[i].key != key) i = (i + 1) & mask;
+  return i;
+}
+
+RC HashJoin::spill()
+{
+  RC rc;
+
+  spilled = true;
+  for (unsigned e = 0; e < entries.size(); e++) {
+    if ((rc = write(0, entries[e].key, entries[e].value)) < 0) return rc;
+  }
+
+  Slot empty = { 0, -1 };
+  vector<Entry>().swap(entries);
+  vector<Slot>().swap(slots);
+  slots.assign(INITIAL_SLOTS, empty);
+  keyCount = 0;
+  memoryUsed = INITIAL_SLOTS * sizeof(Slot);
+  return 0;
+}
+
+void HashJoin::grow()
+{
+  // move the slots to a table twice as large
+  Slot         empty = { 0, -1 };
+  vector<Slot> old(slots.size() * 2, empty);
+
+  old.swap(slots);
+  for (unsigned j = 0; j < old.size(); j++) {
+    if (old[j].first >= 0) slots[find(old[j].key)] = old[j];
+  }
+  memoryUsed += (slots.size() - old.size()) * sizeof(Slot);
+}
+
+RC HashJoin::write(int input, int key, const string& value)
+{
+  // the top bits of the hash choose the partition, the bottom bits the slot
+  int p = hashOf(key) >> 28;
+  RC  rc;
+
+  if (partitions[input][p] == NULL) {
+    partitions[input][p] = new RunWriter;
+    if ((rc = partitions[input][p]->open(partitionName(input, p))) < 0) return rc;
+    written[input][p] = true;
+  }
+  return partitions[input][p]->append(key, value);
+}
+
+string HashJoin::partitionName(int input, int p) const
+{
+  char suffix[16];
+  sprintf(suffix, ".%c%d", (input == 0) ? 'b' : 'p', p);
+  return prefix + suffix;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef HASHJOIN_H
+#define HASHJOIN_H
+
+#include <string>
+#include <vector>
+#include "Bruinbase.h"
+#include "RunFile.h"
+
+/**
+ * joins the (key, value) tuples of two inputs on key.
+ *
+ * The tuples of the build input, normally the smaller one, are kept in a
+ * hash table, and every tuple of the probe input looks up the build tuples
+ * with its key. The hash table uses open addressing with linear probing.
+ * A slot holds a key and the first of its build tuples, which are chained
+ * in a dense array.
+ *
+ * When the build tuples would take more memory than the budget, they are
+ * all written to PARTITION_COUNT partition files chosen by the hash of
+ * their key, and so are the probe tuples after them (grace hash join).
+ * Every pair of partitions is joined afterwards by another HashJoin,
+ * which hashes with a different seed and may spill again, up to
+ * MAX_LEVEL levels.
+ */
+class HashJoin {
+ public:
+  static const int PARTITION_COUNT = 16;  // # partitions of the spilled tuples
+  static const int MAX_LEVEL = 4;         // # times a tuple may be spilled
+
+  /**
+   * @param prefix[IN] the prefix of the names of the partition files
+   * @param memoryBudget[IN] # bytes of build tuples kept in memory
+   * @param level[IN] # times the tuples were spilled before
+   */
+  HashJoin(const std::string& prefix, int memoryBudget, int level = 0);
+
+  /**
+   * remove the partition files.
+   */
+  ~HashJoin();
+
+  /**
+   * add a tuple of the build input. all build tuples are added before
+   * the first probe tuple.
+   * @param key[IN] the key of the tuple
+   * @param value[IN] the value of the tuple
+   * @return error code. 0 if no error
+   */
+  RC build(int key, const std::string& value);
+
+  /**
+   * join a tuple of the probe input with the build tuples of its key.
+   * if the build tuples were spilled, the tuple is written to its
+   * partition instead, and its matches are read by next() after finish().
+   * @param key[IN] the key of the tuple
+   * @param value[IN] the value of the tuple
+   * @param matches[OUT] the values of the build tuples with the key.
+   *                     valid until the next call to build()
+   * @return error code. 0 if no error
+   */
+  RC probe(int key, const std::string& value, std::vector<const std::string*>& matches);
+
+  /**
+   * end probing, after which the matches of the spilled tuples are read
+   * by next().
+   * @return error code. 0 if no error
+   */
+  RC finish();
+
+  /**
+   * read the next match of the spilled tuples.
+   * @param key[OUT] the key of the match
+   * @param buildValue[OUT] the value of the build tuple
+   * @param probeValue[OUT] the value of the probe tuple
+   * @return 0 if a match is read, RC_END_OF_TREE after the last match,
+   *         or an error code
+   */
+  RC next(int& key, std::string& buildValue, std::string& probeValue);
+
+ private:
+  // a build tuple. next is the next tuple with the key, or -1
+  struct Entry {
+    int         key;
+    std::string value;
+    int         next;
+  };
+
+  // a slot of the hash table. first is -1 in an empty slot.
+  struct Slot {
+    int key;
+    int first;
+  };
+
+  unsigned hashOf(int key) const;
+
+  // the slot of the key, or the empty slot where it belongs
+  unsigned find(int key) const;
+
+  // write the build tuples in memory to their partitions
+  RC spill();
+
+  // double the hash table
+  void grow();
+
+  // write a tuple to a partition of the build (0) or probe (1) input
+  RC write(int input, int key, const std::string& value);
+
+  std::string partitionName(int input, int p) const;
+
+  std::string prefix;
+  int         memoryBudget;
+  int         level;
+
+  std::vector<Entry> entries;  // the build tuples in memory
+  std::vector<Slot>  slots;    // the hash table. the size is a power of 2
+  unsigned    keyCount;        // # keys in the hash table
+  int         memoryUsed;      // # bytes taken by the entries and the slots
+  bool        spilled;         // true once the build tuples go to partitions
+
+  RunWriter* partitions[2][PARTITION_COUNT];  // the spilled tuples, or NULL
+  bool       written[2][PARTITION_COUNT];     // true if a partition was written
+
+  int         nextPartition;   // the next pair of partitions joined by next()
+  HashJoin*   child;           // the join of the current pair of partitions
+  RunReader   probeRun;        // the probe partition of the current pair
+  bool        probing;         // true while probeRun is read
+  int         probeKey;        // the current probe tuple
+  std::string probeValue;
+  std::vector<const std::string*> matches;  // the matches of the probe tuple
+  unsigned    nextMatch;       // the next match returned by next()
+};
+
+#endif // HASHJOIN_H
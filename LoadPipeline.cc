@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include "LoadPipeline.h"
+#include "LoadTokenizer.h"
+
+using namespace std;
+
+LoadPipeline::LoadPipeline(const string& loadfile, const string& sortPrefix, int sortMemory)
+  : keys(sortPrefix, 1, false, sortMemory)
+{
+  this->loadfile = loadfile;
+  fd = -1;
+  data = NULL;
+  size = 0;
+  btree = NULL;
+  hash = NULL;
+  maxAhead = 0;
+
+  claimed = 0;
+  chunksClaimed = 0;
+  nextChunk = 0;
+  indexing = false;
+  finishing = false;
+  indexRc = 0;
+  stopping = false;
+
+  pthread_mutex_init(&lock, NULL);
+  pthread_cond_init(&parsed, NULL);
+  pthread_cond_init(&room, NULL);
+  pthread_cond_init(&indexable, NULL);
+  pthread_cond_init(&indexed, NULL);
+}
+
+LoadPipeline::~LoadPipeline()
+{
+  pthread_mutex_lock(&lock);
+  stopping = true;
+  pthread_cond_broadcast(&room);
+  pthread_cond_broadcast(&indexable);
+  pthread_cond_broadcast(&indexed);
+  pthread_mutex_unlock(&lock);
+
+  for (unsigned i = 0; i < threads.size(); i++) pthread_join(threads[i], NULL);
+
+  for (map<long long, Chunk*>::iterator it = done.begin(); it != done.end(); ++it) {
+    delete it->second;
+  }
+  for (unsigned i = 0; i < toIndex.size(); i++) delete toIndex[i];
+  if (data != NULL) munmap((void*) data, size);
+  if (fd >= 0) ::close(fd);
+
+  pthread_cond_destroy(&indexed);
+  pthread_cond_destroy(&indexable);
+  pthread_cond_destroy(&room);
+  pthread_cond_destroy(&parsed);
+  pthread_mutex_destroy(&lock);
+}
+
+RC LoadPipeline::open()
+{
+  struct stat st;
+
+  // map the whole file. an empty file has no mapping and no chunks.
+  if ((fd = ::open(loadfile.c_str(), O_RDONLY)) < 0) return RC_FILE_OPEN_FAILED;
+  if (fstat(fd, &st) < 0) return RC_FILE_OPEN_FAILED;
+  size = st.st_size;
+  if (size > 0) {
+    void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) return RC_FILE_READ_FAILED;
+    data = (const char*) p;
+    madvise(p, size, MADV_SEQUENTIAL);
+  }
+  return 0;
+}
+
+RC LoadPipeline::start(int parsers, BTreeIndex* btree, HashIndex* hash)
+{
+  pthread_t t;
+
+  if (parsers < 1) parsers = 1;
+  if (parsers > MAX_THREADS) parsers = MAX_THREADS;
+  this->btree = btree;
+  this->hash = hash;
+  maxAhead = MAX_AHEAD * parsers;
+
+  // the pipeline needs a parser and the builder of the indexes
+  if (btree != NULL || hash != NULL) {
+    if (pthread_create(&t, NULL, runBuilder, this) != 0) return RC_FILE_WRITE_FAILED;
+    threads.push_back(t);
+  }
+  for (int i = 0; i < parsers; i++) {
+    if (pthread_create(&t, NULL, runParser, this) != 0) {
+      if (i == 0) return RC_FILE_READ_FAILED;
+      break;
+    }
+    threads.push_back(t);
+  }
+  return 0;
+}
+
+RC LoadPipeline::next(vector<Record>& records)
+{
+  pthread_mutex_lock(&lock);
+  while (done.count(nextChunk) == 0 && !(claimed == size && nextChunk == chunksClaimed)) {
+    pthread_cond_wait(&parsed, &lock);
+  }
+  if (done.count(nextChunk) == 0) {
+    pthread_mutex_unlock(&lock);
+    return RC_END_OF_TREE;
+  }
+  Chunk* c = done[nextChunk];
+  done.erase(nextChunk++);
+  pthread_cond_broadcast(&room);
+  pthread_mutex_unlock(&lock);
+
+  RC rc = c->rc;
+  records.swap(c->records);
+  delete c;
+  return rc;
+}
+
+RC LoadPipeline::index(vector<int>& keys, vector<RecordId>& rids)
+{
+  IndexBatch* b = new IndexBatch;
+  b->keys.swap(keys);
+  b->rids.swap(rids);
+
+  pthread_mutex_lock(&lock);
+  while ((int) toIndex.size() >= MAX_AHEAD && indexRc == 0) {
+    pthread_cond_wait(&indexed, &lock);
+  }
+  RC rc = indexRc;
+  if (rc == 0) {
+    toIndex.push_back(b);
+    pthread_cond_signal(&indexable);
+  } else {
+    delete b;
+  }
+  pthread_mutex_unlock(&lock);
+  return rc;
+}
+
+RC LoadPipeline::finish()
+{
+  pthread_mutex_lock(&lock);
+  finishing = true;
+  pthread_cond_signal(&indexable);
+  while ((!toIndex.empty() || indexing) && indexRc == 0) {
+    pthread_cond_wait(&indexed, &lock);
+  }
+  RC rc = indexRc;
+  pthread_mutex_unlock(&lock);
+
+  // pairs with equal keys come out of the sort in the order of the file
+  if (rc == 0 && btree != NULL && (rc = keys.finish()) == 0) rc = btree->merge(keys);
+  return rc;
+}
+
+void* LoadPipeline::runParser(void* arg)
+{
+  ((LoadPipeline*) arg)->parse();
+  return NULL;
+}
+
+void* LoadPipeline::runBuilder(void* arg)
+{
+  ((LoadPipeline*) arg)->build();
+  return NULL;
+}
+
+void LoadPipeline::parse()
+{
+  pthread_mutex_lock(&lock);
+  for (;;) {
+    while (claimed < size && chunksClaimed - nextChunk >= maxAhead && !stopping) {
+      pthread_cond_wait(&room, &lock);
+    }
+    if (claimed == size || stopping) break;
+
+    // claim the lines of the next chunk. the chunk ends at the first
+    // line break after CHUNK_SIZE bytes.
+    Chunk* c = new Chunk;
+    size_t end = claimed + CHUNK_SIZE;
+    if (end < size) {
+      const char* nl = (const char*) memchr(data + end, '\n', size - end);
+      end = (nl != NULL) ? nl + 1 - data : size;
+    } else {
+      end = size;
+    }
+    c->begin = data + claimed;
+    c->end = data + end;
+    claimed = end;
+    long long seq = chunksClaimed++;
+    pthread_mutex_unlock(&lock);
+
+    parseChunk(*c);
+
+    pthread_mutex_lock(&lock);
+    done[seq] = c;
+    pthread_cond_broadcast(&parsed);
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+void LoadPipeline::build()
+{
+  RC rc = 0;
+
+  pthread_mutex_lock(&lock);
+  for (;;) {
+    while (toIndex.empty() && !finishing && !stopping) {
+      pthread_cond_wait(&indexable, &lock);
+    }
+    if (toIndex.empty() || stopping) break;
+    IndexBatch* b = toIndex.front();
+    toIndex.pop_front();
+    indexing = true;
+    pthread_mutex_unlock(&lock);
+
+    for (unsigned i = 0; i < b->keys.size() && rc == 0; i++) {
+      if (btree != NULL) {
+        string rid((const char*) &b->rids[i], sizeof(RecordId));
+        if ((rc = keys.add(b->keys[i], rid)) < 0) break;
+      }
+      if (hash != NULL && (rc = hash->insert(b->keys[i], b->rids[i])) < 0) break;
+    }
+    delete b;
+
+    pthread_mutex_lock(&lock);
+    indexing = false;
+    if (rc < 0) indexRc = rc;
+    pthread_cond_broadcast(&indexed);
+    if (rc < 0) break;
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+void LoadPipeline::parseChunk(Chunk& c) const
+{
+  LoadTokenizer tokenizer(c.begin, c.end);
+  Record        r;
+  RC            rc;
+
+  // the records before a line that cannot be parsed are kept
+  while ((rc = tokenizer.next(r)) == 0) c.records.push_back(r);
+  c.rc = (rc == RC_END_OF_TREE) ? 0 : rc;
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef LOADPIPELINE_H
+#define LOADPIPELINE_H
+
+#include <pthread.h>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include "Bruinbase.h"
+#include "RecordFile.h"
+#include "BTreeIndex.h"
+#include "HashIndex.h"
+#include "ExternalSorter.h"
+
+/**
+ * parses a load file with a pipeline of threads.
+ *
+ * The load file is mapped into memory, and the kernel reads it ahead of
+ * the parsers. A pool of parser threads claims chunks of about
+ * CHUNK_SIZE bytes, each ending at a line break, and turns their lines
+ * into records with a LoadTokenizer. The values of the
+ * records point into the mapping, so nothing is copied until the
+ * records are written to the table. The caller takes the records of the
+ * chunks in file order with next() and appends them to the table, and
+ * hands the (key, RecordId) pairs to an index builder thread with
+ * index(), which inserts them into the hash index of the table and sorts
+ * them for the key index. finish() merges the sorted pairs into the key
+ * index in bulk (see BTreeIndex::merge()). The parsers
+ * stay at most MAX_AHEAD chunks per parser ahead of the caller, and the
+ * caller at most MAX_AHEAD batches ahead of the index builder.
+ */
+class LoadPipeline {
+ public:
+  static const int CHUNK_SIZE = 1 << 20;  // # bytes parsed at a time
+  static const int MAX_THREADS = 64;      // the largest # parser threads
+  static const int MAX_AHEAD = 4;         // # chunks waiting per parser
+
+  /**
+   * @param loadfile[IN] the load file
+   * @param sortPrefix[IN] the prefix of the run files of the key index sort
+   * @param sortMemory[IN] # bytes the key index sort keeps in memory
+   */
+  LoadPipeline(const std::string& loadfile, const std::string& sortPrefix, int sortMemory);
+
+  /**
+   * stop the threads, free the chunks not taken and unmap the file.
+   */
+  ~LoadPipeline();
+
+  /**
+   * map the load file.
+   * @return error code. 0 if no error
+   */
+  RC open();
+
+  /**
+   * start the threads on the load file mapped by open().
+   * @param parsers[IN] # parser threads
+   * @param btree[IN] the key index the tuples are merged into, or NULL
+   * @param hash[IN] the hash index the tuples are inserted into, or NULL
+   * @return error code. 0 if no error
+   */
+  RC start(int parsers, BTreeIndex* btree, HashIndex* hash);
+
+  /**
+   * take the records of the next chunk. their values stay valid until
+   * the pipeline is destroyed.
+   * @param records[OUT] the records of the chunk
+   * @return 0 if records are taken, RC_END_OF_TREE after the last chunk,
+   *         or RC_INVALID_FILE_FORMAT if the line after the records taken
+   *         cannot be parsed
+   */
+  RC next(std::vector<Record>& records);
+
+  /**
+   * insert tuples into the indexes in the background.
+   * @param keys[IN/OUT] the keys of the tuples. left empty
+   * @param rids[IN/OUT] the RecordIds of the tuples. left empty
+   * @return error code of the insertions so far. 0 if no error
+   */
+  RC index(std::vector<int>& keys, std::vector<RecordId>& rids);
+
+  /**
+   * wait for the index builder to insert all tuples, and merge them into
+   * the key index.
+   * @return error code of the insertions. 0 if no error
+   */
+  RC finish();
+
+ private:
+  // a chunk of the load file and its records
+  struct Chunk {
+    const char*         begin;    // the lines of the chunk
+    const char*         end;
+    RC                  rc;       // the error of the line after the records
+    std::vector<Record> records;
+  };
+
+  // the tuples of a batch of index insertions
+  struct IndexBatch {
+    std::vector<int>      keys;
+    std::vector<RecordId> rids;
+  };
+
+  static void* runParser(void* arg);
+  static void* runBuilder(void* arg);
+
+  // parse chunks until none is left
+  void parse();
+
+  // insert the batches of index() until finish()
+  void build();
+
+  // parse the lines of a chunk
+  void parseChunk(Chunk& c) const;
+
+  std::string loadfile;
+  int         fd;
+  const char* data;       // the mapped load file
+  size_t      size;       // the size of the load file
+  BTreeIndex* btree;
+  HashIndex*  hash;
+  ExternalSorter keys;    // the (key, RecordId) pairs for the key index
+  int         maxAhead;   // # chunks claimed but not taken
+
+  std::vector<pthread_t> threads;
+
+  pthread_mutex_t lock;       // guards the queues and the counters
+  pthread_cond_t  parsed;     // signaled when a chunk is parsed
+  pthread_cond_t  room;       // signaled when a chunk is taken
+  pthread_cond_t  indexable;  // signaled when a batch is given to index()
+  pthread_cond_t  indexed;    // signaled when a batch is inserted
+
+  size_t    claimed;        // # bytes of the file claimed by the parsers
+  std::map<long long, Chunk*> done;   // the chunks parsed, by #
+  long long chunksClaimed;  // # chunks claimed
+  long long nextChunk;      // # chunks taken
+
+  std::deque<IndexBatch*> toIndex;   // the batches to insert
+  bool      indexing;       // true while a batch is inserted
+  bool      finishing;      // true once finish() is called
+  RC        indexRc;        // the error of the index builder
+
+  bool      stopping;       // true once the pipeline is destroyed
+};
+
+#endif // LOADPIPELINE_H
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include <cctype>
+#include <climits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "LoadTokenizer.h"
+
+LoadTokenizer::LoadTokenizer(const char* begin, const char* end)
+{
+  this->line = begin;
+  this->end = end;
+  this->base = begin;
+  classify();
+}
+
+RC LoadTokenizer::next(Record& record)
+{
+  const char* s;
+  const char* p;
+  char        c;
+
+  if (line >= end) return RC_END_OF_TREE;
+
+  // the key ends at the first comma of the line
+  for (p = nextSpecial(line); p < end && *p != ',' && *p != '\n'; p = nextSpecial(p + 1)) ;
+  if (p == end || *p == '\n') {
+    line = (p == end) ? end : p + 1;
+    return RC_INVALID_FILE_FORMAT;
+  }
+  for (s = line; *s == ' ' || *s == '\t'; s++) ;
+  record.key = parseKey(s, p);
+
+  // ignore white spaces
+  for (s = p + 1; s < end && (*s == ' ' || *s == '\t'); s++) ;
+  record.value = s;
+
+  // is the value field delimited by ' or "? then it ends at the next
+  // one, or else at the end of the line
+  c = (s < end) ? *s : '\n';
+  if (c == '\'' || c == '"') {
+    record.value = ++s;
+  } else {
+    c = '\n';
+  }
+  for (p = nextSpecial(s); p < end && *p != c && *p != '\n'; p = nextSpecial(p + 1)) ;
+  record.length = p - record.value;
+
+  // skip the rest of the line
+  while (p < end && *p != '\n') p = nextSpecial(p + 1);
+  line = (p == end) ? end : p + 1;
+  return 0;
+}
+
+int LoadTokenizer::parseKey(const char* s, const char* end)
+{
+  // the digits saturate past the range of long, which is then cut to int
+  unsigned long long n = 0;
+  bool               negative = false;
+
+  while (s < end && isspace((unsigned char) *s)) s++;
+  if (s < end && (*s == '+' || *s == '-')) negative = (*s++ == '-');
+  for (; s < end && *s >= '0' && *s <= '9'; s++) {
+    if (n >= 1000000000000000000ull) n = ULLONG_MAX;
+    else n = n * 10 + (*s - '0');
+  }
+
+  long v;
+  if (negative) v = (n > (unsigned long long) LONG_MAX + 1) ? LONG_MIN : (long) (0 - n);
+  else v = (n > (unsigned long long) LONG_MAX) ? LONG_MAX : (long) n;
+  return (int) v;
+}
+
+const char* LoadTokenizer::nextSpecial(const char* from)
+{
+  // the blocks are only moved forward, and the bits before from dropped
+  while (from >= base + BLOCK_SIZE) {
+    base += BLOCK_SIZE;
+    classify();
+  }
+  if (from > base) mask &= ~0ull << (from - base);
+
+  while (mask == 0) {
+    if (end - base <= BLOCK_SIZE) return end;
+    base += BLOCK_SIZE;
+    classify();
+  }
+  return base + __builtin_ctzll(mask);
+}
+
+void LoadTokenizer::classify()
+{
+  mask = 0;
+  if (base >= end) return;
+
+#ifdef __SSE2__
+  if (end - base >= BLOCK_SIZE) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i dq = _mm_set1_epi8('"');
+    const __m128i sq = _mm_set1_epi8('\'');
+    for (int i = 0; i < BLOCK_SIZE; i += 16) {
+      __m128i b = _mm_loadu_si128((const __m128i*) (base + i));
+      __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(b, nl), _mm_cmpeq_epi8(b, comma)),
+                               _mm_or_si128(_mm_cmpeq_epi8(b, dq), _mm_cmpeq_epi8(b, sq)));
+      mask |= (unsigned long long) (unsigned) _mm_movemask_epi8(m) << i;
+    }
+    return;
+  }
+#endif
+
+  // the last block of the lines, or every block without SSE2
+  int n = (end - base < BLOCK_SIZE) ? end - base : BLOCK_SIZE;
+  for (int i = 0; i < n; i++) {
+    char c = base[i];
+    if (c == '\n' || c == ',' || c == '"' || c == '\'') mask |= 1ull << i;
+  }
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef LOADTOKENIZER_H
+#define LOADTOKENIZER_H
+
+#include "Bruinbase.h"
+#include "RecordFile.h"
+
+/**
+ * splits the lines of a load file in memory into records.
+ *
+ * Every line holds a tuple as "key, value", where the value may be
+ * delimited by ' or ", so that "Last Ride, The" is a single value. The
+ * tokenizer classifies BLOCK_SIZE bytes at a time, with SSE2 where the
+ * compiler supports it, into a bitmask of the bytes that matter: line
+ * breaks, commas and quotes. The fields of a line are then found by
+ * walking the set bits of the masks instead of the bytes of the line.
+ */
+class LoadTokenizer {
+ public:
+  static const int BLOCK_SIZE = 64;  // # bytes classified at a time
+
+  /**
+   * @param begin[IN] the first character of the lines
+   * @param end[IN] the end of the lines
+   */
+  LoadTokenizer(const char* begin, const char* end);
+
+  /**
+   * split the next line into a record.
+   * @param record[OUT] the record of the line. its value points into the line
+   * @return 0 if a record is returned, RC_END_OF_TREE after the last line,
+   *         or RC_INVALID_FILE_FORMAT if the line has no comma
+   */
+  RC next(Record& record);
+
+  /**
+   * convert the integer at the start of a field as atoi() does.
+   * @param s[IN] the first character of the field
+   * @param end[IN] the end of the field
+   * @return the integer
+   */
+  static int parseKey(const char* s, const char* end);
+
+ private:
+  // return the next line break, comma or quote at or after from, or end
+  // if there is none
+  const char* nextSpecial(const char* from);
+
+  // set the bitmask of the special bytes of the block at base
+  void classify();
+
+  const char*        line;   // the first character of the next line
+  const char*        end;
+  const char*        base;   // the first character of the current block
+  unsigned long long mask;   // the special bytes of the block not returned
+};
+
+#endif // LOADTOKENIZER_H
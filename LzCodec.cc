@@ -0,0 +1,154 @@
+/**
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "LzCodec.h"
+#include <cstring>
+
+// # bits of the match-finder hash table
+static const int HASH_BITS = 12;
+
+// read four bytes at p
+static unsigned read32(const char* p);
+
+// hash four bytes into the match-finder table
+static int hash32(unsigned seq);
+
+// write a literal or match length that does not fit in the token nibble
+static int writeLength(char* dst, int op, int len);
+
+// write a sequence of literals followed by a match.
+// the match is omitted if matchLen is zero (the last sequence).
+static int writeSequence(char* dst, int op, const char* lit, int litLen,
+                         int offset, int matchLen);
+
+
+int LzCodec::compress(const char* src, int srcLen, char* dst)
+{
+  int table[1 << HASH_BITS];
+  int ip = 0;      // the current input position
+  int anchor = 0;  // the first input byte not yet written to dst
+  int op = 0;      // the current output position
+
+  memset(table, -1, sizeof(table));
+
+  // greedily look for the longest match at each position
+  while (ip + MIN_MATCH <= srcLen) {
+    unsigned seq = read32(src + ip);
+    int h = hash32(seq);
+    int ref = table[h];
+    table[h] = ip;
+
+    if (ref < 0 || ip - ref > MAX_OFFSET || read32(src + ref) != seq) {
+      ip++;
+      continue;
+    }
+
+    // extend the match as far as possible
+    int len = MIN_MATCH;
+    while (ip + len < srcLen && src[ref + len] == src[ip + len]) len++;
+
+    op = writeSequence(dst, op, src + anchor, ip - anchor, ip - ref, len);
+    ip += len;
+    anchor = ip;
+  }
+
+  // the rest of the input is written as literals
+  return writeSequence(dst, op, src + anchor, srcLen - anchor, 0, 0);
+}
+
+int LzCodec::decompress(const char* src, int srcLen, char* dst, int dstCap)
+{
+  const unsigned char* in = (const unsigned char*) src;
+  int ip = 0;
+  int op = 0;
+
+  while (ip < srcLen) {
+    int token = in[ip++];
+
+    // copy the literals
+    int litLen = token >> 4;
+    if (litLen == 15) {
+      int b;
+      do {
+        if (ip >= srcLen) return -1;
+        b = in[ip++];
+        litLen += b;
+      } while (b == 255);
+    }
+    if (ip + litLen > srcLen || op + litLen > dstCap) return -1;
+    memcpy(dst + op, src + ip, litLen);
+    ip += litLen;
+    op += litLen;
+
+    // the last sequence has no match
+    if (ip == srcLen) break;
+
+    // copy the match. it may overlap with the output being written.
+    if (ip + 2 > srcLen) return -1;
+    int offset = in[ip] | (in[ip + 1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > op) return -1;
+
+    int matchLen = (token & 15) + MIN_MATCH;
+    if ((token & 15) == 15) {
+      int b;
+      do {
+        if (ip >= srcLen) return -1;
+        b = in[ip++];
+        matchLen += b;
+      } while (b == 255);
+    }
+    if (op + matchLen > dstCap) return -1;
+    for (int i = 0; i < matchLen; i++, op++) {
+      dst[op] = dst[op - offset];
+    }
+  }
+
+  return op;
+}
+
+static unsigned read32(const char* p)
+{
+  unsigned v;
+  memcpy(&v, p, sizeof(unsigned));
+  return v;
+}
+
+static int hash32(unsigned seq)
+{
+  return (seq * 2654435761U) >> (32 - HASH_BITS);
+}
+
+static int writeLength(char* dst, int op, int len)
+{
+  while (len >= 255) {
+    dst[op++] = (char) 255;
+    len -= 255;
+  }
+  dst[op++] = (char) len;
+  return op;
+}
+
+static int writeSequence(char* dst, int op, const char* lit, int litLen,
+                         int offset, int matchLen)
+{
+  int m = (matchLen > 0) ? matchLen - LzCodec::MIN_MATCH : 0;
+
+  // the token holds both lengths, up to 15 each
+  dst[op++] = (char) (((litLen < 15 ? litLen : 15) << 4) | (m < 15 ? m : 15));
+  if (litLen >= 15) op = writeLength(dst, op, litLen - 15);
+
+  memcpy(dst + op, lit, litLen);
+  op += litLen;
+
+  if (matchLen > 0) {
+    dst[op++] = (char) (offset & 0xff);
+    dst[op++] = (char) (offset >> 8);
+    if (m >= 15) op = writeLength(dst, op, m - 15);
+  }
+
+  return op;
+}
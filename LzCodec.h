@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef LZCODEC_H
+#define LZCODEC_H
+
+/**
+ * A fast LZ77 block codec in the style of LZ4.
+ * The compressed block is a sequence of
+ *   [token][literal length bytes][literals][offset (2 bytes)][match length bytes]
+ * where the high 4 bits of the token is the literal length and the low
+ * 4 bits is (match length - MIN_MATCH). A value of 15 in either nibble is
+ * followed by extra length bytes (255 means "more follows"). The last
+ * sequence has only literals.
+ */
+class LzCodec {
+ public:
+  static const int MIN_MATCH = 4;        // the shortest match encoded
+  static const int MAX_OFFSET = 65535;   // the farthest match encoded
+
+  /**
+   * @param srcLen[IN] the size of the input to compress
+   * @return the largest possible size of the compressed block
+   */
+  static int compressBound(int srcLen) { return srcLen + srcLen/255 + 16; }
+
+  /**
+   * compress a block of memory.
+   * @param src[IN] the data to compress
+   * @param srcLen[IN] the size of the data
+   * @param dst[OUT] the buffer for the compressed block.
+   *                 it must hold at least compressBound(srcLen) bytes.
+   * @return the size of the compressed block
+   */
+  static int compress(const char* src, int srcLen, char* dst);
+
+  /**
+   * decompress a block produced by compress().
+   * @param src[IN] the compressed block
+   * @param srcLen[IN] the size of the compressed block
+   * @param dst[OUT] the buffer for the decompressed data
+   * @param dstCap[IN] the size of dst
+   * @return the size of the decompressed data. -1 if the block is corrupt
+   *         or does not fit in dst
+   */
+  static int decompress(const char* src, int srcLen, char* dst, int dstCap);
+};
+
+#endif // LZCODEC_H
@@ -11,6 +11,7 @@
 #include "PageFile.h"
 #include <cstring>
 #include <fcntl.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -21,6 +22,10 @@ int PageFile::writeCount = 0;
 int PageFile::cacheClock = 1;
 struct PageFile::cacheStruct PageFile::readCache[PageFile::CACHE_COUNT];
 
+// guards the cache and the counters, which the threads of a parallel
+// scan or load share
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+
 PageFile::PageFile() 
 { 
   fd = -1; 
@@ -72,10 +77,9 @@ RC PageFile::close()
 {
   if (fd <= 0) return RC_FILE_CLOSE_FAILED;
 
-  // close the file
-  if (::close(fd) < 0) return RC_FILE_CLOSE_FAILED;
-
-  // evict all cached pages for this file
+  // evict all cached pages for this file, before its descriptor may be
+  // reused by another thread
+  pthread_mutex_lock(&cacheLock);
   for (int i = 0; i < CACHE_COUNT; i++) {
     if (readCache[i].fd == fd && readCache[i].lastAccessed != 0) {
        readCache[i].fd = 0;
@@ -83,6 +87,10 @@ RC PageFile::close()
        readCache[i].lastAccessed = 0;
     }
   }
+  pthread_mutex_unlock(&cacheLock);
+
+  // close the file
+  if (::close(fd) < 0) return RC_FILE_CLOSE_FAILED;
 
   // set the fd and epid to the initial state
   fd = -1; 
@@ -112,6 +120,7 @@ RC PageFile::write(PageId pid, const void* buffer)
   if (::write(fd, buffer, PAGE_SIZE) < 0) return RC_FILE_WRITE_FAILED;
 
   // if the page is in read cache, invalidate it
+  pthread_mutex_lock(&cacheLock);
   for (int i = 0; i < CACHE_COUNT; i++) {
     if (readCache[i].fd == fd && readCache[i].pid == pid &&
         readCache[i].lastAccessed != 0) {
@@ -122,37 +131,43 @@ RC PageFile::write(PageId pid, const void* buffer)
     }
   }
 
-  // if the written pid >= end pid, update the end pid
-  if (pid >= epid) epid = pid + 1;
-
   // increase page write count
   writeCount++;
+  pthread_mutex_unlock(&cacheLock);
+
+  // if the written pid >= end pid, update the end pid
+  if (pid >= epid) epid = pid + 1;
 
   return 0;
 }
 
 RC PageFile::read(PageId pid, void* buffer) const
 {
-  RC rc;
-
   if (pid < 0 || pid >= epid) return RC_INVALID_PID; 
 
   //
   // if the page is in cache, read it from there
   //
+  pthread_mutex_lock(&cacheLock);
   for (int i = 0; i < CACHE_COUNT; i++) {
     if (readCache[i].fd == fd && readCache[i].pid == pid && 
         readCache[i].lastAccessed != 0) {
        memcpy(buffer, readCache[i].buffer, PAGE_SIZE);
        readCache[i].lastAccessed = ++cacheClock;
+       pthread_mutex_unlock(&cacheLock);
        return 0;
     }
   }
+  pthread_mutex_unlock(&cacheLock);
 
-  // seek to the page
-  if ((rc = seek(pid)) < 0) return rc;
-  
-  // find the cache slot to evict
+  // read the page at its offset without holding the lock. pread() does
+  // not move the file position, which the threads sharing fd would race on
+  if (::pread(fd, buffer, PAGE_SIZE, (off_t) pid * PAGE_SIZE) < 0) {
+    return RC_FILE_READ_FAILED;
+  }
+
+  // find the cache slot to evict and copy the page to it
+  pthread_mutex_lock(&cacheLock);
   int toEvict = 0; 
   for (int i = 0; i < CACHE_COUNT; i++) {
     if (readCache[i].lastAccessed == 0) {
@@ -166,15 +181,11 @@ RC PageFile::read(PageId pid, void* buffer) const
   readCache[toEvict].fd = fd;
   readCache[toEvict].pid = pid;
   readCache[toEvict].lastAccessed = ++cacheClock;
- 
-  // read the page to cache first and copy it to the buffer
-  if (::read(fd, readCache[toEvict].buffer, PAGE_SIZE) < 0) {
-    return RC_FILE_READ_FAILED;
-  }
-  memcpy(buffer, readCache[toEvict].buffer, PAGE_SIZE);
+  memcpy(readCache[toEvict].buffer, buffer, PAGE_SIZE);
 
   // increase the page read count
   readCount++;
+  pthread_mutex_unlock(&cacheLock);
 
   return 0;
 }
@@ -42,7 +42,8 @@ class PageFile {
   RC close();
   
   /**
-   * read a disk page into memory buffer.
+   * read a disk page into memory buffer. several threads may read the
+   * pages of a file at once, as long as none writes to it.
    * @param pid[IN] the page to read
    * @param buffer[OUT] pointer to memory buffer
    * @return error code. 0 if no error
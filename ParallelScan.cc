@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "ParallelScan.h"
+
+using namespace std;
+
+ParallelScan::ParallelScan(const string& filename, const BatchFilter& filter,
+                           const char* valueEq, bool ordered, bool countOnly)
+  : filter(filter)
+{
+  this->filename = filename;
+  this->lo = 0;
+  this->hi = 0;
+  this->valueEq = valueEq;
+  this->indexOnly = false;
+  this->ordered = ordered;
+  this->countOnly = countOnly;
+  init();
+}
+
+ParallelScan::ParallelScan(const string& filename, const string& indexname,
+                           int lo, int hi, const BatchFilter& filter, bool indexOnly,
+                           bool ordered, bool countOnly)
+  : filter(filter)
+{
+  this->filename = filename;
+  this->indexname = indexname;
+  this->lo = lo;
+  this->hi = hi;
+  this->valueEq = NULL;
+  this->indexOnly = indexOnly;
+  this->ordered = ordered;
+  this->countOnly = countOnly;
+  init();
+}
+
+void ParallelScan::init()
+{
+  endPid = 0;
+  morselCount = 0;
+  maxAhead = 0;
+  nextResult = 0;
+  running = 0;
+  stopping = false;
+
+  pthread_mutex_init(&lock, NULL);
+  pthread_cond_init(&ready, NULL);
+  pthread_cond_init(&room, NULL);
+}
+
+ParallelScan::~ParallelScan()
+{
+  pthread_mutex_lock(&lock);
+  stopping = true;
+  pthread_cond_broadcast(&room);
+  pthread_mutex_unlock(&lock);
+
+  for (unsigned i = 0; i < threads.size(); i++) pthread_join(threads[i], NULL);
+
+  for (unsigned i = 0; i < results.size(); i++) delete results[i];
+  for (unsigned i = 0; i < finished.size(); i++) delete finished[i];
+  for (unsigned i = 0; i < files.size(); i++) {
+    files[i]->close();
+    delete files[i];
+  }
+  for (unsigned i = 0; i < indexes.size(); i++) {
+    indexes[i]->close();
+    delete indexes[i];
+  }
+
+  pthread_cond_destroy(&room);
+  pthread_cond_destroy(&ready);
+  pthread_mutex_destroy(&lock);
+}
+
+RC ParallelScan::start(int threadCount)
+{
+  RC rc;
+
+  if (threadCount < 1) threadCount = 1;
+  if (threadCount > MAX_THREADS) threadCount = MAX_THREADS;
+
+  // every thread reads through its own file, which keeps its own
+  // decompressed extent, and its own index cursor
+  RecordFile* rf = new RecordFile;
+  files.push_back(rf);
+  if ((rc = rf->open(filename, 'r')) < 0) return rc;
+  endPid = rf->endPid();
+  if (indexname.empty()) {
+    morselCount = (endPid + MORSEL_PAGES - 1) / MORSEL_PAGES;
+  } else {
+    BTreeIndex* index = new BTreeIndex;
+    indexes.push_back(index);
+    if ((rc = index->open(indexname, 'r')) < 0) return rc;
+    if ((rc = index->splitRange(lo, hi, threadCount * MAX_AHEAD, bounds)) < 0) return rc;
+    morselCount = bounds.size() + 1;
+  }
+  if (threadCount > morselCount) threadCount = morselCount;
+  for (int i = 1; i < threadCount; i++) {
+    rf = new RecordFile;
+    files.push_back(rf);
+    if ((rc = rf->open(filename, 'r')) < 0) return rc;
+    if (!indexname.empty()) {
+      BTreeIndex* index = new BTreeIndex;
+      indexes.push_back(index);
+      if ((rc = index->open(indexname, 'r')) < 0) return rc;
+    }
+  }
+
+  maxAhead = MAX_AHEAD * threadCount;
+  if (ordered) results.assign(morselCount, (Result*) NULL);
+
+  // deal the morsels to the threads
+  queues.resize(threadCount);
+  for (int m = 0; m < morselCount; m++) {
+    if (ordered) queues[m % threadCount].push_back(m);
+    else queues[(long long) m * threadCount / morselCount].push_back(m);
+  }
+
+  workers.resize(threadCount);
+  for (int i = 0; i < threadCount; i++) {
+    workers[i].scan = this;
+    workers[i].id = i;
+  }
+
+  // the morsels of a thread that fails to start are stolen by the others
+  for (int i = 0; i < threadCount; i++) {
+    pthread_t t;
+    if (pthread_create(&t, NULL, run, &workers[i]) != 0) break;
+    threads.push_back(t);
+  }
+  return threads.empty() ? RC_FILE_OPEN_FAILED : 0;
+}
+
+RC ParallelScan::next(RowBatch& batch, int& count)
+{
+  Result* r;
+
+  pthread_mutex_lock(&lock);
+  if (ordered) {
+    while (nextResult < morselCount && results[nextResult] == NULL) {
+      pthread_cond_wait(&ready, &lock);
+    }
+    if (nextResult == morselCount) {
+      pthread_mutex_unlock(&lock);
+      return RC_END_OF_TREE;
+    }
+    r = results[nextResult];
+    results[nextResult] = NULL;
+  } else {
+    while (nextResult < morselCount && finished.empty()) {
+      pthread_cond_wait(&ready, &lock);
+    }
+    if (nextResult == morselCount) {
+      pthread_mutex_unlock(&lock);
+      return RC_END_OF_TREE;
+    }
+    r = finished.front();
+    finished.pop_front();
+  }
+  nextResult++;
+  pthread_cond_broadcast(&room);
+  pthread_mutex_unlock(&lock);
+
+  RC rc = r->rc;
+  count = r->count;
+  batch.keys.swap(r->batch.keys);
+  batch.values.swap(r->batch.values);
+  batch.sel.swap(r->batch.sel);
+  delete r;
+  return rc;
+}
+
+void* ParallelScan::run(void* arg)
+{
+  Worker* w = (Worker*) arg;
+  w->scan->work(w->id);
+  return NULL;
+}
+
+void ParallelScan::work(int id)
+{
+  int morsel;
+
+  pthread_mutex_lock(&lock);
+  while (take(id, morsel)) {
+    running++;
+    pthread_mutex_unlock(&lock);
+
+    Result* r = new Result;
+    scanMorsel(id, morsel, *r);
+
+    pthread_mutex_lock(&lock);
+    running--;
+    if (ordered) results[morsel] = r;
+    else finished.push_back(r);
+    pthread_cond_broadcast(&ready);
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+bool ParallelScan::take(int id, int& morsel)
+{
+  for (;;) {
+    if (stopping) return false;
+
+    // a thread takes from its own queue first. if it is empty, or too
+    // far ahead, the thread steals from another queue: the first morsel
+    // of all if ordered, so that the next result is not left behind, or
+    // else the last morsel of the longest queue, the farthest from the
+    // morsels its owner reads.
+    int victim = queues[id].empty() ? -1 : id;
+    if (victim < 0 || (ordered && queues[id].front() >= nextResult + maxAhead)) {
+      for (unsigned i = 0; i < queues.size(); i++) {
+        if (queues[i].empty()) continue;
+        if (victim < 0 ||
+            (ordered && queues[i].front() < queues[victim].front()) ||
+            (!ordered && queues[i].size() > queues[victim].size())) {
+          victim = i;
+        }
+      }
+    }
+    if (victim < 0) return false;
+
+    // the threads stay at most maxAhead results ahead of the results returned
+    bool ahead;
+    if (ordered) ahead = (queues[victim].front() >= nextResult + maxAhead);
+    else ahead = ((int) finished.size() + running >= maxAhead);
+    if (!ahead) {
+      if (victim == id || ordered) {
+        morsel = queues[victim].front();
+        queues[victim].pop_front();
+      } else {
+        morsel = queues[victim].back();
+        queues[victim].pop_back();
+      }
+      return true;
+    }
+    pthread_cond_wait(&room, &lock);
+  }
+}
+
+void ParallelScan::scanMorsel(int id, int morsel, Result& r) const
+{
+  r.count = 0;
+  if (indexname.empty()) r.rc = readPages(*files[id], morsel, r.batch);
+  else r.rc = readKeys(*files[id], *indexes[id], morsel, r.batch);
+  if (r.rc < 0) {
+    r.batch.clear();
+    return;
+  }
+
+  r.batch.selectAll();
+  filter.apply(r.batch);
+  r.count = r.batch.sel.size();
+  if (countOnly) r.batch.clear();
+}
+
+RC ParallelScan::readPages(const RecordFile& rf, int morsel, RowBatch& batch) const
+{
+  RC             rc;
+  vector<int>    keys;
+  vector<string> values;
+  PageId         end = (morsel + 1) * MORSEL_PAGES;
+
+  if (end > endPid) end = endPid;
+  for (PageId pid = morsel * MORSEL_PAGES; pid < end; pid++) {
+    if ((rc = rf.readPage(pid, keys, values, valueEq)) < 0) return rc;
+    batch.append(keys, values);
+  }
+  return 0;
+}
+
+RC ParallelScan::readKeys(const RecordFile& rf, BTreeIndex& index, int morsel,
+                          RowBatch& batch) const
+{
+  RC               rc;
+  IndexCursor      cursor;
+  int              key;
+  RecordId         rid;
+  vector<RecordId> rids;
+  int              first = (morsel == 0) ? lo : bounds[morsel - 1];
+  int              last = (morsel == morselCount - 1) ? hi : bounds[morsel] - 1;
+
+  // collect the entries of the sub-range from the leaves. the entries
+  // with a separator key may start in the leaf left of the separator, so
+  // a sub-range after the first is located from the key before it.
+  index.locate((morsel == 0) ? first : first - 1, cursor);
+  while ((rc = index.readForward(cursor, key, rid)) >= 0) {
+    if (rc != 0) continue;  // rc is 1 at the end of a node
+    if (key < first) continue;
+    if (key > last) break;
+    batch.keys.push_back(key);
+    rids.push_back(rid);
+  }
+  if (rc < 0 && rc != RC_END_OF_TREE) return rc;
+
+  // read the tuples from the table unless only the keys are needed
+  if (indexOnly) {
+    batch.values.resize(rids.size());
+    return 0;
+  }
+  return rf.readRecords(rids, batch.keys, batch.values);
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef PARALLELSCAN_H
+#define PARALLELSCAN_H
+
+#include <pthread.h>
+#include <deque>
+#include <string>
+#include <vector>
+#include "Bruinbase.h"
+#include "RecordFile.h"
+#include "BTreeIndex.h"
+#include "RowBatch.h"
+
+/**
+ * scans a table file with a pool of threads.
+ *
+ * A full scan splits the pages of the file into morsels of MORSEL_PAGES
+ * pages. An index scan splits a key range into morsels of sub-ranges at
+ * the separator keys of the non-leaf nodes of the key index (see
+ * BTreeIndex::splitRange()); the entries of a sub-range are read from
+ * the leaves, and their tuples from the table unless only the keys are
+ * needed. Every thread has a queue of morsels. It reads the tuples of a
+ * morsel into a batch, filters the batch, and leaves it as the result of
+ * the morsel. A thread whose queue is empty steals a morsel from the queue
+ * of another thread, so that the threads finish together even when some
+ * morsels take longer than others.
+ *
+ * If the tuples must come out in order, the morsels are
+ * dealt round robin, stolen from the front of the queues, and returned
+ * in morsel order. Otherwise every thread starts with a contiguous range
+ * of morsels, steals from the back of the queues, and the results are
+ * returned as they are finished. Either way the threads run at most
+ * MAX_AHEAD morsels per thread ahead of the results returned, which
+ * bounds the memory taken by the results.
+ */
+class ParallelScan {
+ public:
+  static const int MORSEL_PAGES = 64;  // # pages in a morsel
+  static const int MAX_THREADS = 64;   // the largest # threads of a scan
+  static const int MAX_AHEAD = 4;      // # results waiting per thread
+
+  /**
+   * @param filename[IN] the table file to scan
+   * @param filter[IN] the conditions of the selected tuples
+   * @param valueEq[IN] if not NULL, the value the tuples read must have
+   *                    (see RecordFile::readPage())
+   * @param ordered[IN] true if the results are returned in the order of the file
+   * @param countOnly[IN] true if only the # selected tuples is returned
+   */
+  ParallelScan(const std::string& filename, const BatchFilter& filter,
+               const char* valueEq, bool ordered, bool countOnly);
+
+  /**
+   * scan the tuples in a key range through the key index of the table.
+   * the results are in key order if ordered.
+   * @param filename[IN] the table file
+   * @param indexname[IN] the key index of the table
+   * @param lo[IN] the smallest key of the range
+   * @param hi[IN] the largest key of the range
+   * @param filter[IN] the conditions of the selected tuples
+   * @param indexOnly[IN] true if only the keys are needed. the values
+   *                      are left empty and the table is not read
+   * @param ordered[IN] true if the results are returned in key order
+   * @param countOnly[IN] true if only the # selected tuples is returned
+   */
+  ParallelScan(const std::string& filename, const std::string& indexname,
+               int lo, int hi, const BatchFilter& filter, bool indexOnly,
+               bool ordered, bool countOnly);
+
+  /**
+   * stop the threads and free the results not returned.
+   */
+  ~ParallelScan();
+
+  /**
+   * open the files for every thread, split the scan into morsels and
+   * start the threads. no more threads are started than there are morsels.
+   * @param threads[IN] # threads to scan with
+   * @return error code. 0 if no error
+   */
+  RC start(int threads);
+
+  /**
+   * return the result of the next morsel.
+   * @param batch[OUT] the tuples of the morsel, with the selected ones in
+   *                   the selection vector. empty if countOnly
+   * @param count[OUT] # selected tuples in the morsel
+   * @return 0 if a result is returned, RC_END_OF_TREE after the last
+   *         morsel, or an error code
+   */
+  RC next(RowBatch& batch, int& count);
+
+ private:
+  // the result of a morsel
+  struct Result {
+    RC       rc;
+    int      count;
+    RowBatch batch;
+  };
+
+  // the argument of a thread
+  struct Worker {
+    ParallelScan* scan;
+    int           id;
+  };
+
+  // set the state shared by the constructors
+  void init();
+
+  static void* run(void* arg);
+
+  // scan the morsels of a thread until none is left
+  void work(int id);
+
+  // take the next morsel for a thread, waiting while the threads are too
+  // far ahead. called with the lock held.
+  // return false if no morsel is left or the scan is stopped.
+  bool take(int id, int& morsel);
+
+  // read and filter the tuples of a morsel of thread id
+  void scanMorsel(int id, int morsel, Result& r) const;
+
+  // read the tuples of a morsel of pages
+  RC readPages(const RecordFile& rf, int morsel, RowBatch& batch) const;
+
+  // read the tuples of a morsel of keys
+  RC readKeys(const RecordFile& rf, BTreeIndex& index, int morsel, RowBatch& batch) const;
+
+  std::string        filename;
+  std::string        indexname;  // the key index of an index scan, or empty
+  int                lo;         // the key range of an index scan
+  int                hi;
+  const BatchFilter& filter;
+  const char*        valueEq;
+  bool               indexOnly;
+  bool               ordered;
+  bool               countOnly;
+
+  PageId           endPid;       // (last page id + 1) of the file
+  std::vector<int> bounds;       // the first keys of the sub-ranges of an index scan
+  int              morselCount;  // # morsels of the scan
+  int              maxAhead;     // # results the threads may run ahead
+
+  std::vector<RecordFile*>      files;    // the file opened by every thread
+  std::vector<BTreeIndex*>      indexes;  // the index opened by every thread
+  std::vector<Worker>           workers;
+  std::vector<pthread_t>        threads;
+  std::vector<std::deque<int> > queues;   // the morsels left to every thread
+
+  pthread_mutex_t lock;   // guards the queues, the results and the counters
+  pthread_cond_t  ready;  // signaled when a result is finished
+  pthread_cond_t  room;   // signaled when a result is returned
+
+  std::vector<Result*> results;   // the finished results by morsel, if ordered
+  std::deque<Result*>  finished;  // the finished results, if not ordered
+  int  nextResult;     // # results returned
+  int  running;        // # morsels taken but not finished
+  bool stopping;       // true once the scan is destroyed
+};
+
+#endif // PARALLELSCAN_H
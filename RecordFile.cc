@@ -10,8 +10,13 @@
 #include "Bruinbase.h"
 #include "RecordFile.h"
 #include <cstring>
+#include <algorithm>
 
 using std::string;
+using std::vector;
+using std::pair;
+using std::make_pair;
+using std::sort;
 
 //
 // helper functions for page manipultation
@@ -24,7 +29,7 @@ static char* slotPtr(char* page, int n);
 static void readSlot(const char* page, int n, int& key, std::string& value);
 
 // write the record to the n'th slot in the page
-static void writeSlot(char* page, int n, int key, const std::string& value);
+static void writeSlot(char* page, int n, int key, const char* value, int length);
 
 // get # records stored in the page
 static int getRecordCount(const char* page);
@@ -32,6 +37,58 @@ static int getRecordCount(const char* page);
 // update # records stored in the page
 static void setRecordCount(char* page, int count);
 
+// check that the records counted in the page fit in the page
+static bool validPage(const char* page);
+
+// order (RecordId, position) pairs by RecordId
+static bool ridLess(const pair<RecordId, unsigned>& a, const pair<RecordId, unsigned>& b);
+
+
+//
+// helper functions for DICTIONARY pages
+//
+// A DICTIONARY page is laid out as
+//   [record count | DICT_PAGE_FLAG][# dictionary entries][dictionary bytes]
+//   [keys: int * count][codes: unsigned char * count][dictionary]
+// where the dictionary holds the distinct values of the page in strcmp order.
+// Every dictionary entry is front-coded against the previous one as
+//   [# bytes shared with the previous entry][suffix length][suffix]
+//
+
+// the record count of a DICTIONARY page has this bit set
+static const int DICT_PAGE_FLAG = 0x40000000;
+
+// the size of the DICTIONARY page header
+static const int DICT_HEADER_SIZE = sizeof(int) + 2*sizeof(unsigned short);
+
+// maximum # values in a page dictionary (a code is one byte)
+static const int MAX_DICT_ENTRIES = 256;
+
+// the decoded content of a DICTIONARY page
+struct DictPage {
+  vector<int>           keys;   // the record keys in slot order
+  vector<unsigned char> codes;  // the dictionary code of each record value
+  vector<string>        dict;   // the distinct values in strcmp order
+};
+
+// is the page a DICTIONARY page?
+static bool isDictPage(const char* page);
+
+// decode the dictionary of a DICTIONARY page
+static void readDict(const char* page, vector<string>& dict);
+
+// decode a DICTIONARY page
+static void readDictPage(const char* page, DictPage& dp);
+
+// encode dp into a DICTIONARY page. return false if dp does not fit in a page
+static bool writeDictPage(char* page, const DictPage& dp);
+
+// add a record to a decoded DICTIONARY page
+static void addDictRecord(DictPage& dp, int key, const string& value);
+
+// truncate the value to the longest string a record can store
+static string truncateValue(const string& value);
+
 
 //
 // helper functions for RecordId manipulation
@@ -107,10 +164,12 @@ RecordFile::RecordFile()
 {
   erid.pid = 0;
   erid.sid = 0;
+  format = FIXED;
 }
 
 RecordFile::RecordFile(const string& filename, char mode)
 {
+  format = FIXED;
   open(filename, mode);
 }
 
@@ -133,6 +192,7 @@ RC RecordFile::open(const string& filename, char mode)
   // set the end record id to (0, 0).
   if (erid.pid == 0) {
     erid.sid = 0;
+    format = FIXED;
     return 0;
   }
 
@@ -146,9 +206,20 @@ RC RecordFile::open(const string& filename, char mode)
     return rc;
   }
 
-  // get # records in the last page
+  if (!validPage(page)) {
+    erid.pid = erid.sid = 0;
+    pf.close();
+    return RC_INVALID_FILE_FORMAT;
+  }
+
+  // new pages are created in the format of the last page
+  format = isDictPage(page) ? DICTIONARY : FIXED;
+
+  // get # records in the last page.
+  // a DICTIONARY page is full only when the next record does not fit,
+  // so append() decides when to move to the next page.
   erid.sid = getRecordCount(page);
-  if (erid.sid >= RECORDS_PER_PAGE) {
+  if (format == FIXED && erid.sid >= RECORDS_PER_PAGE) {
     // the last page is full. advance the end record id to the next page.
     erid.pid++;
     erid.sid = 0;
@@ -172,11 +243,24 @@ RC RecordFile::read(const RecordId& rid, int& key, string& value) const
   
   // check whether the rid is in the valid range
   if (rid.pid < 0 || rid.pid > erid.pid) return RC_INVALID_RID;
-  if (rid.sid < 0 || rid.sid >= RecordFile::RECORDS_PER_PAGE) return RC_INVALID_RID;
+  if (rid.sid < 0) return RC_INVALID_RID;
   if (rid >= erid) return RC_INVALID_RID;
   
   // read the page containing the record
   if ((rc = pf.read(rid.pid, page)) < 0) return rc;
+  if (!validPage(page)) return RC_INVALID_FILE_FORMAT;
+
+  if (isDictPage(page)) {
+    // look up the value of the record in the page dictionary
+    if (rid.sid >= getRecordCount(page)) return RC_INVALID_RID;
+    DictPage dp;
+    readDictPage(page, dp);
+    key = dp.keys[rid.sid];
+    value = dp.dict[dp.codes[rid.sid]];
+    return 0;
+  }
+
+  if (rid.sid >= RecordFile::RECORDS_PER_PAGE) return RC_INVALID_RID;
 
   // read the record from the slot in the page
   readSlot(page, rid.sid, key, value);
@@ -184,36 +268,193 @@ RC RecordFile::read(const RecordId& rid, int& key, string& value) const
   return 0;
 }
 
-RC RecordFile::append(int key, const std::string& value, RecordId& rid)
+RC RecordFile::readPage(PageId pid, vector<int>& keys, vector<string>& values,
+                        const char* value) const
 {
   RC   rc;
   char page[PageFile::PAGE_SIZE];
 
+  keys.clear();
+  values.clear();
+
+  // check whether the page holds records
+  if (pid < 0 || pid >= endPid()) return RC_INVALID_PID;
+
+  if ((rc = pf.read(pid, page)) < 0) return rc;
+  if (!validPage(page)) return RC_INVALID_FILE_FORMAT;
+
+  int count = getRecordCount(page);
+
+  if (isDictPage(page)) {
+    DictPage dp;
+    if (value == NULL) {
+      readDictPage(page, dp);
+      for (int i = 0; i < count; i++) {
+        keys.push_back(dp.keys[i]);
+        values.push_back(dp.dict[dp.codes[i]]);
+      }
+      return 0;
+    }
+
+    // look up the value in the dictionary once. if the page does not
+    // contain the value, none of its records can match.
+    readDict(page, dp.dict);
+    vector<string>::const_iterator it =
+      std::lower_bound(dp.dict.begin(), dp.dict.end(), string(value));
+    if (it == dp.dict.end() || *it != value) return 0;
+    unsigned char code = it - dp.dict.begin();
+
+    // match the records by their dictionary code
+    const char* kptr = page + DICT_HEADER_SIZE;
+    const unsigned char* cptr = (const unsigned char*) kptr + count*sizeof(int);
+    for (int i = 0; i < count; i++) {
+      if (cptr[i] != code) continue;
+      int key;
+      memcpy(&key, kptr + i*sizeof(int), sizeof(int));
+      keys.push_back(key);
+      values.push_back(*it);
+    }
+    return 0;
+  }
+
+  for (int i = 0; i < count; i++) {
+    char* ptr = slotPtr(page, i);
+    if (value != NULL && strcmp(ptr + sizeof(int), value) != 0) continue;
+
+    int key;
+    memcpy(&key, ptr, sizeof(int));
+    keys.push_back(key);
+    values.push_back(string(ptr + sizeof(int)));
+  }
+
+  return 0;
+}
+
+RC RecordFile::readRecords(const vector<RecordId>& rids, vector<int>& keys,
+                           vector<string>& values) const
+{
+  RC             rc;
+  vector<int>    pkeys;
+  vector<string> pvalues;
+
+  keys.resize(rids.size());
+  values.resize(rids.size());
+
+  // visit the RecordIds in (pid, sid) order, remembering their positions
+  vector<pair<RecordId, unsigned> > order(rids.size());
+  for (unsigned i = 0; i < rids.size(); i++) {
+    order[i] = make_pair(rids[i], i);
+  }
+  sort(order.begin(), order.end(), ridLess);
+
+  // read each page once and place its records at their positions in rids
+  PageId pid = -1;
+  for (unsigned i = 0; i < order.size(); i++) {
+    const RecordId& r = order[i].first;
+    if (r.pid != pid) {
+      if ((rc = readPage(r.pid, pkeys, pvalues)) < 0) return rc;
+      pid = r.pid;
+    }
+    if (r.sid < 0 || r.sid >= (int) pkeys.size()) return RC_INVALID_RID;
+    keys[order[i].second] = pkeys[r.sid];
+    values[order[i].second] = pvalues[r.sid];
+  }
+
+  return 0;
+}
+
+void RecordFile::setPageFormat(PageFormat format)
+{
+  this->format = format;
+}
+
+RC RecordFile::compressExtents()
+{
+  return pf.compress();
+}
+
+RC RecordFile::append(int key, const std::string& value, RecordId& rid)
+{
+  Record r;
+
+  r.key = key;
+  r.value = value.data();
+  r.length = value.size();
+  return appendMany(&r, 1, &rid);
+}
+
+RC RecordFile::appendMany(const Record* recs, size_t n, RecordId* out)
+{
+  RC       rc;
+  char     page[PageFile::PAGE_SIZE];
+  RecordId rid = erid;     // the slot of the next record
+  bool     dict;           // is the page in memory a DICTIONARY page?
+  DictPage dp;             // the decoded page, if a DICTIONARY page
+  string   value;
+
+  if (n == 0) return 0;
+
   // unless we are writing to the the first slot of an empty page,
   // we have to read the page first
-  if (erid.sid > 0) {
-    if ((rc = pf.read(erid.pid, page)) < 0) return rc;
+  if (rid.sid > 0) {
+    if ((rc = pf.read(rid.pid, page)) < 0) return rc;
+    dict = isDictPage(page);
+    if (dict) readDictPage(page, dp);
   } else {
     // if this is the first slot of an empty page
     // we can simply initialize the page with zeros
     memset(page, 0, PageFile::PAGE_SIZE);
+    dict = (format == DICTIONARY);
   }
-    
-  // write the record to the first empty slot 
-  writeSlot(page, erid.sid, key, value);
-
-  // the first four bytes in the page stores # records in the page.
-  // update this number.
-  setRecordCount(page, erid.sid + 1);
 
-  // write the page to the disk
-  if ((rc = pf.write(erid.pid, page)) < 0) return rc;
-    
-  // we need to output the rid of the record slot
-  rid = erid;
+  // the records are added to the page in memory, and a page is written
+  // once when it is full or all records are added
+  for (size_t i = 0; i < n; i++) {
+    if (dict) {
+      // a record in a DICTIONARY page is stored as a dictionary code
+      value.assign(recs[i].value, recs[i].length);
+      addDictRecord(dp, recs[i].key, value);
+      if (!writeDictPage(page, dp)) {
+        // the page is full. the page still holds the records before this
+        // one, so write it and start the next page with the record.
+        if ((rc = pf.write(rid.pid, page)) < 0) return rc;
+        erid = rid;
+        rid.pid++;
+        rid.sid = 0;
+        dp = DictPage();
+        addDictRecord(dp, recs[i].key, value);
+        writeDictPage(page, dp);
+      }
+      out[i] = rid;
+      rid.sid++;
+      continue;
+    }
+
+    // write the record to the first empty slot 
+    writeSlot(page, rid.sid, recs[i].key, recs[i].value, recs[i].length);
+
+    // the first four bytes in the page stores # records in the page.
+    // update this number.
+    setRecordCount(page, rid.sid + 1);
+
+    // we need to output the rid of the record slot
+    out[i] = rid;
+
+    // advance the end record id by one to the next empty slot, writing
+    // the page to the disk when it is full
+    if (++rid.sid >= RECORDS_PER_PAGE) {
+      if ((rc = pf.write(rid.pid, page)) < 0) return rc;
+      rid.pid++;
+      rid.sid = 0;
+      erid = rid;
+      memset(page, 0, PageFile::PAGE_SIZE);
+      dict = (format == DICTIONARY);
+    }
+  }
 
-  // advance the end record id by one to the next empty slot
-  ++erid;
+  // write the last page, which is not full
+  if (rid.sid > 0 && (rc = pf.write(rid.pid, page)) < 0) return rc;
+  erid = rid;
 
   return 0;
 }
@@ -223,13 +464,41 @@ const RecordId& RecordFile::endRid() const
   return erid;
 }
 
+PageId RecordFile::endPid() const
+{
+  // erid points to the next empty slot. it lies in a page that
+  // holds records unless it is the first slot of a new page.
+  return (erid.sid > 0) ? erid.pid + 1 : erid.pid;
+}
+
 static int getRecordCount(const char* page)
 {
   int count;
 
   // the first four bytes of a page contains # records in the page
   memcpy(&count, page, sizeof(int));
-  return count;
+  return count & ~DICT_PAGE_FLAG;
+}
+
+static bool validPage(const char* page)
+{
+  int count = getRecordCount(page);
+
+  if (count < 0) return false;
+  if (!isDictPage(page)) return count <= RecordFile::RECORDS_PER_PAGE;
+
+  // the keys, the codes and the dictionary of a DICTIONARY page, and
+  // every code has to name a dictionary entry
+  unsigned short nentries, nbytes;
+  memcpy(&nentries, page + sizeof(int), sizeof(unsigned short));
+  memcpy(&nbytes, page + sizeof(int) + sizeof(unsigned short), sizeof(unsigned short));
+  if (nentries > MAX_DICT_ENTRIES) return false;
+  if (count > (PageFile::PAGE_SIZE - DICT_HEADER_SIZE - nbytes) / (int)(sizeof(int) + 1)) return false;
+  const unsigned char* codes = (const unsigned char*) page + DICT_HEADER_SIZE + count*sizeof(int);
+  for (int i = 0; i < count; i++) {
+    if (codes[i] >= nentries) return false;
+  }
+  return true;
 }
 
 static void setRecordCount(char* page, int count)
@@ -238,6 +507,11 @@ static void setRecordCount(char* page, int count)
   memcpy(page, &count, sizeof(int));
 }
 
+static bool ridLess(const pair<RecordId, unsigned>& a, const pair<RecordId, unsigned>& b)
+{
+  return a.first < b.first;
+}
+
 static char* slotPtr(char* page, int n) 
 {
   // compute the location of the n'th slot in a page.
@@ -259,7 +533,7 @@ static void readSlot(const char* page, int n, int& key, std::string& value)
   value.assign(ptr + sizeof(int));
 }
 
-static void writeSlot(char* page, int n, int key, const std::string& value)
+static void writeSlot(char* page, int n, int key, const char* value, int length)
 {
   // compute the location of the record
   char *ptr = slotPtr(page, n);
@@ -268,11 +542,141 @@ static void writeSlot(char* page, int n, int key, const std::string& value)
   memcpy(ptr, &key, sizeof(int));
 
   // store the value. 
-  if ((int)value.size() >= RecordFile::MAX_VALUE_LENGTH) {
+  if (length >= RecordFile::MAX_VALUE_LENGTH) {
     // when the string is longer than MAX_VALUE_LENGTH, truncate it.
-    memcpy(ptr + sizeof(int), value.c_str(), RecordFile::MAX_VALUE_LENGTH -1);
+    memcpy(ptr + sizeof(int), value, RecordFile::MAX_VALUE_LENGTH -1);
     *(ptr + sizeof(int) + RecordFile::MAX_VALUE_LENGTH - 1) = 0;
   } else {
-    strcpy(ptr + sizeof(int), value.c_str());
+    // like strcpy(), the value ends at its first zero byte
+    const char* z = (const char*) memchr(value, 0, length);
+    if (z != NULL) length = z - value;
+    memcpy(ptr + sizeof(int), value, length);
+    *(ptr + sizeof(int) + length) = 0;
   }
 }
+
+static bool isDictPage(const char* page)
+{
+  int count;
+  memcpy(&count, page, sizeof(int));
+  return (count & DICT_PAGE_FLAG) != 0;
+}
+
+static string truncateValue(const string& value)
+{
+  // keep the same limit as a FIXED slot, which stores a terminating zero
+  if ((int)value.size() >= RecordFile::MAX_VALUE_LENGTH) {
+    return value.substr(0, RecordFile::MAX_VALUE_LENGTH - 1);
+  }
+  return value;
+}
+
+static void addDictRecord(DictPage& dp, int key, const string& value)
+{
+  // find the code of the value, adding it to the dictionary if needed.
+  // the dictionary is kept sorted, so the codes behind it are shifted.
+  string v = truncateValue(value);
+  vector<string>::iterator it = std::lower_bound(dp.dict.begin(), dp.dict.end(), v);
+  int code = it - dp.dict.begin();
+  if (it == dp.dict.end() || *it != v) {
+    dp.dict.insert(it, v);
+    for (unsigned i = 0; i < dp.codes.size(); i++) {
+      if (dp.codes[i] >= code) dp.codes[i]++;
+    }
+  }
+  dp.keys.push_back(key);
+  dp.codes.push_back(code);
+}
+
+static void readDict(const char* page, vector<string>& dict)
+{
+  int            count = getRecordCount(page);
+  unsigned short nentries;
+
+  memcpy(&nentries, page + sizeof(int), sizeof(unsigned short));
+
+  // the dictionary follows the keys and the codes
+  const unsigned char* ptr = (const unsigned char*) page + DICT_HEADER_SIZE
+                             + count*(sizeof(int) + 1);
+
+  dict.clear();
+  dict.reserve(nentries);
+  for (int i = 0; i < nentries; i++) {
+    int shared = *ptr++;
+    int suffix = *ptr++;
+    if (i == 0) {
+      dict.push_back(string((const char*) ptr, suffix));
+    } else {
+      dict.push_back(dict[i-1].substr(0, shared));
+      dict[i].append((const char*) ptr, suffix);
+    }
+    ptr += suffix;
+  }
+}
+
+static void readDictPage(const char* page, DictPage& dp)
+{
+  int count = getRecordCount(page);
+  const char* ptr = page + DICT_HEADER_SIZE;
+
+  dp.keys.resize(count);
+  dp.codes.resize(count);
+  if (count > 0) {
+    memcpy(&dp.keys[0], ptr, count*sizeof(int));
+    memcpy(&dp.codes[0], ptr + count*sizeof(int), count);
+  }
+  readDict(page, dp.dict);
+}
+
+static bool writeDictPage(char* page, const DictPage& dp)
+{
+  int count = dp.keys.size();
+
+  // every code has to fit in a byte
+  if ((int)dp.dict.size() > MAX_DICT_ENTRIES) return false;
+
+  // compute the size of the page first
+  int size = DICT_HEADER_SIZE + count*(sizeof(int) + 1);
+  for (unsigned i = 0; i < dp.dict.size(); i++) {
+    int shared = 0;
+    if (i > 0) {
+      const string& prev = dp.dict[i-1];
+      while (shared < (int)prev.size() && shared < (int)dp.dict[i].size()
+             && prev[shared] == dp.dict[i][shared]) shared++;
+    }
+    size += 2 + dp.dict[i].size() - shared;
+  }
+  if (size > PageFile::PAGE_SIZE) return false;
+
+  memset(page, 0, PageFile::PAGE_SIZE);
+  setRecordCount(page, count | DICT_PAGE_FLAG);
+
+  unsigned short nentries = dp.dict.size();
+  unsigned short nbytes = size - DICT_HEADER_SIZE - count*(sizeof(int) + 1);
+  memcpy(page + sizeof(int), &nentries, sizeof(unsigned short));
+  memcpy(page + sizeof(int) + sizeof(unsigned short), &nbytes, sizeof(unsigned short));
+
+  char* ptr = page + DICT_HEADER_SIZE;
+  if (count > 0) {
+    memcpy(ptr, &dp.keys[0], count*sizeof(int));
+    memcpy(ptr + count*sizeof(int), &dp.codes[0], count);
+  }
+  ptr += count*(sizeof(int) + 1);
+
+  // front-code the dictionary
+  for (unsigned i = 0; i < dp.dict.size(); i++) {
+    int shared = 0;
+    if (i > 0) {
+      const string& prev = dp.dict[i-1];
+      while (shared < (int)prev.size() && shared < (int)dp.dict[i].size()
+             && prev[shared] == dp.dict[i][shared]) shared++;
+    }
+    int suffix = dp.dict[i].size() - shared;
+    *ptr++ = (char) shared;
+    *ptr++ = (char) suffix;
+    memcpy(ptr, dp.dict[i].data() + shared, suffix);
+    ptr += suffix;
+  }
+
+  return true;
+}
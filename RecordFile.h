@@ -11,7 +11,9 @@
 #define RECORDFILE_H
 
 #include <string>
+#include <vector>
 #include "PageFile.h"
+#include "ExtentFile.h"
 
 /**
  * The data structure for pointing to a particular record in a RecordFile.
@@ -22,6 +24,15 @@ typedef struct {
   int     sid;  // slot number. the first slot is 0
 } RecordId;
 
+/**
+ * a record whose value is stored elsewhere, such as in a mapped load file.
+ */
+typedef struct {
+  int         key;     // the record key
+  const char* value;   // the record value. not NUL-terminated
+  int         length;  // the length of the value
+} Record;
+
 //
 // helper functions for RecordId
 // 
@@ -52,6 +63,15 @@ class RecordFile {
     // Note that we subtract sizeof(int) from PAGE_SIZE because the first
     // four bytes in the page is used to store # records in the page.
 
+  /**
+   * the format of the pages created by append().
+   * FIXED pages store RECORDS_PER_PAGE fixed-size (key, value) slots.
+   * DICTIONARY pages store the keys, a one-byte dictionary code per record
+   * and a sorted, front-coded dictionary of the distinct values in the page,
+   * so the # records in a DICTIONARY page depends on its content.
+   */
+  enum PageFormat { FIXED, DICTIONARY };
+
   RecordFile();
   RecordFile(const std::string& filename, char mode);
   
@@ -90,15 +110,75 @@ class RecordFile {
    */
   RC append(int key, const std::string& value, RecordId& rid);
 
+  /**
+   * append new records at the end of the file.
+   * the records are added to the pages in memory, and every page is
+   * written once, so a batch costs a page write per page instead of a
+   * page read and write per record.
+   * @param recs[IN] the records to append
+   * @param n[IN] # records to append
+   * @param out[OUT] the locations of the stored records, n of them
+   * @return error code. 0 if no error
+   */
+  RC appendMany(const Record* recs, size_t n, RecordId* out);
+
+  /**
+   * read all records stored in a page in slot order.
+   * if value is not NULL, only the records whose value is equal to it
+   * are returned. On a DICTIONARY page the value is looked up once in the
+   * page dictionary and the records are matched by their dictionary code,
+   * so a page that does not contain the value is skipped without decoding.
+   * @param pid[IN] the page to read
+   * @param keys[OUT] the keys of the records in the page
+   * @param values[OUT] the values of the records in the page
+   * @param value[IN] if not NULL, the value the returned records must have
+   * @return error code. 0 if no error
+   */
+  RC readPage(PageId pid, std::vector<int>& keys, std::vector<std::string>& values,
+              const char* value = NULL) const;
+
+  /**
+   * read the records of a list of record ids, reading each page once.
+   * @param rids[IN] the ids of the records to read, in any order
+   * @param keys[OUT] the keys of the records, in the order of rids
+   * @param values[OUT] the values of the records, in the order of rids
+   * @return error code. 0 if no error
+   */
+  RC readRecords(const std::vector<RecordId>& rids, std::vector<int>& keys,
+                 std::vector<std::string>& values) const;
+
+  /**
+   * set the format of the pages created by append() from now on.
+   * a partially filled last page keeps its own format until it is full.
+   * when a file is opened, the format is set to that of its last page.
+   * @param format[IN] the new page format
+   */
+  void setPageFormat(PageFormat format);
+
+  /**
+   * store the pages of the file in LZ-compressed extents (see ExtentFile).
+   * only an empty file opened in 'w' mode can be compressed. whether a
+   * file is compressed is detected when it is opened.
+   * @return error code. 0 if no error
+   */
+  RC compressExtents();
+
   /**
    * note the +1 part. The rid of the last record is endRid()-1.
    * @return (last record id + 1) of the RecordFile
    */
   const RecordId& endRid() const;
 
+  /**
+   * note the +1 part. The last page holding records is endPid()-1.
+   * @return (last page id + 1) of the RecordFile
+   */
+  PageId endPid() const;
+
  private:
-  PageFile pf;     // the PageFile used to store the records
-  RecordId erid;   // the last record id of the file + 1
+  ExtentFile pf;      // the file used to store the record pages
+  RecordId   erid;    // the last record id of the file + 1
+  PageFormat format;  // the format of the newly created pages
 };
 
 #endif // RECORDFILE_H
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include <cstring>
+#include "ResultSink.h"
+
+using namespace std;
+
+ResultSink::ResultSink(FILE* out, Format format)
+{
+  this->out = out;
+  this->format = format;
+  length = 0;
+  columns = 0;
+}
+
+ResultSink::~ResultSink()
+{
+  flush();
+}
+
+void ResultSink::writeTuple(int attr, int key, const string& value)
+{
+  if (format == BINARY) {
+    if (attr != 2) putBinaryInt(key);
+    if (attr != 1) {
+      putBinaryInt(value.size());
+      putBytes(value.data(), value.size());
+    }
+    return;
+  }
+
+  if (attr != 2) putInt(key);
+  if (attr == 3) putChar((format == CSV) ? ',' : ' ');
+  if (attr != 1) {
+    if (format == CSV) {
+      putCsvValue(value);
+    } else if (attr == 3) {
+      putChar('\'');
+      putBytes(value.data(), value.size());
+      putChar('\'');
+    } else {
+      putBytes(value.data(), value.size());
+    }
+  }
+  putChar('\n');
+}
+
+void ResultSink::writeCount(int count)
+{
+  if (format == BINARY) {
+    putBinaryInt(count);
+  } else {
+    putInt(count);
+    putChar('\n');
+  }
+}
+
+void ResultSink::writeColumn(int n)
+{
+  separate();
+  if (format == BINARY) putBinaryInt(n);
+  else putInt(n);
+}
+
+void ResultSink::writeColumn(long long n)
+{
+  separate();
+  if (format == BINARY) putBytes((const char*) &n, sizeof(long long));
+  else putInt(n);
+}
+
+void ResultSink::writeColumn(double d)
+{
+  separate();
+  if (format == BINARY) {
+    putBytes((const char*) &d, sizeof(double));
+  } else {
+    char s[32];
+    putBytes(s, snprintf(s, sizeof(s), "%.15g", d));
+  }
+}
+
+void ResultSink::writeColumn(const string& value)
+{
+  separate();
+  if (format == BINARY) {
+    putBinaryInt(value.size());
+    putBytes(value.data(), value.size());
+  } else if (format == CSV) {
+    putCsvValue(value);
+  } else {
+    putChar('\'');
+    putBytes(value.data(), value.size());
+    putChar('\'');
+  }
+}
+
+void ResultSink::writeNull(int size)
+{
+  separate();
+  if (format == BINARY) {
+    for (int i = 0; i < size; i++) putChar(0);
+  } else if (format == TEXT) {
+    putBytes("NULL", 4);
+  }
+}
+
+void ResultSink::endRow()
+{
+  if (format != BINARY) putChar('\n');
+  columns = 0;
+}
+
+RC ResultSink::flush()
+{
+  if (length > 0 && fwrite(buffer, 1, length, out) != (size_t) length) {
+    length = 0;
+    return RC_FILE_WRITE_FAILED;
+  }
+  length = 0;
+  return (fflush(out) == 0) ? 0 : RC_FILE_WRITE_FAILED;
+}
+
+void ResultSink::reserve(int n)
+{
+  if (length + n > BUFFER_SIZE) flush();
+}
+
+void ResultSink::putBytes(const char* s, int n)
+{
+  // a string larger than the buffer is written directly
+  if (n > BUFFER_SIZE) {
+    flush();
+    fwrite(s, 1, n, out);
+    return;
+  }
+  reserve(n);
+  memcpy(buffer + length, s, n);
+  length += n;
+}
+
+void ResultSink::putInt(long long n)
+{
+  // the digits are generated backwards into a small buffer.
+  // the magnitude is unsigned, so that the smallest number can be negated.
+  char               digits[24];
+  int                i = sizeof(digits);
+  unsigned long long u = (n < 0) ? 0ull - (unsigned long long) n : (unsigned long long) n;
+
+  do {
+    digits[--i] = '0' + u % 10;
+    u /= 10;
+  } while (u > 0);
+  if (n < 0) digits[--i] = '-';
+
+  putBytes(digits + i, sizeof(digits) - i);
+}
+
+void ResultSink::separate()
+{
+  if (columns++ > 0 && format != BINARY) putChar((format == CSV) ? ',' : ' ');
+}
+
+void ResultSink::putBinaryInt(int n)
+{
+  putBytes((const char*) &n, sizeof(int));
+}
+
+void ResultSink::putCsvValue(const string& value)
+{
+  if (value.find_first_of(",\"\r\n") == string::npos) {
+    putBytes(value.data(), value.size());
+    return;
+  }
+
+  // quote the value and double the quotes in it
+  putChar('"');
+  for (unsigned i = 0; i < value.size(); i++) {
+    if (value[i] == '"') putChar('"');
+    putChar(value[i]);
+  }
+  putChar('"');
+}
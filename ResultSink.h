@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef RESULTSINK_H
+#define RESULTSINK_H
+
+#include <cstdio>
+#include <string>
+#include "Bruinbase.h"
+
+/**
+ * the destination of the result of a SELECT.
+ * the tuples are formatted into a large buffer, which is written to the
+ * output stream only when it fills up or the sink is flushed.
+ *
+ * The formats are
+ *  - TEXT:   key 'value', one tuple per line, as printed by the console
+ *  - CSV:    key,value, with the value quoted if it contains a comma,
+ *            a double quote or a line break
+ *  - BINARY: the key as a 4-byte int and the value as a 4-byte length
+ *            followed by its bytes, in the byte order of the machine
+ *
+ * The rows of an aggregate query are written a column at a time. In
+ * BINARY, a 64-bit count or sum takes 8 bytes and an average is an
+ * 8-byte double. A missing value (NULL) is written as NULL in TEXT,
+ * as an empty column in CSV, and as zero bytes of the column size in
+ * BINARY.
+ */
+class ResultSink {
+ public:
+  enum Format { TEXT, CSV, BINARY };
+
+  static const int BUFFER_SIZE = 65536;  // the size of the output buffer
+
+  /**
+   * @param out[IN] the stream the result is written to
+   * @param format[IN] the format of the result
+   */
+  ResultSink(FILE* out, Format format);
+
+  /**
+   * flush the buffered result.
+   */
+  ~ResultSink();
+
+  /**
+   * write a tuple projected on the attributes in the SELECT clause.
+   * @param attr[IN] 1: key, 2: value, 3: *
+   * @param key[IN] the key of the tuple
+   * @param value[IN] the value of the tuple
+   */
+  void writeTuple(int attr, int key, const std::string& value);
+
+  /**
+   * write the result of count(*).
+   * @param count[IN] # tuples selected
+   */
+  void writeCount(int count);
+
+  /**
+   * write a column of an int key.
+   * @param n[IN] the key
+   */
+  void writeColumn(int n);
+
+  /**
+   * write a column of a 64-bit count or sum.
+   * @param n[IN] the number
+   */
+  void writeColumn(long long n);
+
+  /**
+   * write a column of an average.
+   * @param d[IN] the number
+   */
+  void writeColumn(double d);
+
+  /**
+   * write a column of a value.
+   * @param value[IN] the value
+   */
+  void writeColumn(const std::string& value);
+
+  /**
+   * write a NULL column.
+   * @param size[IN] the size of the column in BINARY
+   */
+  void writeNull(int size);
+
+  /**
+   * end the row of the columns written so far.
+   */
+  void endRow();
+
+  /**
+   * write the buffered result to the output stream.
+   * @return error code. 0 if no error
+   */
+  RC flush();
+
+ private:
+  // make room for n more bytes in the buffer
+  void reserve(int n);
+
+  void putChar(char c) { reserve(1); buffer[length++] = c; }
+  void putBytes(const char* s, int n);
+  void putInt(long long n);
+  void separate();
+  void putBinaryInt(int n);
+  void putCsvValue(const std::string& value);
+
+  FILE*  out;
+  Format format;
+  int    length;               // # bytes in the buffer
+  int    columns;              // # columns written in the current row
+  char   buffer[BUFFER_SIZE];
+};
+
+#endif // RESULTSINK_H
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include <cstdlib>
+#include <functional>
+#include <algorithm>
+#include "RowBatch.h"
+
+using namespace std;
+
+// keep the selected tuples whose key compares to v as Cmp says
+template <class Cmp>
+static void filterKeys(const vector<int>& keys, int v, vector<int>& sel)
+{
+  Cmp      cmp;
+  unsigned n = 0;
+  for (unsigned i = 0; i < sel.size(); i++) {
+    if (cmp(keys[sel[i]], v)) sel[n++] = sel[i];
+  }
+  sel.resize(n);
+}
+
+// keep the selected tuples whose value compares to v as Cmp says
+template <class Cmp>
+static void filterValues(const vector<string>& values, const string& v, vector<int>& sel)
+{
+  Cmp      cmp;
+  unsigned n = 0;
+  for (unsigned i = 0; i < sel.size(); i++) {
+    if (cmp(values[sel[i]].compare(v), 0)) sel[n++] = sel[i];
+  }
+  sel.resize(n);
+}
+
+// keep the selected tuples whose value is (or is not, if eq is false) v.
+// strings of different lengths are told apart without comparing them.
+static void filterValueEquals(const vector<string>& values, const string& v, bool eq,
+                              vector<int>& sel)
+{
+  unsigned n = 0;
+  for (unsigned i = 0; i < sel.size(); i++) {
+    const string& s = values[sel[i]];
+    bool same = (s.size() == v.size() && s.compare(v) == 0);
+    if (same == eq) sel[n++] = sel[i];
+  }
+  sel.resize(n);
+}
+
+
+// the cost rank of a condition: an int comparison, a string (in)equality
+// that mostly compares lengths, or a string ordering
+static int costRank(int attr, SelCond::Comparator comp)
+{
+  if (attr == 1) return 0;
+  if (comp == SelCond::EQ || comp == SelCond::NE) return 1;
+  return 2;
+}
+
+
+void RowBatch::append(const vector<int>& k, vector<string>& v)
+{
+  keys.insert(keys.end(), k.begin(), k.end());
+  for (unsigned i = 0; i < v.size(); i++) {
+    values.push_back(string());
+    values.back().swap(v[i]);
+  }
+}
+
+void RowBatch::selectAll()
+{
+  sel.resize(keys.size());
+  for (unsigned i = 0; i < sel.size(); i++) sel[i] = i;
+}
+
+void RowBatch::clear()
+{
+  keys.clear();
+  values.clear();
+  sel.clear();
+}
+
+BatchFilter::BatchFilter(const vector<SelCond>& cond)
+{
+  for (unsigned i = 0; i < cond.size(); i++) {
+    Cond c;
+    c.attr = cond[i].attr;
+    c.comp = cond[i].comp;
+    c.key = (c.attr == 1) ? atoi(cond[i].value) : 0;
+    if (c.attr == 2) c.value = cond[i].value;
+    conds.push_back(c);
+  }
+
+  // the cheaper conditions run first, on more tuples
+  stable_sort(conds.begin(), conds.end(), cheaper);
+}
+
+void BatchFilter::apply(RowBatch& batch) const
+{
+  vector<int>& sel = batch.sel;
+
+  for (unsigned i = 0; i < conds.size() && !sel.empty(); i++) {
+    const Cond& c = conds[i];
+    if (c.attr == 1) {
+      switch (c.comp) {
+      case SelCond::EQ: filterKeys<equal_to<int> >(batch.keys, c.key, sel); break;
+      case SelCond::NE: filterKeys<not_equal_to<int> >(batch.keys, c.key, sel); break;
+      case SelCond::LT: filterKeys<less<int> >(batch.keys, c.key, sel); break;
+      case SelCond::GT: filterKeys<greater<int> >(batch.keys, c.key, sel); break;
+      case SelCond::LE: filterKeys<less_equal<int> >(batch.keys, c.key, sel); break;
+      case SelCond::GE: filterKeys<greater_equal<int> >(batch.keys, c.key, sel); break;
+      }
+    } else if (c.attr == 2) {
+      switch (c.comp) {
+      case SelCond::EQ: filterValueEquals(batch.values, c.value, true, sel); break;
+      case SelCond::NE: filterValueEquals(batch.values, c.value, false, sel); break;
+      case SelCond::LT: filterValues<less<int> >(batch.values, c.value, sel); break;
+      case SelCond::GT: filterValues<greater<int> >(batch.values, c.value, sel); break;
+      case SelCond::LE: filterValues<less_equal<int> >(batch.values, c.value, sel); break;
+      case SelCond::GE: filterValues<greater_equal<int> >(batch.values, c.value, sel); break;
+      }
+    }
+  }
+}
+
+bool BatchFilter::cheaper(const Cond& a, const Cond& b)
+{
+  return costRank(a.attr, a.comp) < costRank(b.attr, b.comp);
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef ROWBATCH_H
+#define ROWBATCH_H
+
+#include <string>
+#include <vector>
+#include "SqlEngine.h"
+
+/**
+ * a batch of tuples stored column by column.
+ * the selection vector lists the positions of the tuples that passed
+ * the filters applied to the batch so far.
+ */
+struct RowBatch {
+  static const int CAPACITY = 1024;  // # tuples collected before a batch is processed
+
+  std::vector<int>         keys;    // the key column
+  std::vector<std::string> values;  // the value column
+  std::vector<int>         sel;     // the positions of the selected tuples
+
+  /**
+   * move the tuples in the vectors to the end of the batch.
+   * the vectors are left with unspecified strings.
+   * @param k[IN] the keys of the tuples
+   * @param v[IN/OUT] the values of the tuples
+   */
+  void append(const std::vector<int>& k, std::vector<std::string>& v);
+
+  /**
+   * select all tuples in the batch.
+   */
+  void selectAll();
+
+  /**
+   * remove all tuples from the batch.
+   */
+  void clear();
+
+  /**
+   * @return # tuples in the batch
+   */
+  int size() const { return keys.size(); }
+};
+
+/**
+ * the conditions of a WHERE clause compiled for evaluation over a batch.
+ * the comparison values are converted once, and each condition runs as
+ * one loop over the selection vector specialized for its comparator.
+ * the conditions on key run before the string comparisons on value.
+ */
+class BatchFilter {
+ public:
+  /**
+   * compile the conditions.
+   * @param cond[IN] the conditions ANDed together
+   */
+  BatchFilter(const std::vector<SelCond>& cond);
+
+  /**
+   * remove the tuples failing any condition from the selection vector.
+   * @param batch[IN/OUT] the batch to filter
+   */
+  void apply(RowBatch& batch) const;
+
+ private:
+  // a condition with its comparison value converted to the column type
+  struct Cond {
+    int                 attr;   // 1: key, 2: value
+    SelCond::Comparator comp;
+    int                 key;    // the value compared to key
+    std::string         value;  // the value compared to value
+  };
+
+  /**
+   * @return true if condition a is cheaper to evaluate than b
+   */
+  static bool cheaper(const Cond& a, const Cond& b);
+
+  std::vector<Cond> conds;  // the conditions, cheapest first
+};
+
+#endif // ROWBATCH_H
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include <cstdio>
+#include <cstring>
+#include "RunFile.h"
+
+using namespace std;
+
+RC RunWriter::open(const string& filename)
+{
+  remove(filename.c_str());
+  pid = 0;
+  count = 0;
+  offset = sizeof(short);
+  return pf.open(filename, 'w');
+}
+
+RC RunWriter::append(int key, const string& value)
+{
+  RC  rc;
+  int size = sizeof(int) + 1 + value.size();
+
+  if (offset + size > PageFile::PAGE_SIZE && (rc = flush()) < 0) return rc;
+  memcpy(page + offset, &key, sizeof(int));
+  page[offset + sizeof(int)] = (char) value.size();
+  memcpy(page + offset + sizeof(int) + 1, value.data(), value.size());
+  offset += size;
+  count++;
+  return 0;
+}
+
+RC RunWriter::close()
+{
+  RC rc = flush();
+  pf.close();
+  return rc;
+}
+
+RC RunWriter::flush()
+{
+  RC rc;
+
+  if (count == 0) return 0;
+  memcpy(page, &count, sizeof(short));
+  if ((rc = pf.write(pid, page)) < 0) return rc;
+  pid++;
+  count = 0;
+  offset = sizeof(short);
+  return 0;
+}
+
+
+RC RunReader::open(const string& filename)
+{
+  pid = -1;
+  count = 0;
+  pos = 0;
+  offset = 0;
+  return pf.open(filename, 'r');
+}
+
+RC RunReader::next(int& key, string& value)
+{
+  RC rc;
+
+  // move to the next page at the end of a page
+  if (pos == count) {
+    if (pid + 1 >= pf.endPid()) return RC_END_OF_TREE;
+    if ((rc = pf.read(pid + 1, page)) < 0) return rc;
+    short n;
+    memcpy(&n, page, sizeof(short));
+    pid++;
+    count = n;
+    pos = 0;
+    offset = sizeof(short);
+  }
+
+  const char* t = page + offset;
+  int         len = (unsigned char) t[sizeof(int)];
+  memcpy(&key, t, sizeof(int));
+  value.assign(t + sizeof(int) + 1, len);
+  offset += sizeof(int) + 1 + len;
+  pos++;
+  return 0;
+}
+
+RC RunReader::close()
+{
+  return pf.close();
+}
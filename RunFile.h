@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef RUNFILE_H
+#define RUNFILE_H
+
+#include <string>
+#include "Bruinbase.h"
+#include "PageFile.h"
+
+/**
+ * a temporary file of (key, value) tuples written and read sequentially
+ * a page at a time, used for the runs of a sort and the partitions of a
+ * hash operator.
+ *
+ * A page holds a short count followed by the tuples, each stored as
+ * [int key][unsigned char length][value].
+ */
+class RunWriter {
+ public:
+  /**
+   * create the file, replacing an old one.
+   * @param filename[IN] the name of the file
+   * @return error code. 0 if no error
+   */
+  RC open(const std::string& filename);
+
+  /**
+   * append a tuple to the file.
+   * @param key[IN] the key of the tuple
+   * @param value[IN] the value of the tuple
+   * @return error code. 0 if no error
+   */
+  RC append(int key, const std::string& value);
+
+  /**
+   * write the last page and close the file.
+   * @return error code. 0 if no error
+   */
+  RC close();
+
+ private:
+  // write the page in the buffer
+  RC flush();
+
+  PageFile pf;
+  PageId   pid;     // the page in the buffer
+  short    count;   // # tuples in the page
+  int      offset;  // the end of the tuples in the page
+  char     page[PageFile::PAGE_SIZE];
+};
+
+class RunReader {
+ public:
+  /**
+   * open a file written by RunWriter.
+   * @param filename[IN] the name of the file
+   * @return error code. 0 if no error
+   */
+  RC open(const std::string& filename);
+
+  /**
+   * read the next tuple in the file.
+   * @param key[OUT] the key of the tuple
+   * @param value[OUT] the value of the tuple
+   * @return 0 if a tuple is read, RC_END_OF_TREE after the last tuple,
+   *         or an error code
+   */
+  RC next(int& key, std::string& value);
+
+  /**
+   * close the file.
+   * @return error code. 0 if no error
+   */
+  RC close();
+
+ private:
+  PageFile pf;
+  PageId   pid;     // the page in the buffer
+  int      count;   // # tuples in the page
+  int      pos;     // # tuples of the page read so far
+  int      offset;  // the offset of the next tuple in the page
+  char     page[PageFile::PAGE_SIZE];
+};
+
+#endif // RUNFILE_H
@@ -10,11 +10,28 @@
 #include <cstdio>
 #include <cstring>
 #include <cstdlib>
+#include <climits>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <fstream>
 #include "Bruinbase.h"
 #include "SqlEngine.h"
 #include "BTreeIndex.h"
+#include "ValueIndex.h"
+#include "HashIndex.h"
+#include "ClusteredFile.h"
+#include "TableStats.h"
+#include "BTreeNode.h"
+#include "RowBatch.h"
+#include "ResultSink.h"
+#include "ExternalSorter.h"
+#include "HashAggregator.h"
+#include "HashJoin.h"
+#include "ParallelScan.h"
+#include "LoadPipeline.h"
+#include "LoadTokenizer.h"
 
 using namespace std;
 
@@ -22,6 +39,160 @@ using namespace std;
 extern FILE* sqlin;
 int sqlparse(void);
 
+// the part of the selected tuples printed by a SELECT, from its
+// LIMIT and OFFSET. count(*) counts all selected tuples regardless.
+struct OutputWindow {
+  int skip;      // # selected tuples still to skip
+  int left;      // # tuples still to print. negative if unlimited
+  int batches;   // # batches processed so far
+
+  // true if no more tuples are printed, so the query can stop reading
+  bool done(int attr) const { return attr != 4 && left == 0; }
+
+  // true if the next selected tuple is printed
+  bool take() {
+    if (left == 0) return false;
+    if (skip > 0) {
+      skip--;
+      return false;
+    }
+    if (left > 0) left--;
+    return true;
+  }
+
+  // # tuples to collect before a batch is processed. a small window
+  // is filled by a small batch, so that the query reads no further.
+  // the batches double in size when the conditions reject tuples.
+  int batchSize(int attr) const {
+    if (attr == 4 || left < 0) return RowBatch::CAPACITY;
+    long long n = (long long) skip + left;
+    if (n == 0) n = 1;
+    n <<= (batches < 16) ? batches : 16;
+    return (n < RowBatch::CAPACITY) ? (int) n : RowBatch::CAPACITY;
+  }
+};
+
+// a join of two tables on key, while the tuples of one of them are read.
+// the tuples read are the outer tuples of an index nested-loop join, or
+// the build or the probe tuples of a hash join.
+struct JoinState {
+  const vector<JoinColumn>* columns;  // the columns printed. empty for count(*)
+  int                outer;        // the table (0 or 1) whose tuples are read
+  HashJoin*          hash;         // the hash join, or NULL
+  bool               building;     // true while the build tuples are read
+  BTreeIndex*        index;        // the key index of the inner table of a nested-loop join
+  const RecordFile*  inner;        // the inner table of a nested-loop join
+  const BatchFilter* innerFilter;  // the conditions on the inner table
+  bool               innerValues;  // true if the values of the inner table are needed
+  long long          count;        // # joined tuples
+};
+
+// where the selected tuples of a query go: printed in the window, or
+// collected by the sorter of ORDER BY, the aggregator of GROUP BY or a join
+struct QueryOutput {
+  OutputWindow    window;      // the LIMIT and OFFSET of the printed tuples
+  ExternalSorter* sorter;      // the sort of ORDER BY, or NULL
+  HashAggregator* aggregator;  // the groups of an aggregate query, or NULL
+  JoinState*      join;        // the join the tuples take part in, or NULL
+  ResultSink*     sink;        // the printed result
+};
+
+// the format of the result of SELECT, set by SET OUTPUT
+static ResultSink::Format outputFormat = ResultSink::TEXT;
+
+// # bytes of tuples an ORDER BY sorts in memory, set by SET sort_memory
+static int sortMemory = 4096 * 1024;
+
+// # bytes of groups a GROUP BY keeps in memory, set by SET group_memory
+static int groupMemory = 4096 * 1024;
+
+// # bytes of build tuples a hash join keeps in memory, set by SET join_memory
+static int joinMemory = 4096 * 1024;
+
+// # threads a full table scan runs on, set by SET scan_threads.
+// one per processor by default.
+static int scanThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+// # threads parsing the load file of a LOAD, set by SET load_threads.
+// one per processor by default.
+static int loadThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+// the interval [lo, hi] of keys allowed by the conditions on key.
+// lo > hi if the conditions contradict each other.
+struct KeyRange {
+  long long lo;
+  long long hi;
+};
+
+// derive the key interval from all conditions on key
+static KeyRange keyRange(const vector<SelCond>& cond);
+
+// run a SELECT and send the selected tuples to the output
+static RC selectTuples(int attr, const string& table, const vector<SelCond>& cond,
+                       const SelOptions& options, QueryOutput& out);
+
+// filter a batch and send the selected tuples to the output.
+// return # selected tuples. the batch is cleared.
+static int processBatch(int attr, const BatchFilter& filter, RowBatch& batch, QueryOutput& out);
+
+// send the tuples in the selection vector of a filtered batch to the output.
+// return # selected tuples. the batch is cleared.
+static int emitBatch(int attr, RowBatch& batch, QueryOutput& out);
+
+// send the results of a started parallel scan to the output, adding
+// # selected tuples to count
+static RC drainScan(int attr, ParallelScan& scan, RowBatch& batch, QueryOutput& out,
+                    int& count);
+
+// sort the tuples in the sorter and write those in the LIMIT and OFFSET to the sink
+static RC writeSorted(int attr, ExternalSorter& sorter, const SelOptions& options,
+                      ResultSink& sink);
+
+// add the tuples of a table from a RecordId on to its value index. the
+// index is built over all tuples from RecordId (0, 0).
+static RC buildValueIndex(const string& table, const RecordFile& rf, const RecordId& from);
+
+// build the key index of the table from a scan of its pages, reporting
+// the progress of the scan
+static RC buildKeyIndex(const string& table, const RecordFile& rf);
+
+// the estimated # pages read by a key index scan over rows tuples
+static double indexScanCost(const TableStats& stats, double rows, bool indexOnly);
+
+// write a group as a row of the items of an aggregate query. the
+// aggregates of a group without tuples are NULL, and its count is 0.
+static void writeGroup(const vector<SelItem>& items, const HashAggregator::Group& g,
+                       ResultSink& sink);
+
+// find the smallest and the largest key in the key range of the
+// conditions from the ends of the range in the key index. group.count
+// is set to 0 if there is no such key.
+static RC indexMinMax(const string& table, const vector<SelCond>& cond,
+                      HashAggregator::Group& group);
+
+// join the selected tuples of a batch with the other table of the join
+static RC joinBatch(const RowBatch& batch, QueryOutput& out);
+
+// join two tables with a key index on both by walking their leaves in key order
+static RC mergeJoin(const string table[2], const vector<SelCond> cond[2],
+                    const bool values[2], QueryOutput& out);
+
+// write a joined tuple as a row of the columns of the join, or count it
+static void writeJoined(QueryOutput& out, int key, const string& outerValue,
+                        const string& innerValue);
+
+// the estimated # tuples of a table in the key range of the conditions,
+// and # pages of the table
+static void estimateTable(const string& table, const vector<SelCond>& cond,
+                          double& rows, double& pages);
+
+// execute a SELECT statement on an index-organized table
+static RC selectClustered(int attr, ClusteredFile& cf, const vector<SelCond>& cond,
+                          QueryOutput& out);
+
+// load tuples into an index-organized table
+static RC loadClustered(const string& table, const string& loadfile, int options);
+
 
 RC SqlEngine::run(FILE* commandline)
 {
@@ -35,7 +206,17 @@ RC SqlEngine::run(FILE* commandline)
   return 0;
 }
 
-RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond)
+RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond,
+                     const SelOptions& options)
+{
+  ResultSink  sink(stdout, outputFormat);
+  QueryOutput out = { { options.offset, options.limit, 0 }, NULL, NULL, NULL, &sink };
+
+  return selectTuples(attr, table, cond, options, out);
+}
+
+static RC selectTuples(int attr, const string& table, const vector<SelCond>& cond,
+                       const SelOptions& options, QueryOutput& out)
 {
   RecordFile rf;   // RecordFile containing the table
   RecordId   rid;  // record cursor for table scanning
@@ -51,9 +232,60 @@ RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond)
   BTreeIndex btIdx;
   IndexCursor cursor;
 
-  int equalKey=-1;
-  bool hasEqual=false;
-  int minKey = -0x7fffffff;
+  KeyRange range = keyRange(cond);
+
+  HashIndex hIdx;
+  bool useHashIndex = false;
+  bool hasKeyEqual = false;
+  int  keyEqual = 0;
+
+  ValueIndex vIdx;
+  bool useValueIndex = false;
+  bool hasLowValue = false, lowInclusive = true;
+  bool hasHighValue = false, highInclusive = true;
+  string lowValue, highValue;
+
+  TableStats stats;
+  bool valueNeeded = (attr == 2 || attr == 3);
+  bool indexOnly;
+
+  // the conditions are compiled once for all tuples
+  BatchFilter filter(cond);
+  RowBatch    batch;
+
+  // ORDER BY key or value ascending may be served in the order of an
+  // index. otherwise the selected tuples go through the sorter.
+  bool orderByKey = (attr != 4 && options.orderAttr == 1 && !options.descending);
+  bool orderByValue = (attr != 4 && options.orderAttr == 2 && !options.descending);
+  bool ordered;
+  ExternalSorter  sort(table + ".sort", options.orderAttr, options.descending, sortMemory);
+
+  // contradictory conditions on key match no tuple. the table is not read.
+  if (range.lo > range.hi) {
+    if (attr == 4 && out.window.skip == 0 && out.window.left != 0) {
+      out.sink->writeCount(0);
+    }
+    return 0;
+  }
+
+  // an index-organized table is read from its B+tree
+  ClusteredFile cf;
+  if (cf.open(table + ".iot", 'r') == 0) {
+    ordered = (attr == 4 || options.orderAttr == 0 || orderByKey);
+    if (!ordered) {
+      out.sorter = &sort;
+      out.window.skip = 0;
+      out.window.left = -1;
+    }
+    rc = selectClustered(attr, cf, cond, out);
+    cf.close();
+    if (rc == 0 && out.sorter != NULL) {
+      rc = writeSorted(attr, sort, options, *out.sink);
+    }
+    out.sorter = NULL;
+    return rc;
+  }
+
   // open the table file
   if ((rc = rf.open(table + ".tbl", 'r')) < 0) {
     fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
@@ -64,297 +296,1399 @@ RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond)
     hasIndex=false;
   else
     hasIndex=true;
-  if(attr == 4&&hasIndex){
+  // the key or count(*) of tuples with only conditions on key are
+  // answered from the index entries, without reading the table
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr == 2) valueNeeded = true;
+  }
+  indexOnly = !valueNeeded && (attr == 1 || attr == 4);
+  if(indexOnly&&hasIndex){
     useIndex = true;
   }
   if(hasIndex){//to check whether we need to use index.
       for (unsigned i = 0; i < cond.size(); i++) {
-          if (cond[i].attr==2)
-            continue;
-          else if (cond[i].attr==1) {
-                switch(cond[i].comp){
-                  case SelCond::EQ:
-                    useIndex=true;
-                    hasEqual=true;
-                    equalKey = atoi(cond[i].value);
-                    break;
-                  case SelCond::LT:
-                    useIndex=true;
-                    break;
-                  case SelCond::GT:
-                    useIndex=true;
-                    if (atoi(cond[i].value) > minKey)
-                      minKey = atoi(cond[i].value);
-                    break;                  
-                  case SelCond::LE:
-                    useIndex=true;
-                    break;                  
-                  case SelCond::GE:
-                    if (atoi(cond[i].value) > minKey)
-                      minKey = atoi(cond[i].value);
-                    useIndex=true;
-                    break;                  
-                  default: //if NE not equal, has nothing to do with the index
-                    break;
-                }
-          }
-      }  
+          // NE has nothing to do with the index
+          if (cond[i].attr == 1 && cond[i].comp != SelCond::NE)
+            useIndex = true;
+      }
+  }
+
+  // with the statistics of the table, the key index is used only if it
+  // is estimated to read fewer pages than a full scan
+  if (hasIndex && useIndex && stats.load(table + ".sta") == 0) {
+    double rows = stats.estimateRows(range.lo, range.hi);
+    useIndex = (indexScanCost(stats, rows, indexOnly) < stats.getPageCount());
+  }
+
+  // ORDER BY key is served by the B+tree, which returns the tuples in key order
+  if (orderByKey && hasIndex) useIndex = true;
+
+  // a hash index looks up an equality condition on key with the fewest page reads
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr == 1 && cond[i].comp == SelCond::EQ) {
+      hasKeyEqual = true;
+      keyEqual = atoi(cond[i].value);
+      break;
+    }
   }
+  if (hasKeyEqual) {
+    useHashIndex = (hIdx.open(table + ".hdx", 'r') == 0);
+  }
+
+  // collect the range of values allowed by the conditions on value
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr != 2) continue;
+    string v = cond[i].value;
+    bool inclusive = (cond[i].comp != SelCond::GT && cond[i].comp != SelCond::LT);
+    if (cond[i].comp == SelCond::EQ || cond[i].comp == SelCond::GT || cond[i].comp == SelCond::GE) {
+      if (!hasLowValue || v > lowValue || (v == lowValue && !inclusive)) {
+        lowValue = v;
+        lowInclusive = inclusive;
+      }
+      hasLowValue = true;
+    }
+    if (cond[i].comp == SelCond::EQ || cond[i].comp == SelCond::LT || cond[i].comp == SelCond::LE) {
+      if (!hasHighValue || v < highValue || (v == highValue && !inclusive)) {
+        highValue = v;
+        highInclusive = inclusive;
+      }
+      hasHighValue = true;
+    }
+  }
+
+  // the value index is used for a range of values unless the key index
+  // can look up a single key. ORDER BY value is served by the value index,
+  // which returns the tuples in value order.
+  if ((hasLowValue || hasHighValue || orderByValue) && !useHashIndex &&
+      !(hasIndex && range.lo == range.hi) && !(orderByKey && hasIndex)) {
+    useValueIndex = (vIdx.open(table + ".vdx", 'r') == 0);
+  }
+
+  // like the key index, the value index is used for a range of values
+  // only if it is estimated to read fewer pages than a full scan
+  if (useValueIndex && !orderByValue && stats.load(table + ".sta") == 0 && stats.hasValueStats()) {
+    double rows = stats.estimateValueRows(hasLowValue, lowValue, lowInclusive,
+                                          hasHighValue, highValue, highInclusive);
+    if (indexScanCost(stats, rows, false) >= stats.getPageCount()) {
+      vIdx.close();
+      useValueIndex = false;
+    }
+  }
+
+  // the tuples with a single key from the hash index are in any key order
+  ordered = (attr == 4 || options.orderAttr == 0 ||
+             (useHashIndex && options.orderAttr == 1) ||
+             (useValueIndex && orderByValue) ||
+             (!useHashIndex && !useValueIndex && hasIndex && useIndex && orderByKey));
+  if (!ordered) {
+    out.sorter = &sort;
+    out.window.skip = 0;
+    out.window.left = -1;
+  }
+
   //cout<<"hasIndex:  "<<hasIndex<<" useIndex:  "<<useIndex<<endl;
-  if (hasIndex && useIndex)
+  if (useHashIndex)
   {
-    count=0;
-    if (hasEqual){
-    //  cout<<"has Equal Key"<<endl;
-      btIdx.locate(equalKey,cursor);
-    }
-    else
-      btIdx.locate(minKey,cursor);
-    //cout<<"equalKey: "<<equalKey<<" minKey: "<<minKey<<endl;
-    //cout<<"cursor.pid: "<<cursor.pid<<" cursor.eid: "<<cursor.eid<<endl;
-    while(true) {
-        rc=btIdx.readForward(cursor,key,rid);
-        //cout<<"RC: "<<rc<<" key: "<<key <<"cursor.pid: "<<cursor.pid<<" cursor.eid: "<<cursor.eid<<endl;
-        if(rc<0)
-          break;
-        if(rc!=0) //rc may be 1, at the end of a node, but this node is not the end of the tree.
-          continue;
-        //cout<<"key read: "<<key<<endl;
-        //if count(*), we do not need to read the record.
-        if(attr!=4){  
-          if ( (rc = rf.read(rid, key, value)) < 0){
-            goto exit_select;
-          }
+    // fetch the tuples with the key and check the other conditions on them
+    vector<RecordId> rids;
+    count = 0;
+    rc = hIdx.lookup(keyEqual, rids);
+    hIdx.close();
+    if (rc < 0 && rc != RC_NO_SUCH_RECORD) goto exit_select;
+
+    // every tuple found has the key. the table is read only if the
+    // values are needed.
+    vector<int>    keys(rids.size(), keyEqual);
+    vector<string> values(rids.size());
+    if (!indexOnly && (rc = rf.readRecords(rids, keys, values)) < 0) {
+      fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+      goto exit_select;
+    }
+    batch.keys.swap(keys);
+    batch.values.swap(values);
+    count = processBatch(attr, filter, batch, out);
+  }
+  else if (useValueIndex)
+  {
+    // collect the entries in the value range from the index, and read
+    // and check their tuples a batch at a time
+    vector<RecordId> rids;
+    vector<int>      keys;
+    vector<string>   values;
+    bool             atEnd = false;
+    count = 0;
+    vIdx.locate(lowValue, cursor);
+    while (!atEnd && !out.window.done(attr)) {
+      while ((int) rids.size() < out.window.batchSize(attr)) {
+        if ((rc = vIdx.readForward(cursor, value, rid)) < 0) break;
+        if (hasLowValue && !lowInclusive && value == lowValue) continue;
+        if (hasHighValue) {
+          diff = value.compare(highValue);
+          if (diff > 0 || (diff == 0 && !highInclusive)) break;
         }
-        for (unsigned i = 0; i < cond.size(); i++)
-        {
-          switch (cond[i].attr) 
-          {
-              case 1:
-                diff = key - atoi(cond[i].value);
-                break;
-              case 2:
-                diff = strcmp(value.c_str(), cond[i].value);
-                break;
-          }
-          switch (cond[i].comp) {
-            case SelCond::EQ:
-              //cout<<"equal condition, diff is : " <<diff<<endl;
-              if (diff != 0)
-                if (cond[i].attr == 1) 
-                  goto exit_select; // key is not found in the index.        
-                else 
-                  continue; // it is value. continue to next tuple
-              break;
-          case SelCond::NE: //actually it is not possible.
-              if (diff == 0) continue;
-              break;
-          case SelCond::GT:
-              //cout<<"in GT: "<<diff<<endl;
-              //cout<<(diff<=0)<<endl;
-              if (diff <= 0) goto next_idxtuple;
-              break;
-          case SelCond::LT:
-              if (diff >= 0)
-                if (cond[i].attr == 1) goto exit_select;
-                else continue;
-              break;
-          case SelCond::GE:
-              if (diff < 0) goto next_idxtuple;
-              break;
-          case SelCond::LE:
-              if (diff > 0)
-                if (cond[i].attr == 1) goto exit_select;
-                else continue;
-              break;
-          }
+        rids.push_back(rid);
+      }
+      atEnd = ((int) rids.size() < out.window.batchSize(attr));
+      if (rc < 0 && rc != RC_END_OF_TREE) {
+        vIdx.close();
+        goto exit_select;
+      }
+
+      if ((rc = rf.readRecords(rids, keys, values)) < 0) {
+        fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+        vIdx.close();
+        goto exit_select;
+      }
+      batch.keys.swap(keys);
+      batch.values.swap(values);
+      count += processBatch(attr, filter, batch, out);
+      rids.clear();
+    }
+    vIdx.close();
+  }
+  else if (hasIndex && useIndex)
+  {
+    // collect the entries in the key range from the index, a batch at a
+    // time, and stop as soon as the LIMIT is reached
+    vector<int>      keys;
+    vector<RecordId> rids;
+    vector<string>   values;
+    bool             atEnd = false;
+    count = 0;
+
+    // a long key range of a large table is split at the separator keys
+    // of the index, and the sub-ranges are read, with their tuples, by a
+    // pool of threads. the results come back in key order when printed.
+    if (scanThreads > 1 && rf.endPid() >= 2 * ParallelScan::MORSEL_PAGES &&
+        range.lo < range.hi && (attr == 4 || out.window.left < 0)) {
+      bool inOrder = (attr != 4 && out.sorter == NULL &&
+                      out.aggregator == NULL && out.join == NULL);
+      ParallelScan scan(table + ".tbl", table + ".idx", (int) range.lo, (int) range.hi,
+                        filter, indexOnly, inOrder, attr == 4);
+      if (scan.start(scanThreads) == 0) {
+        if ((rc = drainScan(attr, scan, batch, out, count)) < 0) {
+          fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+          goto exit_select;
         }
-      
-
-        count++;
-        // cout<<"print a tuple"<<endl;
-        // cout<<"attr is "<<attr<<endl;
-      // print the tuple 
-      switch (attr) {
-      case 1:  // SELECT key
-        fprintf(stdout, "%d\n", key);
-        break;
-      case 2:  // SELECT value
-        fprintf(stdout, "%s\n", value.c_str());
-        break;
-      case 3:  // SELECT *
-        fprintf(stdout, "%d '%s'\n", key, value.c_str());
-        break;
+        atEnd = true;
       }
-      next_idxtuple:
-        continue;
+    }
 
-     }
+    if (!atEnd) btIdx.locate((int) range.lo, cursor);
+    while (!atEnd && !out.window.done(attr)) {
+      while ((int) rids.size() < out.window.batchSize(attr)) {
+        if ((rc = btIdx.readForward(cursor, key, rid)) < 0) break;
+        if (rc != 0) continue;  // rc is 1 at the end of a node
+        if (key > range.hi) break;
+        keys.push_back(key);
+        rids.push_back(rid);
+      }
+      atEnd = ((int) rids.size() < out.window.batchSize(attr));
 
+      // read the tuples from the table unless only the keys are needed
+      values.resize(rids.size());
+      if (!indexOnly && (rc = rf.readRecords(rids, keys, values)) < 0) {
+        fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+        goto exit_select;
+      }
+
+      // check the conditions on the tuples in key order
+      batch.keys.swap(keys);
+      batch.values.swap(values);
+      count += processBatch(attr, filter, batch, out);
+      keys.clear();
+      rids.clear();
     }
+  }
       else{
           //if index is not used.
-          // scan the table file from the beginning
-          rid.pid = rid.sid = 0;
-          count = 0;
-          while (rid < rf.endRid()) {
-            // read the tuple
-            if ((rc = rf.read(rid, key, value)) < 0) {
-              fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
-              goto exit_select;
+          // an equality condition on value is checked while the pages are
+          // read, against the page dictionary on compressed pages.
+          const char* valueEq = NULL;
+          for (unsigned i = 0; i < cond.size(); i++) {
+            if (cond[i].attr == 2 && cond[i].comp == SelCond::EQ) {
+              valueEq = cond[i].value;
+              break;
             }
+          }
 
-            // check the conditions on the tuple
-            for (unsigned i = 0; i < cond.size(); i++) {
-              // compute the difference between the tuple value and the condition value
-              switch (cond[i].attr) {
-              case 1:
-        	diff = key - atoi(cond[i].value);
-        	break;
-              case 2:
-        	diff = strcmp(value.c_str(), cond[i].value);
-        	break;
-              }
-
-              // skip the tuple if any condition is not met
-              switch (cond[i].comp) {
-              case SelCond::EQ:
-        	if (diff != 0) goto next_tuple;
-        	break;
-              case SelCond::NE:
-        	if (diff == 0) goto next_tuple;
-        	break;
-              case SelCond::GT:
-        	if (diff <= 0) goto next_tuple;
-        	break;
-              case SelCond::LT:
-        	if (diff >= 0) goto next_tuple;
-        	break;
-              case SelCond::GE:
-        	if (diff < 0) goto next_tuple;
-        	break;
-              case SelCond::LE:
-        	if (diff > 0) goto next_tuple;
-        	break;
+          // a large table is scanned by a pool of threads, which read and
+          // filter the pages a morsel at a time. a LIMIT reads no further
+          // than it needs, so it is left to the scan below.
+          bool scanned = false;
+          count = 0;
+          if (scanThreads > 1 && rf.endPid() >= 2 * ParallelScan::MORSEL_PAGES &&
+              (attr == 4 || out.window.left < 0)) {
+            // the tuples are printed in the order of the file, unless
+            // they are counted, sorted, grouped or joined
+            bool inOrder = (attr != 4 && out.sorter == NULL &&
+                            out.aggregator == NULL && out.join == NULL);
+            ParallelScan scan(table + ".tbl", filter, valueEq, inOrder, attr == 4);
+            if (scan.start(scanThreads) == 0) {
+              if ((rc = drainScan(attr, scan, batch, out, count)) < 0) {
+                fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+                goto exit_select;
               }
+              scanned = true;
             }
+          }
 
-            // the condition is met for the tuple. 
-            // increase matching tuple counter
-            count++;
-
-            // print the tuple 
-            switch (attr) {
-            case 1:  // SELECT key
-              fprintf(stdout, "%d\n", key);
-              break;
-            case 2:  // SELECT value
-              fprintf(stdout, "%s\n", value.c_str());
-              break;
-            case 3:  // SELECT *
-              fprintf(stdout, "%d '%s'\n", key, value.c_str());
-              break;
+          // scan the table file from the beginning, a page at a time,
+          // and process the tuples in batches: filter, then print.
+          vector<int>    keys;
+          vector<string> values;
+          for (PageId pid = 0; !scanned && pid < rf.endPid() && !out.window.done(attr); pid++) {
+            // read the tuples in the page
+            if ((rc = rf.readPage(pid, keys, values, valueEq)) < 0) {
+              fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+              goto exit_select;
             }
+            batch.append(keys, values);
 
-            // move to the next tuple
-            next_tuple:
-            ++rid;
+            if (batch.size() >= out.window.batchSize(attr) || pid == rf.endPid() - 1) {
+              count += processBatch(attr, filter, batch, out);
+            }
           }
       }
   // print matching tuple count if "select count(*)"
-  if (attr == 4) {
-    fprintf(stdout, "%d\n", count);
+  if (attr == 4 && out.window.skip == 0 && out.window.left != 0) {
+    out.sink->writeCount(count);
+  }
+
+  // print the tuples collected for ORDER BY in order
+  if (out.sorter != NULL && (rc = writeSorted(attr, sort, options, *out.sink)) < 0) {
+    goto exit_select;
   }
   rc = 0;
 
   // close the table file and return
   exit_select:
+  out.sorter = NULL;
   rf.close();
   return rc;
 }
 
-RC SqlEngine::load(const string& table, const string& loadfile, bool index)
+RC SqlEngine::aggregate(const vector<SelItem>& items, const string& table,
+                        const vector<SelCond>& cond, int group, const SelOptions& options)
+{
+  RC   rc;
+  bool minMaxOnly = (group == 0);
+  bool valueCond = false;
+  int  groups = 0;
+
+  for (unsigned i = 0; i < items.size(); i++) {
+    if (items[i].func == SelItem::NONE && items[i].attr != group) {
+      fprintf(stderr, "Error: a column in the SELECT clause must be the GROUP BY column\n");
+      return RC_INVALID_ATTRIBUTE;
+    }
+    if (items[i].func != SelItem::NONE && items[i].func != SelItem::COUNT &&
+        items[i].attr != 1) {
+      fprintf(stderr, "Error: MIN, MAX, SUM and AVG take the key column\n");
+      return RC_INVALID_ATTRIBUTE;
+    }
+    if (items[i].func != SelItem::MIN && items[i].func != SelItem::MAX) minMaxOnly = false;
+  }
+  if (options.orderAttr != 0) {
+    fprintf(stderr, "Error: ORDER BY is not supported with aggregates\n");
+    return RC_INVALID_ATTRIBUTE;
+  }
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr == 2) valueCond = true;
+  }
+
+  ResultSink              sink(stdout, outputFormat);
+  OutputWindow            window = { options.offset, options.limit, 0 };
+  HashAggregator::Group   g;
+
+  // MIN and MAX of key with only conditions on key are read from the
+  // ends of the key range in the index, without reading the table
+  if (minMaxOnly && !valueCond && indexMinMax(table, cond, g) == 0) {
+    if (window.take()) writeGroup(items, g, sink);
+    return 0;
+  }
+
+  // otherwise the selected tuples are grouped in a hash table. the key
+  // is all that is needed unless the tuples are grouped on value.
+  HashAggregator agg(table + ".group", group, groupMemory);
+  SelOptions     all = { 0, false, -1, 0 };
+  QueryOutput    out = { { 0, -1, 0 }, NULL, &agg, NULL, &sink };
+  if ((rc = selectTuples((group == 2) ? 3 : 1, table, cond, all, out)) < 0) return rc;
+  if ((rc = agg.finish()) < 0) {
+    fprintf(stderr, "Error: while writing a group partition\n");
+    return rc;
+  }
+
+  while (!window.done(3) && (rc = agg.next(g)) == 0) {
+    groups++;
+    if (window.take()) writeGroup(items, g, sink);
+  }
+  if (rc < 0 && rc != RC_END_OF_TREE) {
+    fprintf(stderr, "Error: while reading a group partition\n");
+    return rc;
+  }
+
+  // without GROUP BY, the aggregates of no tuples are still a row
+  if (group == 0 && groups == 0) {
+    g.count = 0;
+    if (window.take()) writeGroup(items, g, sink);
+  }
+
+  return 0;
+}
+
+RC SqlEngine::join(const vector<JoinColumn>& columns, const string& table1,
+                   const string& table2, const vector<SelCond>& conds1,
+                   const vector<SelCond>& conds2, const SelOptions& options)
+{
+  RC              rc;
+  string          table[2] = { table1, table2 };
+  const vector<SelCond>* given[2] = { &conds1, &conds2 };
+  vector<SelCond> cond[2] = { conds1, conds2 };
+  bool            values[2] = { false, false };
+  double          rows[2], pages[2], leaves[2], scan[2];
+  bool            indexed[2];
+  double          perLeaf = BTLeafNode::MAX_LEAF_COUNT * 0.69;
+  double          cost, hashCost, innerCost = 0;
+  int             inner = -1;
+  bool            merge = false;
+
+  if (options.orderAttr != 0) {
+    fprintf(stderr, "Error: ORDER BY is not supported with joins\n");
+    return RC_INVALID_ATTRIBUTE;
+  }
+
+  // the conditions on key hold for both tables, since the keys are equal
+  for (int t = 0; t < 2; t++) {
+    for (unsigned i = 0; i < given[t]->size(); i++) {
+      if ((*given[t])[i].attr == 1) cond[1 - t].push_back((*given[t])[i]);
+      else values[t] = true;
+    }
+  }
+  for (unsigned i = 0; i < columns.size(); i++) {
+    if (columns[i].attr == 2) values[columns[i].table] = true;
+  }
+
+  // the estimated # pages read to select the tuples of a table: the leaves
+  // of its key index if only the keys are needed, or the table
+  for (int t = 0; t < 2; t++) {
+    BTreeIndex idx;
+    estimateTable(table[t], cond[t], rows[t], pages[t]);
+    indexed[t] = (idx.open(table[t] + ".idx", 'r') == 0);
+    if (indexed[t]) idx.close();
+    leaves[t] = rows[t] / perLeaf;
+    scan[t] = (indexed[t] && !values[t]) ? min(leaves[t], pages[t]) : pages[t];
+  }
+
+  // a hash join reads both tables, and writes and reads them again when
+  // the build table does not fit in join_memory
+  hashCost = scan[0] + scan[1];
+  if (min(scan[0], scan[1]) * PageFile::PAGE_SIZE > joinMemory) hashCost *= 3;
+
+  // an index nested-loop join reads the outer table, and looks up the key
+  // index of the inner table: a leaf per outer tuple, and a table page if
+  // the inner values are needed
+  for (int t = 0; t < 2; t++) {
+    cost = scan[1 - t] + rows[1 - t] * (values[t] ? 2 : 1);
+    if (indexed[t] && cost < hashCost && (inner < 0 || cost < innerCost)) {
+      inner = t;
+      innerCost = cost;
+    }
+  }
+
+  // when both tables have a key index, a merge join reads the leaves of
+  // both in the key range, and the table pages of the values needed, in
+  // a single pass without memory for the tuples. it is preferred to the
+  // other joins unless they are estimated to read fewer pages.
+  if (indexed[0] && indexed[1]) {
+    cost = 0;
+    for (int t = 0; t < 2; t++) cost += leaves[t] + (values[t] ? pages[t] : 0);
+    merge = (cost <= hashCost && (inner < 0 || cost <= innerCost));
+  }
+
+  ResultSink  sink(stdout, outputFormat);
+  SelOptions  all = { 0, false, -1, 0 };
+  BatchFilter filter0(cond[0]), filter1(cond[1]);
+  JoinState   js = { &columns, 0, NULL, false, NULL, NULL, NULL, false, 0 };
+  QueryOutput out = { { options.offset, options.limit, 0 }, NULL, NULL, &js, &sink };
+
+  if (merge) {
+    rc = mergeJoin(table, cond, values, out);
+  } else if (inner >= 0) {
+    BTreeIndex idx;
+    RecordFile rf;
+    int        outer = 1 - inner;
+    if ((rc = idx.open(table[inner] + ".idx", 'r')) < 0) return rc;
+    if ((rc = rf.open(table[inner] + ".tbl", 'r')) < 0) {
+      fprintf(stderr, "Error: table %s does not exist\n", table[inner].c_str());
+      idx.close();
+      return rc;
+    }
+    js.outer = outer;
+    js.index = &idx;
+    js.inner = &rf;
+    js.innerFilter = (inner == 0) ? &filter0 : &filter1;
+    js.innerValues = values[inner];
+    rc = selectTuples(values[outer] ? 3 : 1, table[outer], cond[outer], all, out);
+    idx.close();
+    rf.close();
+  } else {
+    // the hash join builds on the table with fewer tuples
+    int      build = (rows[1] < rows[0]) ? 1 : 0;
+    HashJoin hj(table[build] + ".join", joinMemory);
+    int      key;
+    string   buildValue, probeValue;
+
+    QueryOutput bout = { { 0, -1, 0 }, NULL, NULL, &js, &sink };
+    js.hash = &hj;
+    js.building = true;
+    js.outer = build;
+    if ((rc = selectTuples(values[build] ? 3 : 1, table[build], cond[build], all, bout)) < 0) {
+      return rc;
+    }
+
+    js.building = false;
+    js.outer = 1 - build;
+    rc = selectTuples(values[1 - build] ? 3 : 1, table[1 - build], cond[1 - build], all, out);
+    if (rc == 0 && (rc = hj.finish()) == 0) {
+      // the matches of the spilled tuples
+      while (!out.window.done(3) && (rc = hj.next(key, buildValue, probeValue)) == 0) {
+        writeJoined(out, key, probeValue, buildValue);
+      }
+      if (rc == RC_END_OF_TREE) rc = 0;
+    }
+    if (rc < 0) fprintf(stderr, "Error: while reading a join partition\n");
+  }
+  if (rc < 0) return rc;
+
+  // print the # joined tuples if "select count(*)"
+  if (columns.empty() && out.window.skip == 0 && out.window.left != 0) {
+    sink.writeColumn(js.count);
+    sink.endRow();
+  }
+
+  return 0;
+}
+
+RC SqlEngine::setOutputFormat(const string& format)
+{
+  if (strcasecmp(format.c_str(), "text") == 0) outputFormat = ResultSink::TEXT;
+  else if (strcasecmp(format.c_str(), "csv") == 0) outputFormat = ResultSink::CSV;
+  else if (strcasecmp(format.c_str(), "binary") == 0) outputFormat = ResultSink::BINARY;
+  else {
+    fprintf(stderr, "Error: unknown output format %s. use text, csv or binary\n", format.c_str());
+    return RC_INVALID_ATTRIBUTE;
+  }
+  return 0;
+}
+
+RC SqlEngine::setParameter(const string& name, int value)
+{
+  if (strcasecmp(name.c_str(), "sort_memory") == 0) {
+    if (value < 1) {
+      fprintf(stderr, "Error: sort_memory must be at least 1 KB\n");
+      return RC_INVALID_ATTRIBUTE;
+    }
+    sortMemory = (value < INT_MAX / 1024) ? value * 1024 : INT_MAX;
+    return 0;
+  }
+  if (strcasecmp(name.c_str(), "join_memory") == 0) {
+    if (value < 1) {
+      fprintf(stderr, "Error: join_memory must be at least 1 KB\n");
+      return RC_INVALID_ATTRIBUTE;
+    }
+    joinMemory = (value < INT_MAX / 1024) ? value * 1024 : INT_MAX;
+    return 0;
+  }
+  if (strcasecmp(name.c_str(), "group_memory") == 0) {
+    if (value < 1) {
+      fprintf(stderr, "Error: group_memory must be at least 1 KB\n");
+      return RC_INVALID_ATTRIBUTE;
+    }
+    groupMemory = (value < INT_MAX / 1024) ? value * 1024 : INT_MAX;
+    return 0;
+  }
+  if (strcasecmp(name.c_str(), "scan_threads") == 0) {
+    if (value < 1 || value > ParallelScan::MAX_THREADS) {
+      fprintf(stderr, "Error: scan_threads must be between 1 and %d\n", ParallelScan::MAX_THREADS);
+      return RC_INVALID_ATTRIBUTE;
+    }
+    scanThreads = value;
+    return 0;
+  }
+  if (strcasecmp(name.c_str(), "load_threads") == 0) {
+    if (value < 1 || value > LoadPipeline::MAX_THREADS) {
+      fprintf(stderr, "Error: load_threads must be between 1 and %d\n", LoadPipeline::MAX_THREADS);
+      return RC_INVALID_ATTRIBUTE;
+    }
+    loadThreads = value;
+    return 0;
+  }
+
+  fprintf(stderr, "Error: unknown parameter %s\n", name.c_str());
+  return RC_INVALID_ATTRIBUTE;
+}
+
+RC SqlEngine::load(const string& table, const string& loadfile, int options)
 {
   /* your code here */
-  RecordFile rf;
-  rf.open(table+".tbl",'w');
-  ifstream infile;
-  infile.open(loadfile.c_str(),ifstream::in);
- // infile.open (loadfile.c_str(), std::fstream::in | std::fstream::out | std::fstream::app);
-  if (!infile.is_open()){
-      fprintf(stderr, "Error: failed to open file, %s\n",loadfile.c_str()); 
-      return -1;
+  ClusteredFile cf;
+  if (!(options & LOAD_CLUSTERED) && cf.open(table + ".iot", 'r') == 0) {
+    cf.close();
+    options |= LOAD_CLUSTERED;
   }
-  int key;
-  string value;
-  string line;
-  RecordId rid;
-  RC rc;
+  if (options & LOAD_CLUSTERED)
+    return loadClustered(table, loadfile, options);
+
+  bool       index = (options & LOAD_INDEX) != 0;
+  bool       hash = (options & LOAD_HASH_INDEX) != 0;
+  bool       indexed = false;  // the key index existed before the load
+  bool       hashed = false;   // the hash index existed before the load
+  bool       btOpen = false;
+  bool       hashOpen = false;
+  RecordFile rf;
   BTreeIndex btIdx;
-  if (index){ //open Btree index file.
-      string idxName = table+".idx";
-      if ((rc=btIdx.open(idxName,'w'))<0) {
-        return rc;
-      } 
+  HashIndex  hIdx;
+  TableStats stats;
+  ValueIndex vIdx;
+  RC         rc;
+
+  // the load file, the table and the indexes are opened in this order, so
+  // that a load file that cannot be read leaves no file behind. the
+  // load file is read and parsed by a pipeline of threads, and the hash
+  // index is built and the keys sorted by another thread, while this
+  // thread appends the tuples to the table in the order of the file. the
+  // sorted keys are merged into the key index at the end.
+  LoadPipeline     pipeline(loadfile, table + ".isort", sortMemory);
+  vector<Record>   records;
+  vector<int>      keys;
+  vector<RecordId> rids;
+  long long        lines = 0;
+  RC               parseRc;
+  RC               loadRc = 0;  // the error of the tuples loaded
+  RecordId         loadStart;   // the first tuple loaded
+
+  if ((rc = pipeline.open()) < 0) {
+    fprintf(stderr, "Error: failed to open file, %s\n", loadfile.c_str());
+    return rc;
+  }
+  if ((rc = rf.open(table + ".tbl", 'w')) < 0) {
+    fprintf(stderr, "Error: failed to open table %s\n", table.c_str());
+    return rc;
+  }
+  loadStart = rf.endRid();
+  if (options & LOAD_DICTIONARY)
+    rf.setPageFormat(RecordFile::DICTIONARY);
+  if ((options & LOAD_COMPRESSION) && rf.compressExtents() < 0) {
+    fprintf(stderr, "Error: table %s is not empty and cannot be compressed\n", table.c_str());
+    rc = RC_FILE_NOT_EMPTY;
+    goto exit_load;
+  }
+
+  // an existing key index is kept up to date with the loaded tuples. a
+  // new one first covers the tuples already in the table.
+  if (btIdx.open(table + ".idx", 'r') == 0) {
+    btIdx.close();
+    indexed = index = true;
+  }
+  if (index && !indexed && rf.endPid() > 0 && (rc = buildKeyIndex(table, rf)) < 0) {
+    goto exit_load;
+  }
+  if (index) {
+    if ((rc = btIdx.open(table + ".idx", 'w')) < 0) {
+      fprintf(stderr, "Error: failed to open the index of table %s\n", table.c_str());
+      goto exit_load;
+    }
+    btOpen = true;
+  }
+
+  // an existing hash index is kept up to date with the loaded tuples
+  if (hIdx.open(table + ".hdx", 'r') == 0) {
+    hIdx.close();
+    hashed = hash = true;
+  }
+  if (hash) {
+    if ((rc = hIdx.open(table + ".hdx", 'w')) < 0) {
+      fprintf(stderr, "Error: failed to open the hash index of table %s\n", table.c_str());
+      goto exit_load;
+    }
+    hashOpen = true;
+  }
+
+  if ((rc = pipeline.start(loadThreads, index ? &btIdx : NULL, hash ? &hIdx : NULL)) < 0) {
+    fprintf(stderr, "Error: failed to start loading %s\n", loadfile.c_str());
+    goto exit_load;
+  }
+  // a tuple that is appended to the table is also given to the indexes,
+  // even if the load fails later, so that the table and its indexes agree
+  while ((parseRc = pipeline.next(records)) != RC_END_OF_TREE) {
+    // the records of a chunk fill whole pages, each written once. if a
+    // page cannot be written, the records stored before it are indexed.
+    RecordId none = { -1, -1 };
+    rids.assign(records.size(), none);
+    if (!records.empty() && (loadRc = rf.appendMany(&records[0], records.size(), &rids[0])) < 0) {
+      fprintf(stderr, "Error: failed to append to table %s\n", table.c_str());
+      size_t n = 0;
+      while (n < rids.size() && rids[n].pid >= 0 && rids[n] < rf.endRid()) n++;
+      records.resize(n);
+      rids.resize(n);
+    }
+    lines += rids.size();
+    if (index || hash) {
+      for (unsigned i = 0; i < rids.size(); i++) keys.push_back(records[i].key);
+      if ((rc = pipeline.index(keys, rids)) < 0) {
+        fprintf(stderr, "Error: failed to insert into the indexes of table %s\n", table.c_str());
+        if (loadRc == 0) loadRc = rc;
+      }
+    }
+    if (loadRc < 0) break;
+    if (parseRc == RC_INVALID_FILE_FORMAT) {
+      fprintf(stderr, "Error: failed to parse line %lld of %s\n", lines + 1, loadfile.c_str());
+      loadRc = RC_INVALID_FILE_FORMAT;
+      break;
+    }
+  }
+  if ((rc = pipeline.finish()) < 0) {
+    fprintf(stderr, "Error: failed to insert into the indexes of table %s\n", table.c_str());
+    goto exit_load;
+  }
+
+  // the statistics, if gathered before, count the loaded tuples.
+  // ANALYZE rebuilds their histograms.
+  if (stats.load(table + ".sta") == 0 &&
+      ((rc = stats.update(rf, loadStart)) < 0 || (rc = stats.save(table + ".sta")) < 0)) {
+    fprintf(stderr, "Error: failed to update the statistics of table %s\n", table.c_str());
+  }
+  rc = 0;
+
+  // the loaded tuples are merged into an existing value index, and a new
+  // one covers all tuples. a failed load creates no value index, but
+  // keeps an existing one up to date.
+  if (vIdx.open(table + ".vdx", 'r') == 0) {
+    vIdx.close();
+    rc = buildValueIndex(table, rf, loadStart);
+  } else if ((options & LOAD_VALUE_INDEX) && loadRc == 0) {
+    RecordId first = { 0, 0 };
+    rc = buildValueIndex(table, rf, first);
+  }
+  if (loadRc < 0) rc = loadRc;
+
+  exit_load:
+  // an index this load created is dropped if the load fails, so that no
+  // index is left that disagrees with the table
+  rf.close();
+  if (btOpen) btIdx.close();
+  if (hashOpen) hIdx.close();
+  if (rc < 0 && index && !indexed) remove((table + ".idx").c_str());
+  if (rc < 0 && hash && !hashed) remove((table + ".hdx").c_str());
+  return rc;
+}
+
+RC SqlEngine::analyze(const string& table)
+{
+  RecordFile rf;
+  TableStats stats;
+  RC         rc;
+
+  if ((rc = rf.open(table + ".tbl", 'r')) < 0) {
+    fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
+    return rc;
+  }
+
+  if ((rc = stats.compute(rf)) < 0) {
+    fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+  } else if ((rc = stats.save(table + ".sta")) < 0) {
+    fprintf(stderr, "Error: failed to write the statistics of table %s\n", table.c_str());
   }
-  while (getline(infile,line)){
-      if(parseLoadLine(line,key,value) != 0){ //parse the line into key and value
-        fprintf(stderr, "Error: failed to parse, key: %d  value: %s\n",key,value.c_str()); 
-        return -1;
+
+  rf.close();
+  return rc;
+}
+
+RC SqlEngine::createIndex(const string& table, int attr)
+{
+  RecordFile rf;
+  RC         rc;
+
+  if (attr != 1 && attr != 2) {
+    fprintf(stderr, "Error: an index can be created only on the key or the value column\n");
+    return RC_INVALID_ATTRIBUTE;
+  }
+
+  if ((rc = rf.open(table + ".tbl", 'r')) < 0) {
+    fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
+    return rc;
+  }
+
+  RecordId first = { 0, 0 };
+  rc = (attr == 1) ? buildKeyIndex(table, rf) : buildValueIndex(table, rf, first);
+  rf.close();
+  return rc;
+}
+
+RC SqlEngine::parseLoadLine(const string& line, int& key, string& value)
+{
+    const char* v;
+    int         length;
+    RC          rc;
+
+    if ((rc = parseLoadLine(line.data(), line.data() + line.size(), key, v, length)) < 0) {
+      return rc;
+    }
+    value.assign(v, length);
+    return 0;
+}
+
+RC SqlEngine::parseLoadLine(const char* line, const char* end, int& key,
+                            const char*& value, int& length)
+{
+    LoadTokenizer tokenizer(line, end);
+    Record        r;
+    RC            rc;
+
+    // a line without a comma, even an empty one, cannot be parsed
+    if ((rc = tokenizer.next(r)) < 0) { return RC_INVALID_FILE_FORMAT; }
+    key = r.key;
+    value = r.value;
+    length = r.length;
+    return 0;
+}
+
+static KeyRange keyRange(const vector<SelCond>& cond)
+{
+  KeyRange range = { INT_MIN, INT_MAX };
+
+  // intersect the intervals of the EQ, LT, GT, LE and GE conditions
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr != 1) continue;
+    long long v = atoi(cond[i].value);
+    switch (cond[i].comp) {
+    case SelCond::EQ:
+      range.lo = max(range.lo, v);
+      range.hi = min(range.hi, v);
+      break;
+    case SelCond::GT:
+      range.lo = max(range.lo, v + 1);
+      break;
+    case SelCond::GE:
+      range.lo = max(range.lo, v);
+      break;
+    case SelCond::LT:
+      range.hi = min(range.hi, v - 1);
+      break;
+    case SelCond::LE:
+      range.hi = min(range.hi, v);
+      break;
+    default:
+      break;
+    }
+  }
+
+  // NE excludes an interval of a single key
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr == 1 && cond[i].comp == SelCond::NE &&
+        range.lo == range.hi && range.lo == atoi(cond[i].value)) {
+      range.lo = range.hi + 1;
+    }
+  }
+
+  return range;
+}
+
+static int processBatch(int attr, const BatchFilter& filter, RowBatch& batch, QueryOutput& out)
+{
+  batch.selectAll();
+  filter.apply(batch);
+  return emitBatch(attr, batch, out);
+}
+
+static int emitBatch(int attr, RowBatch& batch, QueryOutput& out)
+{
+  // project and write the selected tuples in the window
+  int n = batch.sel.size();
+  if (out.aggregator != NULL) {
+    for (int i = 0; i < n; i++) {
+      if (out.aggregator->add(batch.keys[batch.sel[i]], batch.values[batch.sel[i]]) < 0) {
+        fprintf(stderr, "Error: while writing a group partition\n");
+        break;
       }
-      if(rf.append(key,value,rid)){
-        fprintf(stderr, "Error: failed to append, key: %d value: %s\n",key,value.c_str()); 
-        return -1;
+    }
+  } else if (out.join != NULL) {
+    if (joinBatch(batch, out) < 0) {
+      fprintf(stderr, "Error: while joining the tuples\n");
+    }
+  } else if (out.sorter != NULL) {
+    for (int i = 0; i < n; i++) {
+      if (out.sorter->add(batch.keys[batch.sel[i]], batch.values[batch.sel[i]]) < 0) {
+        fprintf(stderr, "Error: while writing a sort run\n");
+        break;
       }
-      if(index){
-        if( (rc = btIdx.insert(key,rid))<0 )
-            //cout<<"insert error!!  key is : "<<key<<endl;
-            return rc;
+    }
+  } else if (attr != 4) {
+    for (int i = 0; i < n && out.window.left != 0; i++) {
+      if (out.window.take()) {
+        out.sink->writeTuple(attr, batch.keys[batch.sel[i]], batch.values[batch.sel[i]]);
+      }
+    }
+  }
+  out.window.batches++;
+
+  batch.clear();
+  return n;
+}
+
+static RC drainScan(int attr, ParallelScan& scan, RowBatch& batch, QueryOutput& out,
+                    int& count)
+{
+  RC  rc;
+  int n;
+
+  while ((rc = scan.next(batch, n)) == 0) {
+    if (attr == 4) count += n;
+    else count += emitBatch(attr, batch, out);
+  }
+  return (rc == RC_END_OF_TREE) ? 0 : rc;
+}
+
+static RC buildValueIndex(const string& table, const RecordFile& rf, const RecordId& from)
+{
+  ValueIndex vIdx;
+  RC         rc;
+
+  if ((rc = vIdx.open(table + ".vdx", 'w')) < 0) {
+    fprintf(stderr, "Error: failed to open the value index of table %s\n", table.c_str());
+    return rc;
+  }
+  if ((rc = vIdx.merge(rf, from, table + ".vsort", sortMemory)) < 0) {
+    fprintf(stderr, "Error: failed to build the value index of table %s\n", table.c_str());
+    vIdx.close();
+    return rc;
+  }
+  return vIdx.close();
+}
+
+static RC buildKeyIndex(const string& table, const RecordFile& rf)
+{
+  ExternalSorter sorter(table + ".isort", 1, false, sortMemory);
+  BTreeIndex     btIdx;
+  vector<int>    keys;
+  vector<string> values;
+  RecordId       rid;
+  PageId         endPid = rf.endPid();
+  RC             rc;
+
+  // the (key, RecordId) pairs are read a page at a time and sorted on key
+  int reported = 0;
+  for (rid.pid = 0; rid.pid < endPid; rid.pid++) {
+    if ((rc = rf.readPage(rid.pid, keys, values)) < 0) {
+      fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+      return rc;
+    }
+    for (rid.sid = 0; rid.sid < (int) keys.size(); rid.sid++) {
+      string value((const char*) &rid, sizeof(RecordId));
+      if ((rc = sorter.add(keys[rid.sid], value)) < 0) {
+        fprintf(stderr, "Error: failed to sort the keys of table %s\n", table.c_str());
+        return rc;
       }
+    }
+
+    // the progress is reported every tenth of the table
+    int done = (long long) (rid.pid + 1) * 10 / endPid;
+    if (done > reported) {
+      reported = done;
+      fprintf(stderr, "  -- scanned %d%% of table %s (%d of %d pages)\n",
+              done * 10, table.c_str(), rid.pid + 1, endPid);
+    }
+  }
+  if ((rc = sorter.finish()) < 0) {
+    fprintf(stderr, "Error: failed to sort the keys of table %s\n", table.c_str());
+    return rc;
+  }
+
+  // the index is built in bulk under another name and then renamed, so
+  // that queries running meanwhile see either no index or all of it
+  string name = table + ".idx";
+  string building = table + ".idx.new";
+  remove(building.c_str());
+  if ((rc = btIdx.open(building, 'w')) < 0) {
+    fprintf(stderr, "Error: failed to open the index of table %s\n", table.c_str());
+    return rc;
   }
-  infile.close();
-  if (index)
+  if ((rc = btIdx.merge(sorter)) < 0) {
+    fprintf(stderr, "Error: failed to build the index of table %s\n", table.c_str());
     btIdx.close();
+    remove(building.c_str());
+    return rc;
+  }
+  if ((rc = btIdx.close()) < 0 || rename(building.c_str(), name.c_str()) < 0) {
+    fprintf(stderr, "Error: failed to write the index of table %s\n", table.c_str());
+    remove(building.c_str());
+    return (rc < 0) ? rc : RC_FILE_WRITE_FAILED;
+  }
+  fprintf(stderr, "  -- built the index of table %s (%d sorted runs)\n",
+          table.c_str(), sorter.getRunCount());
   return 0;
 }
 
-RC SqlEngine::parseLoadLine(const string& line, int& key, string& value)
+static double indexScanCost(const TableStats& stats, double rows, bool indexOnly)
+{
+  // the nodes of a B+tree built by inserts are about ln 2 full
+  double perLeaf = BTLeafNode::MAX_LEAF_COUNT * 0.69;
+  double fanout = BTNonLeafNode::MAX_NONLEAF_COUNT * 0.69;
+  double leaves = max(1.0, stats.getRowCount() / perLeaf);
+  double height = 1 + ceil(log(leaves) / log(fanout));
+
+  // the root-to-leaf path, and the leaves holding the rows
+  double cost = height + rows / perLeaf;
+
+  // the tuples are fetched in RecordId order, so a table page is read
+  // at most once. the expected # pages holding the rows (Cardenas).
+  double pages = stats.getPageCount();
+  if (!indexOnly && pages > 0) {
+    cost += pages * (1 - pow(1 - 1/pages, rows));
+  }
+
+  return cost;
+}
+
+static RC writeSorted(int attr, ExternalSorter& sorter, const SelOptions& options,
+                      ResultSink& sink)
+{
+  RC           rc;
+  int          key;
+  string       value;
+  OutputWindow window = { options.offset, options.limit, 0 };
+
+  if ((rc = sorter.finish()) < 0) {
+    fprintf(stderr, "Error: while sorting the result\n");
+    return rc;
+  }
+
+  // the merge stops as soon as the LIMIT is reached
+  while (!window.done(attr) && (rc = sorter.next(key, value)) == 0) {
+    if (window.take()) sink.writeTuple(attr, key, value);
+  }
+  if (rc < 0 && rc != RC_END_OF_TREE) {
+    fprintf(stderr, "Error: while reading a sort run\n");
+    return rc;
+  }
+
+  return 0;
+}
+
+static void writeGroup(const vector<SelItem>& items, const HashAggregator::Group& g,
+                       ResultSink& sink)
+{
+  for (unsigned i = 0; i < items.size(); i++) {
+    switch (items[i].func) {
+    case SelItem::NONE:
+      if (items[i].attr == 1) sink.writeColumn(g.key);
+      else sink.writeColumn(g.value);
+      break;
+    case SelItem::COUNT:
+      sink.writeColumn(g.count);
+      break;
+    case SelItem::MIN:
+      if (g.count == 0) sink.writeNull(sizeof(int));
+      else sink.writeColumn(g.min);
+      break;
+    case SelItem::MAX:
+      if (g.count == 0) sink.writeNull(sizeof(int));
+      else sink.writeColumn(g.max);
+      break;
+    case SelItem::SUM:
+      if (g.count == 0) sink.writeNull(sizeof(long long));
+      else sink.writeColumn(g.sum);
+      break;
+    case SelItem::AVG:
+      if (g.count == 0) sink.writeNull(sizeof(double));
+      else sink.writeColumn((double) g.sum / g.count);
+      break;
+    }
+  }
+  sink.endRow();
+}
+
+static RC joinBatch(const RowBatch& batch, QueryOutput& out)
 {
-    const char *s;
-    char        c;
-    string::size_type loc;
-    
-    // ignore beginning white spaces
-    c = *(s = line.c_str());
-    while (c == ' ' || c == '\t') { c = *++s; }
-
-    // get the integer key value
-    key = atoi(s);
-
-    // look for comma
-    s = strchr(s, ',');
-    if (s == NULL) { return RC_INVALID_FILE_FORMAT; }
-
-    // ignore white spaces
-    do { c = *++s; } while (c == ' ' || c == '\t');
-    
-    // if there is nothing left, set the value to empty string
-    if (c == 0) { 
-        value.erase();
-        return 0;
-    }
-
-    // is the value field delimited by ' or "?
-    if (c == '\'' || c == '"') {
-        s++;
-    } else {
-        c = '\n';
-    }
-
-    // get the value string
-    value.assign(s);
-    loc = value.find(c, 0);
-    if (loc != string::npos) { value.erase(loc); }
+  JoinState&  js = *out.join;
+  RC          rc;
+  int         n = batch.sel.size();
 
+  // a hash join builds its table, or probes it with every tuple
+  if (js.hash != NULL) {
+    vector<const string*> matches;
+    for (int i = 0; i < n && out.window.left != 0; i++) {
+      int s = batch.sel[i];
+      if (js.building) {
+        if ((rc = js.hash->build(batch.keys[s], batch.values[s])) < 0) return rc;
+        continue;
+      }
+      matches.clear();
+      if ((rc = js.hash->probe(batch.keys[s], batch.values[s], matches)) < 0) return rc;
+      for (unsigned m = 0; m < matches.size(); m++) {
+        writeJoined(out, batch.keys[s], batch.values[s], *matches[m]);
+      }
+    }
+    return 0;
+  }
+
+  // a nested-loop join looks up the keys of the batch in the index of the
+  // inner table, and reads the inner tuples of the whole batch at once
+  IndexCursor      cursor;
+  RecordId         rid;
+  int              key;
+  vector<RecordId> rids;
+  vector<int>      outer;  // the outer tuple of every inner tuple
+  RowBatch         in;
+  for (int i = 0; i < n; i++) {
+    int s = batch.sel[i];
+    js.index->locate(batch.keys[s], cursor);
+    while ((rc = js.index->readForward(cursor, key, rid)) >= 0) {
+      if (rc != 0) continue;  // rc is 1 at the end of a node
+      if (key != batch.keys[s]) break;
+      in.keys.push_back(key);
+      rids.push_back(rid);
+      outer.push_back(s);
+    }
+    if (rc < 0 && rc != RC_END_OF_TREE) return rc;
+  }
+  in.values.resize(rids.size());
+  if (js.innerValues && (rc = js.inner->readRecords(rids, in.keys, in.values)) < 0) {
+    return rc;
+  }
+
+  in.selectAll();
+  js.innerFilter->apply(in);
+  for (unsigned i = 0; i < in.sel.size() && out.window.left != 0; i++) {
+    int s = in.sel[i];
+    writeJoined(out, in.keys[s], batch.values[outer[s]], in.values[s]);
+  }
+  return 0;
+}
+
+// the entries of a key found in both tables by a merge join. the entries
+// of table t are [begin[t], end[t]) of the entries collected from t.
+struct MergeGroup {
+  int key;
+  int begin[2];
+  int end[2];
+};
+
+// read the next index entry in the key range. RC_END_OF_TREE past the range
+static RC readInRange(BTreeIndex& idx, IndexCursor& cursor, long long hi,
+                      int& key, RecordId& rid)
+{
+  RC rc;
+
+  while ((rc = idx.readForward(cursor, key, rid)) == 1);  // rc is 1 at the end of a node
+  if (rc == 0 && key > hi) return RC_END_OF_TREE;
+  return rc;
+}
+
+// join the entries of the groups collected by a merge join. the tuples of
+// the entries are read if their values are needed, and checked against the
+// conditions of their table. the entries and the groups are cleared.
+static RC joinGroups(const RecordFile rf[2], vector<RecordId> rids[2],
+                     vector<MergeGroup>& groups, const bool values[2],
+                     const BatchFilter* filter[2], QueryOutput& out)
+{
+  RowBatch     batch[2];
+  vector<bool> pass[2];
+  RC           rc;
+
+  for (int t = 0; t < 2; t++) {
+    for (unsigned g = 0; g < groups.size(); g++) {
+      batch[t].keys.resize(groups[g].end[t], groups[g].key);
+    }
+    batch[t].values.resize(rids[t].size());
+    if (values[t] && (rc = rf[t].readRecords(rids[t], batch[t].keys, batch[t].values)) < 0) {
+      return rc;
+    }
+    batch[t].selectAll();
+    filter[t]->apply(batch[t]);
+    pass[t].assign(rids[t].size(), false);
+    for (unsigned i = 0; i < batch[t].sel.size(); i++) pass[t][batch[t].sel[i]] = true;
+    rids[t].clear();
+  }
+
+  for (unsigned g = 0; g < groups.size() && out.window.left != 0; g++) {
+    for (int i = groups[g].begin[0]; i < groups[g].end[0]; i++) {
+      if (!pass[0][i]) continue;
+      for (int j = groups[g].begin[1]; j < groups[g].end[1] && out.window.left != 0; j++) {
+        if (pass[1][j]) writeJoined(out, groups[g].key, batch[0].values[i], batch[1].values[j]);
+      }
+    }
+  }
+  groups.clear();
+  return 0;
+}
+
+static RC mergeJoin(const string table[2], const vector<SelCond> cond[2],
+                    const bool values[2], QueryOutput& out)
+{
+  BTreeIndex         idx[2];
+  RecordFile         rf[2];
+  IndexCursor        cursor[2];
+  int                key[2];
+  RecordId           rid[2];
+  RC                 rc[2];
+  vector<RecordId>   rids[2];
+  vector<MergeGroup> groups;
+  BatchFilter        filter0(cond[0]), filter1(cond[1]);
+  const BatchFilter* filter[2] = { &filter0, &filter1 };
+  RC                 error = 0;
+
+  // the key range of the conditions is the same for both tables
+  KeyRange range = keyRange(cond[0]);
+  if (range.lo > range.hi) return 0;
+
+  for (int t = 0; t < 2; t++) {
+    if ((error = idx[t].open(table[t] + ".idx", 'r')) < 0 ||
+        (error = rf[t].open(table[t] + ".tbl", 'r')) < 0) {
+      fprintf(stderr, "Error: table %s does not exist\n", table[t].c_str());
+      goto exit_merge;
+    }
+    idx[t].locate((int) range.lo, cursor[t]);
+    rc[t] = readInRange(idx[t], cursor[t], range.hi, key[t], rid[t]);
+  }
+  out.join->outer = 0;
+
+  // walk both leaf chains in key order. the side with the smaller key
+  // moves forward, and the entries of a key found on both sides form a
+  // group. the groups are joined a batch at a time.
+  while (rc[0] == 0 && rc[1] == 0 && out.window.left != 0) {
+    if (key[0] != key[1]) {
+      int t = (key[0] < key[1]) ? 0 : 1;
+      rc[t] = readInRange(idx[t], cursor[t], range.hi, key[t], rid[t]);
+      continue;
+    }
+
+    MergeGroup g;
+    g.key = key[0];
+    for (int t = 0; t < 2; t++) {
+      g.begin[t] = rids[t].size();
+      while (rc[t] == 0 && key[t] == g.key) {
+        rids[t].push_back(rid[t]);
+        rc[t] = readInRange(idx[t], cursor[t], range.hi, key[t], rid[t]);
+      }
+      g.end[t] = rids[t].size();
+    }
+    groups.push_back(g);
+
+    if ((int) (rids[0].size() + rids[1].size()) >= RowBatch::CAPACITY &&
+        (error = joinGroups(rf, rids, groups, values, filter, out)) < 0) {
+      break;
+    }
+  }
+  if (error == 0) error = joinGroups(rf, rids, groups, values, filter, out);
+  for (int t = 0; t < 2; t++) {
+    if (error == 0 && rc[t] < 0 && rc[t] != RC_END_OF_TREE) error = rc[t];
+  }
+  if (error < 0) fprintf(stderr, "Error: while joining the tuples\n");
+
+  exit_merge:
+  for (int t = 0; t < 2; t++) {
+    idx[t].close();
+    rf[t].close();
+  }
+  return error;
+}
+
+static void writeJoined(QueryOutput& out, int key, const string& outerValue,
+                        const string& innerValue)
+{
+  const JoinState&          js = *out.join;
+  const vector<JoinColumn>& columns = *js.columns;
+
+  if (columns.empty()) {
+    out.join->count++;
+    return;
+  }
+  if (!out.window.take()) return;
+  for (unsigned i = 0; i < columns.size(); i++) {
+    if (columns[i].attr == 1) out.sink->writeColumn(key);
+    else out.sink->writeColumn((columns[i].table == js.outer) ? outerValue : innerValue);
+  }
+  out.sink->endRow();
+}
+
+static void estimateTable(const string& table, const vector<SelCond>& cond,
+                          double& rows, double& pages)
+{
+  TableStats stats;
+  KeyRange   range = keyRange(cond);
+  PageFile   pf;
+
+  if (stats.load(table + ".sta") == 0) {
+    rows = stats.estimateRows(range.lo, range.hi);
+    pages = stats.getPageCount();
+    return;
+  }
+
+  // without statistics, every page of the table is taken to be full
+  pages = 0;
+  if (pf.open(table + ".tbl", 'r') == 0 || pf.open(table + ".iot", 'r') == 0) {
+    pages = pf.endPid();
+    pf.close();
+  }
+  rows = pages * RecordFile::RECORDS_PER_PAGE;
+}
+
+// true if a condition NE on key excludes the key
+static bool keyExcluded(const vector<SelCond>& cond, int key)
+{
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr == 1 && cond[i].comp == SelCond::NE && atoi(cond[i].value) == key) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static RC indexMinMax(const string& table, const vector<SelCond>& cond,
+                      HashAggregator::Group& group)
+{
+  BTreeIndex  idx;
+  IndexCursor cursor;
+  RecordId    rid;
+  RC          rc;
+  int         key;
+  KeyRange    range = keyRange(cond);
+
+  if ((rc = idx.open(table + ".idx", 'r')) < 0) return rc;
+  group.count = 0;
+  if (range.lo > range.hi) {
+    idx.close();
     return 0;
+  }
+
+  // the smallest key is the first entry from the low end of the range
+  // not excluded by NE
+  idx.locate((int) range.lo, cursor);
+  while ((rc = idx.readForward(cursor, key, rid)) >= 0) {
+    if (rc != 0) continue;  // rc is 1 at the end of a node
+    if (key > range.hi) break;
+    if (keyExcluded(cond, key)) continue;
+    group.min = key;
+    group.count = 1;
+    break;
+  }
+  if (rc < 0 && rc != RC_END_OF_TREE) {
+    idx.close();
+    return rc;
+  }
+  if (group.count == 0) {
+    idx.close();
+    return 0;
+  }
+
+  // the largest key is found by descending to the high end of the range,
+  // and again below every key excluded by NE
+  long long hi = range.hi;
+  for (;;) {
+    if ((rc = idx.locateLast((int) hi, key, rid)) < 0) break;
+    if (!keyExcluded(cond, key)) {
+      group.max = key;
+      break;
+    }
+    hi = (long long) key - 1;
+  }
+  idx.close();
+  return rc;
+}
+
+static RC selectClustered(int attr, ClusteredFile& cf, const vector<SelCond>& cond,
+                          QueryOutput& out)
+{
+  IndexCursor cursor;
+  RC          rc = 0;
+  int         key;
+  string      value;
+  int         count = 0;
+  KeyRange    range = keyRange(cond);
+  BatchFilter filter(cond);
+  RowBatch    batch;
+
+  // scan the leaves from the first tuple in the range
+  if (range.lo <= range.hi) {
+    cf.locate((int) range.lo, cursor);
+    while ((rc = cf.readForward(cursor, key, value)) == 0) {
+      if (key > range.hi) break;
+
+      batch.keys.push_back(key);
+      batch.values.push_back(value);
+      if (batch.size() >= out.window.batchSize(attr)) {
+        count += processBatch(attr, filter, batch, out);
+        if (out.window.done(attr)) break;
+      }
+    }
+    count += processBatch(attr, filter, batch, out);
+    if (rc < 0 && rc != RC_END_OF_TREE) {
+      fprintf(stderr, "Error: while reading a tuple from the table\n");
+      return rc;
+    }
+  }
+
+  // print matching tuple count if "select count(*)"
+  if (attr == 4 && out.window.skip == 0 && out.window.left != 0) {
+    out.sink->writeCount(count);
+  }
+
+  return 0;
+}
+
+static RC loadClustered(const string& table, const string& loadfile, int options)
+{
+  ClusteredFile cf;
+  RecordFile    rf;
+  RC            rc;
+
+  if (options != SqlEngine::LOAD_CLUSTERED) {
+    fprintf(stderr, "Error: CLUSTERED cannot be combined with other LOAD options\n");
+    return RC_INVALID_FILE_FORMAT;
+  }
+  if (rf.open(table + ".tbl", 'r') == 0) {
+    rf.close();
+    fprintf(stderr, "Error: table %s is not index-organized\n", table.c_str());
+    return RC_INVALID_FILE_FORMAT;
+  }
+
+  ifstream infile(loadfile.c_str());
+  if (!infile.is_open()) {
+    fprintf(stderr, "Error: failed to open file, %s\n", loadfile.c_str());
+    return RC_FILE_OPEN_FAILED;
+  }
+
+  if ((rc = cf.open(table + ".iot", 'w')) < 0) {
+    fprintf(stderr, "Error: failed to open table %s\n", table.c_str());
+    return rc;
+  }
+
+  // only the loaded tuples are read into memory. they are merged into the
+  // leaves they belong to, so a LOAD rewrites the leaves it touches.
+  vector<ClusteredFile::Tuple> tuples;
+  ClusteredFile::Tuple t;
+  string line;
+  while (getline(infile, line)) {
+    if (SqlEngine::parseLoadLine(line, t.first, t.second) != 0) {
+      fprintf(stderr, "Error: failed to parse, %s\n", line.c_str());
+      cf.close();
+      return RC_INVALID_FILE_FORMAT;
+    }
+    // store the value the way a RecordFile slot does: it ends at its first
+    // zero byte and keeps at most MAX_VALUE_LENGTH-1 characters
+    string::size_type z = t.second.find('\0');
+    if (z != string::npos) t.second.resize(z);
+    if ((int) t.second.size() >= RecordFile::MAX_VALUE_LENGTH) {
+      t.second.resize(RecordFile::MAX_VALUE_LENGTH - 1);
+    }
+    tuples.push_back(t);
+  }
+
+  if ((rc = cf.merge(tuples)) < 0) {
+    fprintf(stderr, "Error: failed to write table %s\n", table.c_str());
+    cf.close();
+    return rc;
+  }
+  return cf.close();
 }
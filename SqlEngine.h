@@ -23,11 +23,62 @@ struct SelCond {
   char* value;  // the value to compare
 };
 
+/**
+ * data structure to represent a condition in the WHERE clause of a join,
+ * on a column qualified by its table. the join condition compares the
+ * column to a second column instead of a value.
+ */
+struct JoinCond {
+  char*   table;    // the table of the column
+  SelCond cond;     // the column, the comparator and the value
+  char*   table2;   // the table of the second column, or NULL
+  int     attr2;    // attribute of the second column
+};
+
+/**
+ * data structure to represent an item in the SELECT clause of an aggregate query or a join
+ */
+struct SelItem {
+  enum Function { NONE, COUNT, MIN, MAX, SUM, AVG } func;  // NONE for a plain column
+  int attr;     // attribute: 1 - key column, 2 - value column, 0 - COUNT(*)
+  char* table;  // the table qualifying a column (table.attr), or NULL
+};
+
+/**
+ * data structure to represent a column of one of the two tables of a join
+ */
+struct JoinColumn {
+  int table;    // 0 - the first table in the FROM clause, 1 - the second
+  int attr;     // attribute: 1 - key column, 2 - value column
+};
+
+/**
+ * data structure to represent the ORDER BY, LIMIT and OFFSET clauses of a SELECT
+ */
+struct SelOptions {
+  int  orderAttr;   // attribute in ORDER BY: 0 - none, 1 - key, 2 - value
+  bool descending;  // true for ORDER BY ... DESC
+  int  limit;       // # tuples to print at most. -1 if there is no LIMIT
+  int  offset;      // # selected tuples to skip before printing
+};
+
 /**
  * the class that takes, parses, and executes the user commands.
  */
 class SqlEngine {
  public:
+
+  /**
+   * options in the WITH clause of a LOAD command. they are ORed together.
+   */
+  enum LoadOption {
+    LOAD_INDEX      = 0x01,  // WITH INDEX: build a B+tree index on key
+    LOAD_DICTIONARY = 0x02,  // WITH DICTIONARY: store dictionary-compressed pages
+    LOAD_COMPRESSION = 0x04, // WITH COMPRESSION: store LZ-compressed extents
+    LOAD_VALUE_INDEX = 0x08, // WITH INDEX ON value: build a B+tree index on value
+    LOAD_HASH_INDEX  = 0x10, // WITH HASH INDEX: build a hash index on key
+    LOAD_CLUSTERED   = 0x20  // WITH CLUSTERED: store the tuples in B+tree leaves
+  };
     
   /**
    * takes the user commands from commandline and executes them.
@@ -46,18 +97,92 @@ class SqlEngine {
    * (1: key, 2: value, 3: *, 4: count(*))
    * @param table[IN] the table name in the FROM clause
    * @param conds[IN] list of conditions in the WHERE clause
+   * @param options[IN] the order, LIMIT and OFFSET of the result
+   * @return error code. 0 if no error
+   */
+  static RC select(int attr, const std::string& table, const std::vector<SelCond>& conds,
+                   const SelOptions& options);
+
+  /**
+   * executes a SELECT statement with aggregate functions, optionally
+   * grouped on a column. every plain column in items must be the
+   * GROUP BY column, and MIN, MAX, SUM and AVG take the key column.
+   * @param items[IN] the items in the SELECT clause
+   * @param table[IN] the table name in the FROM clause
+   * @param conds[IN] list of conditions in the WHERE clause
+   * @param group[IN] the column in the GROUP BY clause (1: key, 2: value),
+   *                  or 0 if there is none
+   * @param options[IN] the LIMIT and OFFSET of the groups
    * @return error code. 0 if no error
    */
-  static RC select(int attr, const std::string& table, const std::vector<SelCond>& conds);
+  static RC aggregate(const std::vector<SelItem>& items, const std::string& table,
+                      const std::vector<SelCond>& conds, int group, const SelOptions& options);
+
+  /**
+   * executes a SELECT statement that joins two tables on their keys
+   * (FROM table1, table2 WHERE table1.key = table2.key).
+   * the join is a grace hash join, or an index nested-loop join that
+   * looks up the key index of one table when the other is estimated to
+   * select few enough tuples.
+   * @param columns[IN] the columns in the SELECT clause, or none for count(*)
+   * @param table1[IN] the first table in the FROM clause
+   * @param table2[IN] the second table in the FROM clause
+   * @param conds1[IN] the conditions on the first table
+   * @param conds2[IN] the conditions on the second table
+   * @param options[IN] the LIMIT and OFFSET of the result
+   * @return error code. 0 if no error
+   */
+  static RC join(const std::vector<JoinColumn>& columns, const std::string& table1,
+                 const std::string& table2, const std::vector<SelCond>& conds1,
+                 const std::vector<SelCond>& conds2, const SelOptions& options);
 
   /**
    * load a table from a load file.
    * @param table[IN] the table name in the LOAD command
    * @param loadfile[IN] the file name of the load file
-   * @param index[IN] true if "WITH INDEX" option was specified
+   * @param options[IN] the LoadOption flags given in the WITH clause
    * @return error code. 0 if no error
    */
-  static RC load(const std::string& table, const std::string& loadfile, bool index);
+  static RC load(const std::string& table, const std::string& loadfile, int options);
+
+  /**
+   * gather the statistics of a table, which SELECT uses to choose
+   * between a full scan and an index scan.
+   * @param table[IN] the table name in the ANALYZE command
+   * @return error code. 0 if no error
+   */
+  static RC analyze(const std::string& table);
+
+  /**
+   * build an index on a column of an existing table.
+   * a key index is built from a scan of the pages of the table, an
+   * external sort of the (key, RecordId) pairs and a bulk build, with the
+   * progress reported on stderr.
+   * @param table[IN] the table name in the CREATE INDEX command
+   * @param attr[IN] the column to index (1: key, 2: value)
+   * @return error code. 0 if no error
+   */
+  static RC createIndex(const std::string& table, int attr);
+
+  /**
+   * set the format in which SELECT prints its result.
+   * @param format[IN] "text" (the default), "csv" or "binary"
+   * @return error code. 0 if no error
+   */
+  static RC setOutputFormat(const std::string& format);
+
+  /**
+   * set a parameter of the engine. the parameters are
+   * sort_memory: # KB of tuples an ORDER BY sorts in memory (default 4096)
+   * group_memory: # KB of groups a GROUP BY keeps in memory (default 4096)
+   * join_memory: # KB of build tuples a hash join keeps in memory (default 4096)
+   * scan_threads: # threads a full table scan runs on (default: # processors)
+   * load_threads: # threads parsing the load file of a LOAD (default: # processors)
+   * @param name[IN] the name of the parameter
+   * @param value[IN] the new value of the parameter
+   * @return error code. 0 if no error
+   */
+  static RC setParameter(const std::string& name, int value);
 
   /**
    * parse a line from the load file into the (key, value) pair.
@@ -67,6 +192,19 @@ class SqlEngine {
    * @return error code. 0 if no error
    */
   static RC parseLoadLine(const std::string& line, int& key, std::string& value);
+
+  /**
+   * parse a line from the load file in memory into the (key, value) pair,
+   * without copying the value.
+   * @param line[IN] the first character of the line
+   * @param end[IN] the end of the line, not including the line break
+   * @param key[OUT] the key field of the tuple in the line
+   * @param value[OUT] the value field of the tuple, pointing into the line
+   * @param length[OUT] the length of the value field
+   * @return error code. 0 if no error
+   */
+  static RC parseLoadLine(const char* line, const char* end, int& key,
+                          const char*& value, int& length);
 };
 
 #endif /* SQLENGINE_H */
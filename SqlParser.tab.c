@@ -1,14 +1,14 @@
-/* A Bison parser, made by GNU Bison 2.3.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
-/* Skeleton implementation for Bison's Yacc-like parsers in C
+/* Bison implementation for Yacc-like parsers in C
 
-   Copyright (C) 1984, 1989, 1990, 2000, 2001, 2002, 2003, 2004, 2005, 2006
-   Free Software Foundation, Inc.
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
 
-   This program is free software; you can redistribute it and/or modify
+   This program is free software: you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
-   the Free Software Foundation; either version 2, or (at your option)
-   any later version.
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
 
    This program is distributed in the hope that it will be useful,
    but WITHOUT ANY WARRANTY; without even the implied warranty of
@@ -16,9 +16,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program; if not, write to the Free Software
-   Foundation, Inc., 51 Franklin Street, Fifth Floor,
-   Boston, MA 02110-1301, USA.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -36,6 +34,10 @@
 /* C LALR(1) parser skeleton written by Richard Stallman, by
    simplifying the original so-called "semantic" parser.  */
 
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
 /* All symbols defined below should begin with yy or YY, to avoid
    infringing on user name space.  This should be done even for local
    variables, as they might otherwise be expanded by user macros.
@@ -43,11 +45,11 @@
    define necessary library symbols; they are noted "INFRINGES ON
    USER NAME SPACE" below.  */
 
-/* Identify Bison output.  */
-#define YYBISON 1
+/* Identify Bison output, and Bison version.  */
+#define YYBISON 30802
 
-/* Bison version.  */
-#define YYBISON_VERSION "2.3"
+/* Bison version string.  */
+#define YYBISON_VERSION "3.8.2"
 
 /* Skeleton name.  */
 #define YYSKELETON_NAME "yacc.c"
@@ -55,77 +57,23 @@
 /* Pure parsers.  */
 #define YYPURE 0
 
-/* Using locations.  */
-#define YYLSP_NEEDED 0
+/* Push parsers.  */
+#define YYPUSH 0
+
+/* Pull parsers.  */
+#define YYPULL 1
+
 
 /* Substitute the variable and function names.  */
-#define yyparse sqlparse
-#define yylex   sqllex
-#define yyerror sqlerror
-#define yylval  sqllval
-#define yychar  sqlchar
-#define yydebug sqldebug
-#define yynerrs sqlnerrs
-
-
-/* Tokens.  */
-#ifndef YYTOKENTYPE
-# define YYTOKENTYPE
-   /* Put the tokens into the symbol table, so that GDB and other debuggers
-      know about them.  */
-   enum yytokentype {
-     SELECT = 258,
-     FROM = 259,
-     WHERE = 260,
-     LOAD = 261,
-     WITH = 262,
-     INDEX = 263,
-     QUIT = 264,
-     COUNT = 265,
-     AND = 266,
-     OR = 267,
-     COMMA = 268,
-     STAR = 269,
-     LF = 270,
-     INTEGER = 271,
-     STRING = 272,
-     ID = 273,
-     EQUAL = 274,
-     NEQUAL = 275,
-     LESS = 276,
-     LESSEQUAL = 277,
-     GREATER = 278,
-     GREATEREQUAL = 279
-   };
-#endif
-/* Tokens.  */
-#define SELECT 258
-#define FROM 259
-#define WHERE 260
-#define LOAD 261
-#define WITH 262
-#define INDEX 263
-#define QUIT 264
-#define COUNT 265
-#define AND 266
-#define OR 267
-#define COMMA 268
-#define STAR 269
-#define LF 270
-#define INTEGER 271
-#define STRING 272
-#define ID 273
-#define EQUAL 274
-#define NEQUAL 275
-#define LESS 276
-#define LESSEQUAL 277
-#define GREATER 278
-#define GREATEREQUAL 279
-
-
-
-
-/* Copy the first part of user declarations.  */
+#define yyparse         sqlparse
+#define yylex           sqllex
+#define yyerror         sqlerror
+#define yydebug         sqldebug
+#define yynerrs         sqlnerrs
+#define yylval          sqllval
+#define yychar          sqlchar
+
+/* First part of user prologue.  */
 #line 1 "SqlParser.y"
 
 #include <cstdio>
@@ -142,95 +90,354 @@ int  sqllex(void);
 void sqlerror(const char *str) { fprintf(stderr, "Error: %s\n", str); }
 extern "C" { int  sqlwrap() { return 1; } }
 
-static void runSelect(int attr, const char* table, const std::vector<SelCond>& conds)
-{
-  struct tms tmsbuf;
-  clock_t btime, etime;
-  int     bpagecnt, epagecnt;
+static struct tms tmsbuf;
+static clock_t    btime;
+static int        bpagecnt;
 
+static void startTimer()
+{
   btime = times(&tmsbuf);
   bpagecnt = PageFile::getPageReadCount();
-  SqlEngine::select(attr, table, conds);
-  etime = times(&tmsbuf);
-  epagecnt = PageFile::getPageReadCount();
+}
+
+static void reportTimer()
+{
+  clock_t etime = times(&tmsbuf);
+  int     epagecnt = PageFile::getPageReadCount();
 
   fprintf(stderr, "  -- %.3f seconds to run the select command. Read %d pages\n", ((float)(etime - btime))/sysconf(_SC_CLK_TCK), epagecnt - bpagecnt);
 }
 
+static void runSelect(const std::vector<SelItem>& items, const char* table,
+                      const std::vector<SelCond>& conds, int group, const SelOptions& options)
+{
+  for (unsigned i = 0; i < items.size(); i++) {
+    if (items[i].table != NULL && strcmp(items[i].table, table) != 0) {
+      fprintf(stderr, "Error: table %s is not in the FROM clause\n", items[i].table);
+      return;
+    }
+  }
+
+  // columns without an aggregate or GROUP BY are a plain SELECT, which
+  // returns a single column, or key and value as *
+  bool aggregates = (group != 0);
+  for (unsigned i = 0; i < items.size(); i++) {
+    if (items[i].func != SelItem::NONE) aggregates = true;
+  }
+  int attr = items[0].attr;
+  if (!aggregates && items.size() == 2 && items[0].attr == 1 && items[1].attr == 2) {
+    attr = 3;
+  } else if (!aggregates && items.size() > 1) {
+    sqlerror("the columns of a SELECT without aggregates must be a single column, *, or key, value");
+    return;
+  }
+
+  startTimer();
+  // count(*) without GROUP BY is a plain SELECT as well
+  if (!aggregates) {
+    SqlEngine::select(attr, table, conds, options);
+  } else if (group == 0 && items.size() == 1 && items[0].func == SelItem::COUNT) {
+    SqlEngine::select(4, table, conds, options);
+  } else {
+    SqlEngine::aggregate(items, table, conds, group, options);
+  }
+  reportTimer();
+}
 
+// the position of a table in the FROM clause of a join, or -1
+static int tableIndex(const char* name, const char* table1, const char* table2)
+{
+  if (name != NULL && strcmp(name, table1) == 0) return 0;
+  if (name != NULL && strcmp(name, table2) == 0) return 1;
+  return -1;
+}
 
-/* Enabling traces.  */
-#ifndef YYDEBUG
-# define YYDEBUG 0
-#endif
+static void runJoin(const std::vector<SelItem>& items, const char* table1, const char* table2,
+                    const std::vector<JoinCond>& where, const SelOptions& options)
+{
+  std::vector<JoinColumn> columns;
+  std::vector<SelCond>    conds[2];
+  bool                    joined = false;
 
-/* Enabling verbose error messages.  */
-#ifdef YYERROR_VERBOSE
-# undef YYERROR_VERBOSE
-# define YYERROR_VERBOSE 1
-#else
-# define YYERROR_VERBOSE 0
-#endif
+  if (strcmp(table1, table2) == 0) {
+    sqlerror("a table cannot be joined with itself");
+    return;
+  }
+
+  // resolve the columns to the tables. the unqualified key is the key
+  // of both tables, and * is all columns of both.
+  for (unsigned i = 0; i < items.size(); i++) {
+    if (items[i].func == SelItem::COUNT && items.size() == 1) break;
+    if (items[i].func != SelItem::NONE) {
+      sqlerror("only columns and count(*) are supported in a join");
+      return;
+    }
+    if (items[i].attr == 3) {
+      for (int t = 0; t < 2; t++) {
+        JoinColumn key = { t, 1 }, value = { t, 2 };
+        columns.push_back(key);
+        columns.push_back(value);
+      }
+      continue;
+    }
+    JoinColumn c = { tableIndex(items[i].table, table1, table2), items[i].attr };
+    if (items[i].table == NULL && items[i].attr == 1) c.table = 0;
+    if (c.table < 0) {
+      sqlerror("a value in a join must be qualified by a table in the FROM clause");
+      return;
+    }
+    columns.push_back(c);
+  }
+
+  // the join condition pairs the keys. the others select from one table.
+  for (unsigned i = 0; i < where.size(); i++) {
+    int t = tableIndex(where[i].table, table1, table2);
+    if (where[i].table2 != NULL) {
+      int t2 = tableIndex(where[i].table2, table1, table2);
+      if (t < 0 || t2 < 0 || t == t2 || where[i].cond.attr != 1 || where[i].attr2 != 1) {
+        sqlerror("only the join condition table1.key = table2.key is supported");
+        return;
+      }
+      joined = true;
+      continue;
+    }
+    if (t < 0) {
+      fprintf(stderr, "Error: table %s is not in the FROM clause\n", where[i].table);
+      return;
+    }
+    conds[t].push_back(where[i].cond);
+  }
+  if (!joined) {
+    sqlerror("a join needs the condition table1.key = table2.key");
+    return;
+  }
 
-/* Enabling the token table.  */
-#ifndef YYTOKEN_TABLE
-# define YYTOKEN_TABLE 0
-#endif
+  startTimer();
+  SqlEngine::join(columns, table1, table2, conds[0], conds[1], options);
+  reportTimer();
+}
 
-#if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
-typedef union YYSTYPE
-#line 33 "SqlParser.y"
+static void freeSelItems(std::vector<SelItem>* items)
 {
-  int integer;
-  char* string;
-  SelCond* cond;
-  std::vector<SelCond>* conds;
+  for (unsigned i = 0; i < items->size(); i++) {
+    free((*items)[i].table);
+  }
+  delete items;
 }
-/* Line 193 of yacc.c.  */
-#line 191 "SqlParser.tab.c"
-	YYSTYPE;
-# define yystype YYSTYPE /* obsolescent; will be withdrawn */
-# define YYSTYPE_IS_DECLARED 1
-# define YYSTYPE_IS_TRIVIAL 1
-#endif
 
+static SelItem* newSelItem(SelItem::Function func, int attr)
+{
+  SelItem* item = new SelItem;
+  item->func = func;
+  item->attr = attr;
+  item->table = NULL;
+  return item;
+}
+
+static SelOptions* newSelOptions(int limit, int offset)
+{
+  SelOptions* o = new SelOptions;
+  o->orderAttr = 0;
+  o->descending = false;
+  o->limit = limit;
+  o->offset = offset;
+  return o;
+}
+
+
+#line 249 "SqlParser.tab.c"
+
+# ifndef YY_CAST
+#  ifdef __cplusplus
+#   define YY_CAST(Type, Val) static_cast<Type> (Val)
+#   define YY_REINTERPRET_CAST(Type, Val) reinterpret_cast<Type> (Val)
+#  else
+#   define YY_CAST(Type, Val) ((Type) (Val))
+#   define YY_REINTERPRET_CAST(Type, Val) ((Type) (Val))
+#  endif
+# endif
+# ifndef YY_NULLPTR
+#  if defined __cplusplus
+#   if 201103L <= __cplusplus
+#    define YY_NULLPTR nullptr
+#   else
+#    define YY_NULLPTR 0
+#   endif
+#  else
+#   define YY_NULLPTR ((void*)0)
+#  endif
+# endif
 
+#include "SqlParser.tab.h"
+/* Symbol kind.  */
+enum yysymbol_kind_t
+{
+  YYSYMBOL_YYEMPTY = -2,
+  YYSYMBOL_YYEOF = 0,                      /* "end of file"  */
+  YYSYMBOL_YYerror = 1,                    /* error  */
+  YYSYMBOL_YYUNDEF = 2,                    /* "invalid token"  */
+  YYSYMBOL_SELECT = 3,                     /* SELECT  */
+  YYSYMBOL_FROM = 4,                       /* FROM  */
+  YYSYMBOL_WHERE = 5,                      /* WHERE  */
+  YYSYMBOL_LOAD = 6,                       /* LOAD  */
+  YYSYMBOL_WITH = 7,                       /* WITH  */
+  YYSYMBOL_INDEX = 8,                      /* INDEX  */
+  YYSYMBOL_QUIT = 9,                       /* QUIT  */
+  YYSYMBOL_COUNT = 10,                     /* COUNT  */
+  YYSYMBOL_AND = 11,                       /* AND  */
+  YYSYMBOL_OR = 12,                        /* OR  */
+  YYSYMBOL_DICTIONARY = 13,                /* DICTIONARY  */
+  YYSYMBOL_COMPRESSION = 14,               /* COMPRESSION  */
+  YYSYMBOL_CREATE = 15,                    /* CREATE  */
+  YYSYMBOL_ON = 16,                        /* ON  */
+  YYSYMBOL_HASH = 17,                      /* HASH  */
+  YYSYMBOL_CLUSTERED = 18,                 /* CLUSTERED  */
+  YYSYMBOL_ANALYZE = 19,                   /* ANALYZE  */
+  YYSYMBOL_SET = 20,                       /* SET  */
+  YYSYMBOL_OUTPUT = 21,                    /* OUTPUT  */
+  YYSYMBOL_LIMIT = 22,                     /* LIMIT  */
+  YYSYMBOL_OFFSET = 23,                    /* OFFSET  */
+  YYSYMBOL_ORDER = 24,                     /* ORDER  */
+  YYSYMBOL_BY = 25,                        /* BY  */
+  YYSYMBOL_ASC = 26,                       /* ASC  */
+  YYSYMBOL_DESC = 27,                      /* DESC  */
+  YYSYMBOL_GROUP = 28,                     /* GROUP  */
+  YYSYMBOL_MIN = 29,                       /* MIN  */
+  YYSYMBOL_MAX = 30,                       /* MAX  */
+  YYSYMBOL_SUM = 31,                       /* SUM  */
+  YYSYMBOL_AVG = 32,                       /* AVG  */
+  YYSYMBOL_COMMA = 33,                     /* COMMA  */
+  YYSYMBOL_DOT = 34,                       /* DOT  */
+  YYSYMBOL_STAR = 35,                      /* STAR  */
+  YYSYMBOL_LPAREN = 36,                    /* LPAREN  */
+  YYSYMBOL_RPAREN = 37,                    /* RPAREN  */
+  YYSYMBOL_LF = 38,                        /* LF  */
+  YYSYMBOL_INTEGER = 39,                   /* INTEGER  */
+  YYSYMBOL_STRING = 40,                    /* STRING  */
+  YYSYMBOL_ID = 41,                        /* ID  */
+  YYSYMBOL_EQUAL = 42,                     /* EQUAL  */
+  YYSYMBOL_NEQUAL = 43,                    /* NEQUAL  */
+  YYSYMBOL_LESS = 44,                      /* LESS  */
+  YYSYMBOL_LESSEQUAL = 45,                 /* LESSEQUAL  */
+  YYSYMBOL_GREATER = 46,                   /* GREATER  */
+  YYSYMBOL_GREATEREQUAL = 47,              /* GREATEREQUAL  */
+  YYSYMBOL_YYACCEPT = 48,                  /* $accept  */
+  YYSYMBOL_commands = 49,                  /* commands  */
+  YYSYMBOL_command = 50,                   /* command  */
+  YYSYMBOL_quit_command = 51,              /* quit_command  */
+  YYSYMBOL_load_command = 52,              /* load_command  */
+  YYSYMBOL_load_options = 53,              /* load_options  */
+  YYSYMBOL_load_option = 54,               /* load_option  */
+  YYSYMBOL_create_command = 55,            /* create_command  */
+  YYSYMBOL_analyze_command = 56,           /* analyze_command  */
+  YYSYMBOL_set_command = 57,               /* set_command  */
+  YYSYMBOL_select_command = 58,            /* select_command  */
+  YYSYMBOL_join_conditions = 59,           /* join_conditions  */
+  YYSYMBOL_join_condition = 60,            /* join_condition  */
+  YYSYMBOL_group_clause = 61,              /* group_clause  */
+  YYSYMBOL_select_options = 62,            /* select_options  */
+  YYSYMBOL_direction = 63,                 /* direction  */
+  YYSYMBOL_limit_options = 64,             /* limit_options  */
+  YYSYMBOL_row_count = 65,                 /* row_count  */
+  YYSYMBOL_conditions = 66,                /* conditions  */
+  YYSYMBOL_condition = 67,                 /* condition  */
+  YYSYMBOL_select_list = 68,               /* select_list  */
+  YYSYMBOL_select_item = 69,               /* select_item  */
+  YYSYMBOL_attribute = 70,                 /* attribute  */
+  YYSYMBOL_value = 71,                     /* value  */
+  YYSYMBOL_table = 72,                     /* table  */
+  YYSYMBOL_comparator = 73                 /* comparator  */
+};
+typedef enum yysymbol_kind_t yysymbol_kind_t;
 
-/* Copy the second part of user declarations.  */
 
 
-/* Line 216 of yacc.c.  */
-#line 204 "SqlParser.tab.c"
 
 #ifdef short
 # undef short
 #endif
 
-#ifdef YYTYPE_UINT8
-typedef YYTYPE_UINT8 yytype_uint8;
-#else
-typedef unsigned char yytype_uint8;
+/* On compilers that do not define __PTRDIFF_MAX__ etc., make sure
+   <limits.h> and (if available) <stdint.h> are included
+   so that the code can choose integer types of a good width.  */
+
+#ifndef __PTRDIFF_MAX__
+# include <limits.h> /* INFRINGES ON USER NAME SPACE */
+# if defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
+#  include <stdint.h> /* INFRINGES ON USER NAME SPACE */
+#  define YY_STDINT_H
+# endif
 #endif
 
-#ifdef YYTYPE_INT8
-typedef YYTYPE_INT8 yytype_int8;
-#elif (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+/* Narrow types that promote to a signed type and that can represent a
+   signed or unsigned integer of at least N bits.  In tables they can
+   save space and decrease cache pressure.  Promoting to a signed type
+   helps avoid bugs in integer arithmetic.  */
+
+#ifdef __INT_LEAST8_MAX__
+typedef __INT_LEAST8_TYPE__ yytype_int8;
+#elif defined YY_STDINT_H
+typedef int_least8_t yytype_int8;
+#else
 typedef signed char yytype_int8;
+#endif
+
+#ifdef __INT_LEAST16_MAX__
+typedef __INT_LEAST16_TYPE__ yytype_int16;
+#elif defined YY_STDINT_H
+typedef int_least16_t yytype_int16;
 #else
-typedef short int yytype_int8;
+typedef short yytype_int16;
+#endif
+
+/* Work around bug in HP-UX 11.23, which defines these macros
+   incorrectly for preprocessor constants.  This workaround can likely
+   be removed in 2023, as HPE has promised support for HP-UX 11.23
+   (aka HP-UX 11i v2) only through the end of 2022; see Table 2 of
+   <https://h20195.www2.hpe.com/V2/getpdf.aspx/4AA4-7673ENW.pdf>.  */
+#ifdef __hpux
+# undef UINT_LEAST8_MAX
+# undef UINT_LEAST16_MAX
+# define UINT_LEAST8_MAX 255
+# define UINT_LEAST16_MAX 65535
 #endif
 
-#ifdef YYTYPE_UINT16
-typedef YYTYPE_UINT16 yytype_uint16;
+#if defined __UINT_LEAST8_MAX__ && __UINT_LEAST8_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST8_TYPE__ yytype_uint8;
+#elif (!defined __UINT_LEAST8_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST8_MAX <= INT_MAX)
+typedef uint_least8_t yytype_uint8;
+#elif !defined __UINT_LEAST8_MAX__ && UCHAR_MAX <= INT_MAX
+typedef unsigned char yytype_uint8;
 #else
-typedef unsigned short int yytype_uint16;
+typedef short yytype_uint8;
 #endif
 
-#ifdef YYTYPE_INT16
-typedef YYTYPE_INT16 yytype_int16;
+#if defined __UINT_LEAST16_MAX__ && __UINT_LEAST16_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST16_TYPE__ yytype_uint16;
+#elif (!defined __UINT_LEAST16_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST16_MAX <= INT_MAX)
+typedef uint_least16_t yytype_uint16;
+#elif !defined __UINT_LEAST16_MAX__ && USHRT_MAX <= INT_MAX
+typedef unsigned short yytype_uint16;
 #else
-typedef short int yytype_int16;
+typedef int yytype_uint16;
+#endif
+
+#ifndef YYPTRDIFF_T
+# if defined __PTRDIFF_TYPE__ && defined __PTRDIFF_MAX__
+#  define YYPTRDIFF_T __PTRDIFF_TYPE__
+#  define YYPTRDIFF_MAXIMUM __PTRDIFF_MAX__
+# elif defined PTRDIFF_MAX
+#  ifndef ptrdiff_t
+#   include <stddef.h> /* INFRINGES ON USER NAME SPACE */
+#  endif
+#  define YYPTRDIFF_T ptrdiff_t
+#  define YYPTRDIFF_MAXIMUM PTRDIFF_MAX
+# else
+#  define YYPTRDIFF_T long
+#  define YYPTRDIFF_MAXIMUM LONG_MAX
+# endif
 #endif
 
 #ifndef YYSIZE_T
@@ -238,55 +445,106 @@ typedef short int yytype_int16;
 #  define YYSIZE_T __SIZE_TYPE__
 # elif defined size_t
 #  define YYSIZE_T size_t
-# elif ! defined YYSIZE_T && (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+# elif defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
 #  include <stddef.h> /* INFRINGES ON USER NAME SPACE */
 #  define YYSIZE_T size_t
 # else
-#  define YYSIZE_T unsigned int
+#  define YYSIZE_T unsigned
 # endif
 #endif
 
-#define YYSIZE_MAXIMUM ((YYSIZE_T) -1)
+#define YYSIZE_MAXIMUM                                  \
+  YY_CAST (YYPTRDIFF_T,                                 \
+           (YYPTRDIFF_MAXIMUM < YY_CAST (YYSIZE_T, -1)  \
+            ? YYPTRDIFF_MAXIMUM                         \
+            : YY_CAST (YYSIZE_T, -1)))
+
+#define YYSIZEOF(X) YY_CAST (YYPTRDIFF_T, sizeof (X))
+
+
+/* Stored state numbers (used for stacks). */
+typedef yytype_uint8 yy_state_t;
+
+/* State numbers in computations.  */
+typedef int yy_state_fast_t;
 
 #ifndef YY_
 # if defined YYENABLE_NLS && YYENABLE_NLS
 #  if ENABLE_NLS
 #   include <libintl.h> /* INFRINGES ON USER NAME SPACE */
-#   define YY_(msgid) dgettext ("bison-runtime", msgid)
+#   define YY_(Msgid) dgettext ("bison-runtime", Msgid)
 #  endif
 # endif
 # ifndef YY_
-#  define YY_(msgid) msgid
+#  define YY_(Msgid) Msgid
+# endif
+#endif
+
+
+#ifndef YY_ATTRIBUTE_PURE
+# if defined __GNUC__ && 2 < __GNUC__ + (96 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_PURE __attribute__ ((__pure__))
+# else
+#  define YY_ATTRIBUTE_PURE
+# endif
+#endif
+
+#ifndef YY_ATTRIBUTE_UNUSED
+# if defined __GNUC__ && 2 < __GNUC__ + (7 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_UNUSED __attribute__ ((__unused__))
+# else
+#  define YY_ATTRIBUTE_UNUSED
 # endif
 #endif
 
 /* Suppress unused-variable warnings by "using" E.  */
 #if ! defined lint || defined __GNUC__
-# define YYUSE(e) ((void) (e))
+# define YY_USE(E) ((void) (E))
 #else
-# define YYUSE(e) /* empty */
+# define YY_USE(E) /* empty */
 #endif
 
-/* Identity function, used to suppress warnings about constant conditions.  */
-#ifndef lint
-# define YYID(n) (n)
-#else
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static int
-YYID (int i)
+/* Suppress an incorrect diagnostic about yylval being uninitialized.  */
+#if defined __GNUC__ && ! defined __ICC && 406 <= __GNUC__ * 100 + __GNUC_MINOR__
+# if __GNUC__ * 100 + __GNUC_MINOR__ < 407
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")
+# else
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")              \
+    _Pragma ("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+# endif
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END      \
+    _Pragma ("GCC diagnostic pop")
 #else
-static int
-YYID (i)
-    int i;
+# define YY_INITIAL_VALUE(Value) Value
 #endif
-{
-  return i;
-}
+#ifndef YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END
+#endif
+#ifndef YY_INITIAL_VALUE
+# define YY_INITIAL_VALUE(Value) /* Nothing. */
 #endif
 
-#if ! defined yyoverflow || YYERROR_VERBOSE
+#if defined __cplusplus && defined __GNUC__ && ! defined __ICC && 6 <= __GNUC__
+# define YY_IGNORE_USELESS_CAST_BEGIN                          \
+    _Pragma ("GCC diagnostic push")                            \
+    _Pragma ("GCC diagnostic ignored \"-Wuseless-cast\"")
+# define YY_IGNORE_USELESS_CAST_END            \
+    _Pragma ("GCC diagnostic pop")
+#endif
+#ifndef YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_END
+#endif
+
+
+#define YY_ASSERT(E) ((void) (0 && (E)))
+
+#if !defined yyoverflow
 
 /* The parser invokes alloca or malloc; define the necessary symbols.  */
 
@@ -303,11 +561,11 @@ YYID (i)
 #    define alloca _alloca
 #   else
 #    define YYSTACK_ALLOC alloca
-#    if ! defined _ALLOCA_H && ! defined _STDLIB_H && (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+#    if ! defined _ALLOCA_H && ! defined EXIT_SUCCESS
 #     include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
-#     ifndef _STDLIB_H
-#      define _STDLIB_H 1
+      /* Use EXIT_SUCCESS as a witness for stdlib.h.  */
+#     ifndef EXIT_SUCCESS
+#      define EXIT_SUCCESS 0
 #     endif
 #    endif
 #   endif
@@ -315,8 +573,8 @@ YYID (i)
 # endif
 
 # ifdef YYSTACK_ALLOC
-   /* Pacify GCC's `empty if-body' warning.  */
-#  define YYSTACK_FREE(Ptr) do { /* empty */; } while (YYID (0))
+   /* Pacify GCC's 'empty if-body' warning.  */
+#  define YYSTACK_FREE(Ptr) do { /* empty */; } while (0)
 #  ifndef YYSTACK_ALLOC_MAXIMUM
     /* The OS might guarantee only one guard page at the bottom of the stack,
        and a page size can be as small as 4096 bytes.  So we cannot safely
@@ -330,111 +588,117 @@ YYID (i)
 #  ifndef YYSTACK_ALLOC_MAXIMUM
 #   define YYSTACK_ALLOC_MAXIMUM YYSIZE_MAXIMUM
 #  endif
-#  if (defined __cplusplus && ! defined _STDLIB_H \
+#  if (defined __cplusplus && ! defined EXIT_SUCCESS \
        && ! ((defined YYMALLOC || defined malloc) \
-	     && (defined YYFREE || defined free)))
+             && (defined YYFREE || defined free)))
 #   include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
-#   ifndef _STDLIB_H
-#    define _STDLIB_H 1
+#   ifndef EXIT_SUCCESS
+#    define EXIT_SUCCESS 0
 #   endif
 #  endif
 #  ifndef YYMALLOC
 #   define YYMALLOC malloc
-#   if ! defined malloc && ! defined _STDLIB_H && (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+#   if ! defined malloc && ! defined EXIT_SUCCESS
 void *malloc (YYSIZE_T); /* INFRINGES ON USER NAME SPACE */
 #   endif
 #  endif
 #  ifndef YYFREE
 #   define YYFREE free
-#   if ! defined free && ! defined _STDLIB_H && (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+#   if ! defined free && ! defined EXIT_SUCCESS
 void free (void *); /* INFRINGES ON USER NAME SPACE */
 #   endif
 #  endif
 # endif
-#endif /* ! defined yyoverflow || YYERROR_VERBOSE */
-
+#endif /* !defined yyoverflow */
 
 #if (! defined yyoverflow \
      && (! defined __cplusplus \
-	 || (defined YYSTYPE_IS_TRIVIAL && YYSTYPE_IS_TRIVIAL)))
+         || (defined YYSTYPE_IS_TRIVIAL && YYSTYPE_IS_TRIVIAL)))
 
 /* A type that is properly aligned for any stack member.  */
 union yyalloc
 {
-  yytype_int16 yyss;
-  YYSTYPE yyvs;
-  };
+  yy_state_t yyss_alloc;
+  YYSTYPE yyvs_alloc;
+};
 
 /* The size of the maximum gap between one aligned stack and the next.  */
-# define YYSTACK_GAP_MAXIMUM (sizeof (union yyalloc) - 1)
+# define YYSTACK_GAP_MAXIMUM (YYSIZEOF (union yyalloc) - 1)
 
 /* The size of an array large to enough to hold all stacks, each with
    N elements.  */
 # define YYSTACK_BYTES(N) \
-     ((N) * (sizeof (yytype_int16) + sizeof (YYSTYPE)) \
+     ((N) * (YYSIZEOF (yy_state_t) + YYSIZEOF (YYSTYPE)) \
       + YYSTACK_GAP_MAXIMUM)
 
-/* Copy COUNT objects from FROM to TO.  The source and destination do
-   not overlap.  */
-# ifndef YYCOPY
-#  if defined __GNUC__ && 1 < __GNUC__
-#   define YYCOPY(To, From, Count) \
-      __builtin_memcpy (To, From, (Count) * sizeof (*(From)))
-#  else
-#   define YYCOPY(To, From, Count)		\
-      do					\
-	{					\
-	  YYSIZE_T yyi;				\
-	  for (yyi = 0; yyi < (Count); yyi++)	\
-	    (To)[yyi] = (From)[yyi];		\
-	}					\
-      while (YYID (0))
-#  endif
-# endif
+# define YYCOPY_NEEDED 1
 
 /* Relocate STACK from its old location to the new one.  The
    local variables YYSIZE and YYSTACKSIZE give the old and new number of
    elements in the stack, and YYPTR gives the new location of the
    stack.  Advance YYPTR to a properly aligned location for the next
    stack.  */
-# define YYSTACK_RELOCATE(Stack)					\
-    do									\
-      {									\
-	YYSIZE_T yynewbytes;						\
-	YYCOPY (&yyptr->Stack, Stack, yysize);				\
-	Stack = &yyptr->Stack;						\
-	yynewbytes = yystacksize * sizeof (*Stack) + YYSTACK_GAP_MAXIMUM; \
-	yyptr += yynewbytes / sizeof (*yyptr);				\
-      }									\
-    while (YYID (0))
+# define YYSTACK_RELOCATE(Stack_alloc, Stack)                           \
+    do                                                                  \
+      {                                                                 \
+        YYPTRDIFF_T yynewbytes;                                         \
+        YYCOPY (&yyptr->Stack_alloc, Stack, yysize);                    \
+        Stack = &yyptr->Stack_alloc;                                    \
+        yynewbytes = yystacksize * YYSIZEOF (*Stack) + YYSTACK_GAP_MAXIMUM; \
+        yyptr += yynewbytes / YYSIZEOF (*yyptr);                        \
+      }                                                                 \
+    while (0)
 
 #endif
 
+#if defined YYCOPY_NEEDED && YYCOPY_NEEDED
+/* Copy COUNT objects from SRC to DST.  The source and destination do
+   not overlap.  */
+# ifndef YYCOPY
+#  if defined __GNUC__ && 1 < __GNUC__
+#   define YYCOPY(Dst, Src, Count) \
+      __builtin_memcpy (Dst, Src, YY_CAST (YYSIZE_T, (Count)) * sizeof (*(Src)))
+#  else
+#   define YYCOPY(Dst, Src, Count)              \
+      do                                        \
+        {                                       \
+          YYPTRDIFF_T yyi;                      \
+          for (yyi = 0; yyi < (Count); yyi++)   \
+            (Dst)[yyi] = (Src)[yyi];            \
+        }                                       \
+      while (0)
+#  endif
+# endif
+#endif /* !YYCOPY_NEEDED */
+
 /* YYFINAL -- State number of the termination state.  */
 #define YYFINAL  2
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST   33
+#define YYLAST   121
 
 /* YYNTOKENS -- Number of terminals.  */
-#define YYNTOKENS  25
+#define YYNTOKENS  48
 /* YYNNTS -- Number of nonterminals.  */
-#define YYNNTS  13
+#define YYNNTS  26
 /* YYNRULES -- Number of rules.  */
-#define YYNRULES  29
-/* YYNRULES -- Number of states.  */
-#define YYNSTATES  46
+#define YYNRULES  67
+/* YYNSTATES -- Number of states.  */
+#define YYNSTATES  138
 
-/* YYTRANSLATE(YYLEX) -- Bison symbol number corresponding to YYLEX.  */
-#define YYUNDEFTOK  2
-#define YYMAXUTOK   279
+/* YYMAXUTOK -- Last valid token kind.  */
+#define YYMAXUTOK   302
 
-#define YYTRANSLATE(YYX)						\
-  ((unsigned int) (YYX) <= YYMAXUTOK ? yytranslate[YYX] : YYUNDEFTOK)
 
-/* YYTRANSLATE[YYLEX] -- Bison symbol number corresponding to YYLEX.  */
-static const yytype_uint8 yytranslate[] =
+/* YYTRANSLATE(TOKEN-NUM) -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex, with out-of-bounds checking.  */
+#define YYTRANSLATE(YYX)                                \
+  (0 <= (YYX) && (YYX) <= YYMAXUTOK                     \
+   ? YY_CAST (yysymbol_kind_t, yytranslate[YYX])        \
+   : YYSYMBOL_YYUNDEF)
+
+/* YYTRANSLATE[TOKEN-NUM] -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex.  */
+static const yytype_int8 yytranslate[] =
 {
        0,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
@@ -463,242 +727,243 @@ static const yytype_uint8 yytranslate[] =
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     1,     2,     3,     4,
        5,     6,     7,     8,     9,    10,    11,    12,    13,    14,
-      15,    16,    17,    18,    19,    20,    21,    22,    23,    24
+      15,    16,    17,    18,    19,    20,    21,    22,    23,    24,
+      25,    26,    27,    28,    29,    30,    31,    32,    33,    34,
+      35,    36,    37,    38,    39,    40,    41,    42,    43,    44,
+      45,    46,    47
 };
 
 #if YYDEBUG
-/* YYPRHS[YYN] -- Index of the first RHS symbol of rule number YYN in
-   YYRHS.  */
-static const yytype_uint8 yyprhs[] =
+/* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
+static const yytype_int16 yyrline[] =
 {
-       0,     0,     3,     6,     7,     9,    11,    13,    16,    18,
-      20,    26,    34,    40,    48,    50,    54,    58,    60,    62,
-      64,    66,    68,    70,    72,    74,    76,    78,    80,    82
+       0,   205,   205,   206,   210,   211,   212,   213,   214,   215,
+     216,   217,   221,   225,   230,   238,   239,   243,   244,   247,
+     248,   249,   250,   254,   261,   268,   272,   280,   287,   297,
+     313,   318,   326,   336,   349,   350,   354,   355,   363,   364,
+     365,   369,   370,   371,   375,   386,   392,   400,   410,   415,
+     423,   424,   428,   429,   430,   431,   432,   433,   437,   445,
+     446,   450,   454,   455,   456,   457,   458,   459
 };
+#endif
 
-/* YYRHS -- A `-1'-separated list of the rules' RHS.  */
-static const yytype_int8 yyrhs[] =
-{
-      26,     0,    -1,    26,    27,    -1,    -1,    29,    -1,    30,
-      -1,    28,    -1,     1,    15,    -1,    15,    -1,     9,    -1,
-       6,    36,     4,    17,    15,    -1,     6,    36,     4,    17,
-       7,     8,    15,    -1,     3,    33,     4,    36,    15,    -1,
-       3,    33,     4,    36,     5,    31,    15,    -1,    32,    -1,
-      31,    11,    32,    -1,    34,    37,    35,    -1,    34,    -1,
-      14,    -1,    10,    -1,    18,    -1,    16,    -1,    17,    -1,
-      18,    -1,    19,    -1,    20,    -1,    21,    -1,    23,    -1,
-      22,    -1,    24,    -1
-};
+/** Accessing symbol of state STATE.  */
+#define YY_ACCESSING_SYMBOL(State) YY_CAST (yysymbol_kind_t, yystos[State])
 
-/* YYRLINE[YYN] -- source line where rule number YYN was defined.  */
-static const yytype_uint8 yyrline[] =
-{
-       0,    52,    52,    53,    57,    58,    59,    60,    61,    65,
-      69,    74,    82,    87,    98,   104,   112,   122,   123,   124,
-     128,   136,   137,   141,   145,   146,   147,   148,   149,   150
-};
-#endif
+#if YYDEBUG || 0
+/* The user-facing name of the symbol whose (internal) number is
+   YYSYMBOL.  No bounds checking.  */
+static const char *yysymbol_name (yysymbol_kind_t yysymbol) YY_ATTRIBUTE_UNUSED;
 
-#if YYDEBUG || YYERROR_VERBOSE || YYTOKEN_TABLE
 /* YYTNAME[SYMBOL-NUM] -- String name of the symbol SYMBOL-NUM.
    First, the terminals, then, starting at YYNTOKENS, nonterminals.  */
 static const char *const yytname[] =
 {
-  "$end", "error", "$undefined", "SELECT", "FROM", "WHERE", "LOAD",
-  "WITH", "INDEX", "QUIT", "COUNT", "AND", "OR", "COMMA", "STAR", "LF",
-  "INTEGER", "STRING", "ID", "EQUAL", "NEQUAL", "LESS", "LESSEQUAL",
-  "GREATER", "GREATEREQUAL", "$accept", "commands", "command",
-  "quit_command", "load_command", "select_command", "conditions",
-  "condition", "attributes", "attribute", "value", "table", "comparator", 0
+  "\"end of file\"", "error", "\"invalid token\"", "SELECT", "FROM",
+  "WHERE", "LOAD", "WITH", "INDEX", "QUIT", "COUNT", "AND", "OR",
+  "DICTIONARY", "COMPRESSION", "CREATE", "ON", "HASH", "CLUSTERED",
+  "ANALYZE", "SET", "OUTPUT", "LIMIT", "OFFSET", "ORDER", "BY", "ASC",
+  "DESC", "GROUP", "MIN", "MAX", "SUM", "AVG", "COMMA", "DOT", "STAR",
+  "LPAREN", "RPAREN", "LF", "INTEGER", "STRING", "ID", "EQUAL", "NEQUAL",
+  "LESS", "LESSEQUAL", "GREATER", "GREATEREQUAL", "$accept", "commands",
+  "command", "quit_command", "load_command", "load_options", "load_option",
+  "create_command", "analyze_command", "set_command", "select_command",
+  "join_conditions", "join_condition", "group_clause", "select_options",
+  "direction", "limit_options", "row_count", "conditions", "condition",
+  "select_list", "select_item", "attribute", "value", "table",
+  "comparator", YY_NULLPTR
 };
-#endif
 
-# ifdef YYPRINT
-/* YYTOKNUM[YYLEX-NUM] -- Internal token number corresponding to
-   token YYLEX-NUM.  */
-static const yytype_uint16 yytoknum[] =
+static const char *
+yysymbol_name (yysymbol_kind_t yysymbol)
 {
-       0,   256,   257,   258,   259,   260,   261,   262,   263,   264,
-     265,   266,   267,   268,   269,   270,   271,   272,   273,   274,
-     275,   276,   277,   278,   279
-};
-# endif
+  return yytname[yysymbol];
+}
+#endif
+
+#define YYPACT_NINF (-78)
 
-/* YYR1[YYN] -- Symbol number of symbol that rule YYN derives.  */
-static const yytype_uint8 yyr1[] =
+#define yypact_value_is_default(Yyn) \
+  ((Yyn) == YYPACT_NINF)
+
+#define YYTABLE_NINF (-1)
+
+#define yytable_value_is_error(Yyn) \
+  0
+
+/* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
+   STATE-NUM.  */
+static const yytype_int8 yypact[] =
 {
-       0,    25,    26,    26,    27,    27,    27,    27,    27,    28,
-      29,    29,    30,    30,    31,    31,    32,    33,    33,    33,
-      34,    35,    35,    36,    37,    37,    37,    37,    37,    37
+     -78,     6,   -78,   -21,     0,   -14,   -78,    16,   -14,    12,
+     -78,   -78,   -78,   -78,   -78,   -78,   -78,   -78,   -78,   -78,
+      11,    18,    19,    21,   -78,    17,     9,   -78,   -78,   -78,
+      55,    44,    28,    20,    29,    30,    30,    30,    30,    30,
+     -14,     0,    32,   -14,   -78,    43,    46,   -78,    48,    57,
+      58,    59,   -78,    15,   -78,     1,    47,   -78,   -78,   -78,
+     -78,   -78,   -78,    30,    68,   -14,    -6,    56,   -78,    30,
+      35,   -78,    33,    30,    77,    60,    72,    62,   -78,    82,
+     -78,   -78,    94,   -78,   -19,   -78,    66,    30,    -6,   -78,
+     -78,   -78,   -78,   -78,   -78,   -17,   -78,    63,   -78,    83,
+      30,   -78,    30,   -78,    56,   -78,    67,   -78,    69,   -78,
+     -78,   -78,    74,    34,   -78,    60,    23,   -78,   -78,   -78,
+     -78,    30,    63,    71,   -78,   -78,   -78,    88,    45,   -78,
+     -78,   -78,    70,   -17,    78,   -78,    30,   -78
 };
 
-/* YYR2[YYN] -- Number of symbols composing right hand side of rule YYN.  */
-static const yytype_uint8 yyr2[] =
+/* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
+   Performed when YYTABLE does not specify something else to do.  Zero
+   means the default is an error.  */
+static const yytype_int8 yydefact[] =
 {
-       0,     2,     2,     0,     1,     1,     1,     2,     1,     1,
-       5,     7,     5,     7,     1,     3,     3,     1,     1,     1,
-       1,     1,     1,     1,     1,     1,     1,     1,     1,     1
+       3,     0,     1,     0,     0,     0,    12,     0,     0,     0,
+      11,     2,     9,     4,     6,     7,     8,     5,    10,    53,
+       0,     0,     0,     0,    52,    58,     0,    48,    50,    61,
+       0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+       0,     0,     0,     0,    24,     0,     0,    58,     0,     0,
+       0,     0,    51,    34,    49,     0,     0,    25,    26,    54,
+      55,    56,    57,     0,     0,     0,    41,     0,    13,     0,
+      34,    45,     0,     0,     0,     0,     0,     0,    36,    17,
+      20,    21,     0,    22,     0,    15,     0,     0,    41,    62,
+      63,    64,    66,    65,    67,     0,    35,     0,    44,    42,
+       0,    27,     0,    19,     0,    14,     0,    46,     0,    59,
+      60,    47,     0,    41,    30,     0,    38,    18,    16,    23,
+      28,     0,     0,     0,    43,    39,    40,    41,     0,    31,
+      29,    37,    62,     0,     0,    32,     0,    33
 };
 
-/* YYDEFACT[STATE-NAME] -- Default rule to reduce with in state
-   STATE-NUM when YYTABLE doesn't specify something else to do.  Zero
-   means the default is an error.  */
-static const yytype_uint8 yydefact[] =
+/* YYPGOTO[NTERM-NUM].  */
+static const yytype_int8 yypgoto[] =
 {
-       3,     0,     1,     0,     0,     0,     9,     8,     2,     6,
-       4,     5,     7,    19,    18,    20,     0,    17,    23,     0,
-       0,     0,     0,     0,     0,    12,     0,    10,     0,    14,
-       0,     0,     0,    13,    24,    25,    26,    28,    27,    29,
-       0,    11,    15,    21,    22,    16
+     -78,   -78,   -78,   -78,   -78,   -78,    10,   -78,   -78,   -78,
+     -78,   -78,    -9,    49,   -77,   -78,   -12,     2,   -78,    31,
+     -78,    75,   -35,   -13,    -3,    -7
 };
 
 /* YYDEFGOTO[NTERM-NUM].  */
 static const yytype_int8 yydefgoto[] =
 {
-      -1,     1,     8,     9,    10,    11,    28,    29,    16,    30,
-      45,    19,    40
+       0,     1,    11,    12,    13,    84,    85,    14,    15,    16,
+      17,   113,   114,    66,    77,   127,    78,    99,    70,    71,
+      26,    27,    28,   111,    30,    95
 };
 
-/* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
-   STATE-NUM.  */
-#define YYPACT_NINF -14
-static const yytype_int8 yypact[] =
+/* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
+   positive, shift that token.  If negative, reduce the rule whose
+   number is the opposite.  If YYTABLE_NINF, syntax error.  */
+static const yytype_uint8 yytable[] =
 {
-     -14,     0,   -14,    -5,     3,     2,   -14,   -14,   -14,   -14,
-     -14,   -14,   -14,   -14,   -14,   -14,    10,   -14,   -14,    14,
-       2,     5,    -3,     1,    11,   -14,    22,   -14,    -4,   -14,
-       4,    16,    11,   -14,   -14,   -14,   -14,   -14,   -14,   -14,
-     -12,   -14,   -14,   -14,   -14,   -14
+      48,    49,    50,    51,    52,    32,     2,     3,    67,     4,
+      19,   108,     5,    40,   104,     6,    75,    18,    76,   105,
+      63,     7,   109,   110,    31,     8,     9,    29,    72,    20,
+      21,    22,    23,    33,    86,    24,   123,    53,    96,    68,
+      56,    25,    41,    64,    10,   122,    87,    35,    65,   125,
+     126,    39,    72,    34,    36,    37,    75,    38,    76,    42,
+      43,    45,    74,    64,    79,   116,    44,   117,    46,    80,
+      81,    47,    55,    82,    83,    89,    90,    91,    92,    93,
+      94,    57,    97,    69,    58,    59,   128,   132,    90,    91,
+      92,    93,    94,    73,    60,    61,    62,   100,   102,    98,
+     101,   137,   103,   106,   112,   119,   115,   120,   121,   130,
+      75,   134,   136,   129,   118,   131,    54,   124,   107,    88,
+     135,   133
 };
 
-/* YYPGOTO[NTERM-NUM].  */
-static const yytype_int8 yypgoto[] =
+static const yytype_uint8 yycheck[] =
 {
-     -14,   -14,   -14,   -14,   -14,   -14,   -14,   -13,   -14,    28,
-     -14,    13,   -14
+      35,    36,    37,    38,    39,     8,     0,     1,     7,     3,
+      10,    88,     6,     4,    33,     9,    22,    38,    24,    38,
+       5,    15,    39,    40,     8,    19,    20,    41,    63,    29,
+      30,    31,    32,    21,    69,    35,   113,    40,    73,    38,
+      43,    41,    33,    28,    38,    11,    11,    36,    33,    26,
+      27,    34,    87,    41,    36,    36,    22,    36,    24,     4,
+      16,    41,    65,    28,     8,   100,    38,   102,    39,    13,
+      14,    41,    40,    17,    18,    42,    43,    44,    45,    46,
+      47,    38,     5,    36,    38,    37,   121,    42,    43,    44,
+      45,    46,    47,    25,    37,    37,    37,    25,    16,    39,
+      38,   136,     8,    37,    41,    38,    23,    38,    34,    38,
+      22,    41,    34,   122,   104,   127,    41,   115,    87,    70,
+     133,   128
 };
 
-/* YYTABLE[YYPACT[STATE-NUM]].  What to do in state STATE-NUM.  If
-   positive, shift that token.  If negative, reduce the rule which
-   number is the opposite.  If zero, do what YYDEFACT says.
-   If YYTABLE_NINF, syntax error.  */
-#define YYTABLE_NINF -1
-static const yytype_uint8 yytable[] =
+/* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
+   state STATE-NUM.  */
+static const yytype_int8 yystos[] =
 {
-       2,     3,    24,     4,    43,    44,     5,    32,    26,     6,
-      12,    33,    25,    13,    20,     7,    27,    14,    21,    42,
-      18,    15,    23,    34,    35,    36,    37,    38,    39,    15,
-      31,    41,    17,    22
+       0,    49,     0,     1,     3,     6,     9,    15,    19,    20,
+      38,    50,    51,    52,    55,    56,    57,    58,    38,    10,
+      29,    30,    31,    32,    35,    41,    68,    69,    70,    41,
+      72,     8,    72,    21,    41,    36,    36,    36,    36,    34,
+       4,    33,     4,    16,    38,    41,    39,    41,    70,    70,
+      70,    70,    70,    72,    69,    40,    72,    38,    38,    37,
+      37,    37,    37,     5,    28,    33,    61,     7,    38,    36,
+      66,    67,    70,    25,    72,    22,    24,    62,    64,     8,
+      13,    14,    17,    18,    53,    54,    70,    11,    61,    42,
+      43,    44,    45,    46,    47,    73,    70,     5,    39,    65,
+      25,    38,    16,     8,    33,    38,    37,    67,    62,    39,
+      40,    71,    41,    59,    60,    23,    70,    70,    54,    38,
+      38,    34,    11,    62,    65,    26,    27,    63,    70,    60,
+      38,    64,    42,    73,    41,    71,    34,    70
 };
 
-static const yytype_uint8 yycheck[] =
+/* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr1[] =
 {
-       0,     1,     5,     3,    16,    17,     6,    11,     7,     9,
-      15,    15,    15,    10,     4,    15,    15,    14,     4,    32,
-      18,    18,    17,    19,    20,    21,    22,    23,    24,    18,
-       8,    15,     4,    20
+       0,    48,    49,    49,    50,    50,    50,    50,    50,    50,
+      50,    50,    51,    52,    52,    53,    53,    54,    54,    54,
+      54,    54,    54,    55,    56,    57,    57,    58,    58,    58,
+      59,    59,    60,    60,    61,    61,    62,    62,    63,    63,
+      63,    64,    64,    64,    65,    66,    66,    67,    68,    68,
+      69,    69,    69,    69,    69,    69,    69,    69,    70,    71,
+      71,    72,    73,    73,    73,    73,    73,    73
 };
 
-/* YYSTOS[STATE-NUM] -- The (internal number of the) accessing
-   symbol of state STATE-NUM.  */
-static const yytype_uint8 yystos[] =
+/* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr2[] =
 {
-       0,    26,     0,     1,     3,     6,     9,    15,    27,    28,
-      29,    30,    15,    10,    14,    18,    33,    34,    18,    36,
-       4,     4,    36,    17,     5,    15,     7,    15,    31,    32,
-      34,     8,    11,    15,    19,    20,    21,    22,    23,    24,
-      37,    15,    32,    16,    17,    35
+       0,     2,     2,     0,     1,     1,     1,     1,     1,     1,
+       2,     1,     1,     5,     7,     1,     3,     1,     3,     2,
+       1,     1,     1,     8,     3,     4,     4,     7,     9,    10,
+       1,     3,     5,     7,     0,     3,     1,     5,     0,     1,
+       1,     0,     2,     4,     1,     1,     3,     3,     1,     3,
+       1,     3,     1,     1,     4,     4,     4,     4,     1,     1,
+       1,     1,     1,     1,     1,     1,     1,     1
 };
 
-#define yyerrok		(yyerrstatus = 0)
-#define yyclearin	(yychar = YYEMPTY)
-#define YYEMPTY		(-2)
-#define YYEOF		0
 
-#define YYACCEPT	goto yyacceptlab
-#define YYABORT		goto yyabortlab
-#define YYERROR		goto yyerrorlab
+enum { YYENOMEM = -2 };
 
+#define yyerrok         (yyerrstatus = 0)
+#define yyclearin       (yychar = YYEMPTY)
 
-/* Like YYERROR except do call yyerror.  This remains here temporarily
-   to ease the transition to the new meaning of YYERROR, for GCC.
-   Once GCC version 2 has supplanted version 1, this can go.  */
+#define YYACCEPT        goto yyacceptlab
+#define YYABORT         goto yyabortlab
+#define YYERROR         goto yyerrorlab
+#define YYNOMEM         goto yyexhaustedlab
 
-#define YYFAIL		goto yyerrlab
 
 #define YYRECOVERING()  (!!yyerrstatus)
 
-#define YYBACKUP(Token, Value)					\
-do								\
-  if (yychar == YYEMPTY && yylen == 1)				\
-    {								\
-      yychar = (Token);						\
-      yylval = (Value);						\
-      yytoken = YYTRANSLATE (yychar);				\
-      YYPOPSTACK (1);						\
-      goto yybackup;						\
-    }								\
-  else								\
-    {								\
-      yyerror (YY_("syntax error: cannot back up")); \
-      YYERROR;							\
-    }								\
-while (YYID (0))
-
-
-#define YYTERROR	1
-#define YYERRCODE	256
-
-
-/* YYLLOC_DEFAULT -- Set CURRENT to span from RHS[1] to RHS[N].
-   If N is 0, then set CURRENT to the empty location which ends
-   the previous symbol: RHS[0] (always defined).  */
-
-#define YYRHSLOC(Rhs, K) ((Rhs)[K])
-#ifndef YYLLOC_DEFAULT
-# define YYLLOC_DEFAULT(Current, Rhs, N)				\
-    do									\
-      if (YYID (N))                                                    \
-	{								\
-	  (Current).first_line   = YYRHSLOC (Rhs, 1).first_line;	\
-	  (Current).first_column = YYRHSLOC (Rhs, 1).first_column;	\
-	  (Current).last_line    = YYRHSLOC (Rhs, N).last_line;		\
-	  (Current).last_column  = YYRHSLOC (Rhs, N).last_column;	\
-	}								\
-      else								\
-	{								\
-	  (Current).first_line   = (Current).last_line   =		\
-	    YYRHSLOC (Rhs, 0).last_line;				\
-	  (Current).first_column = (Current).last_column =		\
-	    YYRHSLOC (Rhs, 0).last_column;				\
-	}								\
-    while (YYID (0))
-#endif
-
-
-/* YY_LOCATION_PRINT -- Print the location on the stream.
-   This macro was not mandated originally: define only if we know
-   we won't break user code: when these are the locations we know.  */
-
-#ifndef YY_LOCATION_PRINT
-# if defined YYLTYPE_IS_TRIVIAL && YYLTYPE_IS_TRIVIAL
-#  define YY_LOCATION_PRINT(File, Loc)			\
-     fprintf (File, "%d.%d-%d.%d",			\
-	      (Loc).first_line, (Loc).first_column,	\
-	      (Loc).last_line,  (Loc).last_column)
-# else
-#  define YY_LOCATION_PRINT(File, Loc) ((void) 0)
-# endif
-#endif
-
-
-/* YYLEX -- calling `yylex' with the right arguments.  */
+#define YYBACKUP(Token, Value)                                    \
+  do                                                              \
+    if (yychar == YYEMPTY)                                        \
+      {                                                           \
+        yychar = (Token);                                         \
+        yylval = (Value);                                         \
+        YYPOPSTACK (yylen);                                       \
+        yystate = *yyssp;                                         \
+        goto yybackup;                                            \
+      }                                                           \
+    else                                                          \
+      {                                                           \
+        yyerror (YY_("syntax error: cannot back up")); \
+        YYERROR;                                                  \
+      }                                                           \
+  while (0)
+
+/* Backward compatibility with an undocumented macro.
+   Use YYerror or YYUNDEF. */
+#define YYERRCODE YYUNDEF
 
-#ifdef YYLEX_PARAM
-# define YYLEX yylex (YYLEX_PARAM)
-#else
-# define YYLEX yylex ()
-#endif
 
 /* Enable debugging if requested.  */
 #if YYDEBUG
@@ -708,80 +973,58 @@ while (YYID (0))
 #  define YYFPRINTF fprintf
 # endif
 
-# define YYDPRINTF(Args)			\
-do {						\
-  if (yydebug)					\
-    YYFPRINTF Args;				\
-} while (YYID (0))
-
-# define YY_SYMBOL_PRINT(Title, Type, Value, Location)			  \
-do {									  \
-  if (yydebug)								  \
-    {									  \
-      YYFPRINTF (stderr, "%s ", Title);					  \
-      yy_symbol_print (stderr,						  \
-		  Type, Value); \
-      YYFPRINTF (stderr, "\n");						  \
-    }									  \
-} while (YYID (0))
-
-
-/*--------------------------------.
-| Print this symbol on YYOUTPUT.  |
-`--------------------------------*/
-
-/*ARGSUSED*/
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static void
-yy_symbol_value_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvaluep)
-#else
+# define YYDPRINTF(Args)                        \
+do {                                            \
+  if (yydebug)                                  \
+    YYFPRINTF Args;                             \
+} while (0)
+
+
+
+
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)                    \
+do {                                                                      \
+  if (yydebug)                                                            \
+    {                                                                     \
+      YYFPRINTF (stderr, "%s ", Title);                                   \
+      yy_symbol_print (stderr,                                            \
+                  Kind, Value); \
+      YYFPRINTF (stderr, "\n");                                           \
+    }                                                                     \
+} while (0)
+
+
+/*-----------------------------------.
+| Print this symbol's value on YYO.  |
+`-----------------------------------*/
+
 static void
-yy_symbol_value_print (yyoutput, yytype, yyvaluep)
-    FILE *yyoutput;
-    int yytype;
-    YYSTYPE const * const yyvaluep;
-#endif
+yy_symbol_value_print (FILE *yyo,
+                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep)
 {
+  FILE *yyoutput = yyo;
+  YY_USE (yyoutput);
   if (!yyvaluep)
     return;
-# ifdef YYPRINT
-  if (yytype < YYNTOKENS)
-    YYPRINT (yyoutput, yytoknum[yytype], *yyvaluep);
-# else
-  YYUSE (yyoutput);
-# endif
-  switch (yytype)
-    {
-      default:
-	break;
-    }
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
 
 
-/*--------------------------------.
-| Print this symbol on YYOUTPUT.  |
-`--------------------------------*/
+/*---------------------------.
+| Print this symbol on YYO.  |
+`---------------------------*/
 
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
 static void
-yy_symbol_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvaluep)
-#else
-static void
-yy_symbol_print (yyoutput, yytype, yyvaluep)
-    FILE *yyoutput;
-    int yytype;
-    YYSTYPE const * const yyvaluep;
-#endif
+yy_symbol_print (FILE *yyo,
+                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep)
 {
-  if (yytype < YYNTOKENS)
-    YYFPRINTF (yyoutput, "token %s (", yytname[yytype]);
-  else
-    YYFPRINTF (yyoutput, "nterm %s (", yytname[yytype]);
+  YYFPRINTF (yyo, "%s %s (",
+             yykind < YYNTOKENS ? "token" : "nterm", yysymbol_name (yykind));
 
-  yy_symbol_value_print (yyoutput, yytype, yyvaluep);
-  YYFPRINTF (yyoutput, ")");
+  yy_symbol_value_print (yyo, yykind, yyvaluep);
+  YYFPRINTF (yyo, ")");
 }
 
 /*------------------------------------------------------------------.
@@ -789,80 +1032,68 @@ yy_symbol_print (yyoutput, yytype, yyvaluep)
 | TOP (included).                                                   |
 `------------------------------------------------------------------*/
 
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static void
-yy_stack_print (yytype_int16 *bottom, yytype_int16 *top)
-#else
 static void
-yy_stack_print (bottom, top)
-    yytype_int16 *bottom;
-    yytype_int16 *top;
-#endif
+yy_stack_print (yy_state_t *yybottom, yy_state_t *yytop)
 {
   YYFPRINTF (stderr, "Stack now");
-  for (; bottom <= top; ++bottom)
-    YYFPRINTF (stderr, " %d", *bottom);
+  for (; yybottom <= yytop; yybottom++)
+    {
+      int yybot = *yybottom;
+      YYFPRINTF (stderr, " %d", yybot);
+    }
   YYFPRINTF (stderr, "\n");
 }
 
-# define YY_STACK_PRINT(Bottom, Top)				\
-do {								\
-  if (yydebug)							\
-    yy_stack_print ((Bottom), (Top));				\
-} while (YYID (0))
+# define YY_STACK_PRINT(Bottom, Top)                            \
+do {                                                            \
+  if (yydebug)                                                  \
+    yy_stack_print ((Bottom), (Top));                           \
+} while (0)
 
 
 /*------------------------------------------------.
 | Report that the YYRULE is going to be reduced.  |
 `------------------------------------------------*/
 
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
 static void
-yy_reduce_print (YYSTYPE *yyvsp, int yyrule)
-#else
-static void
-yy_reduce_print (yyvsp, yyrule)
-    YYSTYPE *yyvsp;
-    int yyrule;
-#endif
+yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
+                 int yyrule)
 {
+  int yylno = yyrline[yyrule];
   int yynrhs = yyr2[yyrule];
   int yyi;
-  unsigned long int yylno = yyrline[yyrule];
-  YYFPRINTF (stderr, "Reducing stack by rule %d (line %lu):\n",
-	     yyrule - 1, yylno);
+  YYFPRINTF (stderr, "Reducing stack by rule %d (line %d):\n",
+             yyrule - 1, yylno);
   /* The symbols being reduced.  */
   for (yyi = 0; yyi < yynrhs; yyi++)
     {
-      fprintf (stderr, "   $%d = ", yyi + 1);
-      yy_symbol_print (stderr, yyrhs[yyprhs[yyrule] + yyi],
-		       &(yyvsp[(yyi + 1) - (yynrhs)])
-		       		       );
-      fprintf (stderr, "\n");
+      YYFPRINTF (stderr, "   $%d = ", yyi + 1);
+      yy_symbol_print (stderr,
+                       YY_ACCESSING_SYMBOL (+yyssp[yyi + 1 - yynrhs]),
+                       &yyvsp[(yyi + 1) - (yynrhs)]);
+      YYFPRINTF (stderr, "\n");
     }
 }
 
-# define YY_REDUCE_PRINT(Rule)		\
-do {					\
-  if (yydebug)				\
-    yy_reduce_print (yyvsp, Rule); \
-} while (YYID (0))
+# define YY_REDUCE_PRINT(Rule)          \
+do {                                    \
+  if (yydebug)                          \
+    yy_reduce_print (yyssp, yyvsp, Rule); \
+} while (0)
 
 /* Nonzero means print parse trace.  It is left uninitialized so that
    multiple parsers can coexist.  */
 int yydebug;
 #else /* !YYDEBUG */
-# define YYDPRINTF(Args)
-# define YY_SYMBOL_PRINT(Title, Type, Value, Location)
+# define YYDPRINTF(Args) ((void) 0)
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)
 # define YY_STACK_PRINT(Bottom, Top)
 # define YY_REDUCE_PRINT(Rule)
 #endif /* !YYDEBUG */
 
 
 /* YYINITDEPTH -- initial size of the parser's stacks.  */
-#ifndef	YYINITDEPTH
+#ifndef YYINITDEPTH
 # define YYINITDEPTH 200
 #endif
 
@@ -877,478 +1108,219 @@ int yydebug;
 # define YYMAXDEPTH 10000
 #endif
 
-
-
-#if YYERROR_VERBOSE
-
-# ifndef yystrlen
-#  if defined __GLIBC__ && defined _STRING_H
-#   define yystrlen strlen
-#  else
-/* Return the length of YYSTR.  */
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static YYSIZE_T
-yystrlen (const char *yystr)
-#else
-static YYSIZE_T
-yystrlen (yystr)
-    const char *yystr;
-#endif
-{
-  YYSIZE_T yylen;
-  for (yylen = 0; yystr[yylen]; yylen++)
-    continue;
-  return yylen;
-}
-#  endif
-# endif
-
-# ifndef yystpcpy
-#  if defined __GLIBC__ && defined _STRING_H && defined _GNU_SOURCE
-#   define yystpcpy stpcpy
-#  else
-/* Copy YYSRC to YYDEST, returning the address of the terminating '\0' in
-   YYDEST.  */
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static char *
-yystpcpy (char *yydest, const char *yysrc)
-#else
-static char *
-yystpcpy (yydest, yysrc)
-    char *yydest;
-    const char *yysrc;
-#endif
-{
-  char *yyd = yydest;
-  const char *yys = yysrc;
-
-  while ((*yyd++ = *yys++) != '\0')
-    continue;
-
-  return yyd - 1;
-}
-#  endif
-# endif
-
-# ifndef yytnamerr
-/* Copy to YYRES the contents of YYSTR after stripping away unnecessary
-   quotes and backslashes, so that it's suitable for yyerror.  The
-   heuristic is that double-quoting is unnecessary unless the string
-   contains an apostrophe, a comma, or backslash (other than
-   backslash-backslash).  YYSTR is taken from yytname.  If YYRES is
-   null, do not copy; instead, return the length of what the result
-   would have been.  */
-static YYSIZE_T
-yytnamerr (char *yyres, const char *yystr)
-{
-  if (*yystr == '"')
-    {
-      YYSIZE_T yyn = 0;
-      char const *yyp = yystr;
-
-      for (;;)
-	switch (*++yyp)
-	  {
-	  case '\'':
-	  case ',':
-	    goto do_not_strip_quotes;
-
-	  case '\\':
-	    if (*++yyp != '\\')
-	      goto do_not_strip_quotes;
-	    /* Fall through.  */
-	  default:
-	    if (yyres)
-	      yyres[yyn] = *yyp;
-	    yyn++;
-	    break;
-
-	  case '"':
-	    if (yyres)
-	      yyres[yyn] = '\0';
-	    return yyn;
-	  }
-    do_not_strip_quotes: ;
-    }
 
-  if (! yyres)
-    return yystrlen (yystr);
 
-  return yystpcpy (yyres, yystr) - yyres;
-}
-# endif
 
-/* Copy into YYRESULT an error message about the unexpected token
-   YYCHAR while in state YYSTATE.  Return the number of bytes copied,
-   including the terminating null byte.  If YYRESULT is null, do not
-   copy anything; just return the number of bytes that would be
-   copied.  As a special case, return 0 if an ordinary "syntax error"
-   message will do.  Return YYSIZE_MAXIMUM if overflow occurs during
-   size calculation.  */
-static YYSIZE_T
-yysyntax_error (char *yyresult, int yystate, int yychar)
-{
-  int yyn = yypact[yystate];
 
-  if (! (YYPACT_NINF < yyn && yyn <= YYLAST))
-    return 0;
-  else
-    {
-      int yytype = YYTRANSLATE (yychar);
-      YYSIZE_T yysize0 = yytnamerr (0, yytname[yytype]);
-      YYSIZE_T yysize = yysize0;
-      YYSIZE_T yysize1;
-      int yysize_overflow = 0;
-      enum { YYERROR_VERBOSE_ARGS_MAXIMUM = 5 };
-      char const *yyarg[YYERROR_VERBOSE_ARGS_MAXIMUM];
-      int yyx;
-
-# if 0
-      /* This is so xgettext sees the translatable formats that are
-	 constructed on the fly.  */
-      YY_("syntax error, unexpected %s");
-      YY_("syntax error, unexpected %s, expecting %s");
-      YY_("syntax error, unexpected %s, expecting %s or %s");
-      YY_("syntax error, unexpected %s, expecting %s or %s or %s");
-      YY_("syntax error, unexpected %s, expecting %s or %s or %s or %s");
-# endif
-      char *yyfmt;
-      char const *yyf;
-      static char const yyunexpected[] = "syntax error, unexpected %s";
-      static char const yyexpecting[] = ", expecting %s";
-      static char const yyor[] = " or %s";
-      char yyformat[sizeof yyunexpected
-		    + sizeof yyexpecting - 1
-		    + ((YYERROR_VERBOSE_ARGS_MAXIMUM - 2)
-		       * (sizeof yyor - 1))];
-      char const *yyprefix = yyexpecting;
-
-      /* Start YYX at -YYN if negative to avoid negative indexes in
-	 YYCHECK.  */
-      int yyxbegin = yyn < 0 ? -yyn : 0;
-
-      /* Stay within bounds of both yycheck and yytname.  */
-      int yychecklim = YYLAST - yyn + 1;
-      int yyxend = yychecklim < YYNTOKENS ? yychecklim : YYNTOKENS;
-      int yycount = 1;
-
-      yyarg[0] = yytname[yytype];
-      yyfmt = yystpcpy (yyformat, yyunexpected);
-
-      for (yyx = yyxbegin; yyx < yyxend; ++yyx)
-	if (yycheck[yyx + yyn] == yyx && yyx != YYTERROR)
-	  {
-	    if (yycount == YYERROR_VERBOSE_ARGS_MAXIMUM)
-	      {
-		yycount = 1;
-		yysize = yysize0;
-		yyformat[sizeof yyunexpected - 1] = '\0';
-		break;
-	      }
-	    yyarg[yycount++] = yytname[yyx];
-	    yysize1 = yysize + yytnamerr (0, yytname[yyx]);
-	    yysize_overflow |= (yysize1 < yysize);
-	    yysize = yysize1;
-	    yyfmt = yystpcpy (yyfmt, yyprefix);
-	    yyprefix = yyor;
-	  }
-
-      yyf = YY_(yyformat);
-      yysize1 = yysize + yystrlen (yyf);
-      yysize_overflow |= (yysize1 < yysize);
-      yysize = yysize1;
-
-      if (yysize_overflow)
-	return YYSIZE_MAXIMUM;
-
-      if (yyresult)
-	{
-	  /* Avoid sprintf, as that infringes on the user's name space.
-	     Don't have undefined behavior even if the translation
-	     produced a string with the wrong number of "%s"s.  */
-	  char *yyp = yyresult;
-	  int yyi = 0;
-	  while ((*yyp = *yyf) != '\0')
-	    {
-	      if (*yyp == '%' && yyf[1] == 's' && yyi < yycount)
-		{
-		  yyp += yytnamerr (yyp, yyarg[yyi++]);
-		  yyf += 2;
-		}
-	      else
-		{
-		  yyp++;
-		  yyf++;
-		}
-	    }
-	}
-      return yysize;
-    }
-}
-#endif /* YYERROR_VERBOSE */
-
 
 /*-----------------------------------------------.
 | Release the memory associated to this symbol.  |
 `-----------------------------------------------*/
 
-/*ARGSUSED*/
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
 static void
-yydestruct (const char *yymsg, int yytype, YYSTYPE *yyvaluep)
-#else
-static void
-yydestruct (yymsg, yytype, yyvaluep)
-    const char *yymsg;
-    int yytype;
-    YYSTYPE *yyvaluep;
-#endif
+yydestruct (const char *yymsg,
+            yysymbol_kind_t yykind, YYSTYPE *yyvaluep)
 {
-  YYUSE (yyvaluep);
-
+  YY_USE (yyvaluep);
   if (!yymsg)
     yymsg = "Deleting";
-  YY_SYMBOL_PRINT (yymsg, yytype, yyvaluep, yylocationp);
-
-  switch (yytype)
-    {
+  YY_SYMBOL_PRINT (yymsg, yykind, yyvaluep, yylocationp);
 
-      default:
-	break;
-    }
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
-
-
-/* Prevent warnings from -Wmissing-prototypes.  */
-
-#ifdef YYPARSE_PARAM
-#if defined __STDC__ || defined __cplusplus
-int yyparse (void *YYPARSE_PARAM);
-#else
-int yyparse ();
-#endif
-#else /* ! YYPARSE_PARAM */
-#if defined __STDC__ || defined __cplusplus
-int yyparse (void);
-#else
-int yyparse ();
-#endif
-#endif /* ! YYPARSE_PARAM */
 
 
-
-/* The look-ahead symbol.  */
+/* Lookahead token kind.  */
 int yychar;
 
-/* The semantic value of the look-ahead symbol.  */
+/* The semantic value of the lookahead symbol.  */
 YYSTYPE yylval;
-
 /* Number of syntax errors so far.  */
 int yynerrs;
 
 
 
+
 /*----------.
 | yyparse.  |
 `----------*/
 
-#ifdef YYPARSE_PARAM
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-int
-yyparse (void *YYPARSE_PARAM)
-#else
-int
-yyparse (YYPARSE_PARAM)
-    void *YYPARSE_PARAM;
-#endif
-#else /* ! YYPARSE_PARAM */
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
 int
 yyparse (void)
-#else
-int
-yyparse ()
-
-#endif
-#endif
 {
-  
-  int yystate;
-  int yyn;
-  int yyresult;
-  /* Number of tokens to shift before error messages enabled.  */
-  int yyerrstatus;
-  /* Look-ahead token as an internal (translated) token number.  */
-  int yytoken = 0;
-#if YYERROR_VERBOSE
-  /* Buffer for error messages, and its allocated size.  */
-  char yymsgbuf[128];
-  char *yymsg = yymsgbuf;
-  YYSIZE_T yymsg_alloc = sizeof yymsgbuf;
-#endif
-
-  /* Three stacks and their tools:
-     `yyss': related to states,
-     `yyvs': related to semantic values,
-     `yyls': related to locations.
+    yy_state_fast_t yystate = 0;
+    /* Number of tokens to shift before error messages enabled.  */
+    int yyerrstatus = 0;
 
-     Refer to the stacks thru separate pointers, to allow yyoverflow
-     to reallocate them elsewhere.  */
+    /* Refer to the stacks through separate pointers, to allow yyoverflow
+       to reallocate them elsewhere.  */
 
-  /* The state stack.  */
-  yytype_int16 yyssa[YYINITDEPTH];
-  yytype_int16 *yyss = yyssa;
-  yytype_int16 *yyssp;
+    /* Their size.  */
+    YYPTRDIFF_T yystacksize = YYINITDEPTH;
 
-  /* The semantic value stack.  */
-  YYSTYPE yyvsa[YYINITDEPTH];
-  YYSTYPE *yyvs = yyvsa;
-  YYSTYPE *yyvsp;
+    /* The state stack: array, bottom, top.  */
+    yy_state_t yyssa[YYINITDEPTH];
+    yy_state_t *yyss = yyssa;
+    yy_state_t *yyssp = yyss;
 
+    /* The semantic value stack: array, bottom, top.  */
+    YYSTYPE yyvsa[YYINITDEPTH];
+    YYSTYPE *yyvs = yyvsa;
+    YYSTYPE *yyvsp = yyvs;
 
-
-#define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N))
-
-  YYSIZE_T yystacksize = YYINITDEPTH;
-
+  int yyn;
+  /* The return value of yyparse.  */
+  int yyresult;
+  /* Lookahead symbol kind.  */
+  yysymbol_kind_t yytoken = YYSYMBOL_YYEMPTY;
   /* The variables used to return semantic value and location from the
      action routines.  */
   YYSTYPE yyval;
 
 
+
+#define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N))
+
   /* The number of symbols on the RHS of the reduced rule.
      Keep to zero when no symbol should be popped.  */
   int yylen = 0;
 
   YYDPRINTF ((stderr, "Starting parse\n"));
 
-  yystate = 0;
-  yyerrstatus = 0;
-  yynerrs = 0;
-  yychar = YYEMPTY;		/* Cause a token to be read.  */
-
-  /* Initialize stack pointers.
-     Waste one element of value and location stack
-     so that they stay on the same level as the state stack.
-     The wasted elements are never initialized.  */
-
-  yyssp = yyss;
-  yyvsp = yyvs;
+  yychar = YYEMPTY; /* Cause a token to be read.  */
 
   goto yysetstate;
 
+
 /*------------------------------------------------------------.
-| yynewstate -- Push a new state, which is found in yystate.  |
+| yynewstate -- push a new state, which is found in yystate.  |
 `------------------------------------------------------------*/
- yynewstate:
+yynewstate:
   /* In all cases, when you get here, the value and location stacks
      have just been pushed.  So pushing a state here evens the stacks.  */
   yyssp++;
 
- yysetstate:
-  *yyssp = yystate;
+
+/*--------------------------------------------------------------------.
+| yysetstate -- set current state (the top of the stack) to yystate.  |
+`--------------------------------------------------------------------*/
+yysetstate:
+  YYDPRINTF ((stderr, "Entering state %d\n", yystate));
+  YY_ASSERT (0 <= yystate && yystate < YYNSTATES);
+  YY_IGNORE_USELESS_CAST_BEGIN
+  *yyssp = YY_CAST (yy_state_t, yystate);
+  YY_IGNORE_USELESS_CAST_END
+  YY_STACK_PRINT (yyss, yyssp);
 
   if (yyss + yystacksize - 1 <= yyssp)
+#if !defined yyoverflow && !defined YYSTACK_RELOCATE
+    YYNOMEM;
+#else
     {
       /* Get the current used size of the three stacks, in elements.  */
-      YYSIZE_T yysize = yyssp - yyss + 1;
+      YYPTRDIFF_T yysize = yyssp - yyss + 1;
 
-#ifdef yyoverflow
+# if defined yyoverflow
       {
-	/* Give user a chance to reallocate the stack.  Use copies of
-	   these so that the &'s don't force the real ones into
-	   memory.  */
-	YYSTYPE *yyvs1 = yyvs;
-	yytype_int16 *yyss1 = yyss;
-
-
-	/* Each stack pointer address is followed by the size of the
-	   data in use in that stack, in bytes.  This used to be a
-	   conditional around just the two extra args, but that might
-	   be undefined if yyoverflow is a macro.  */
-	yyoverflow (YY_("memory exhausted"),
-		    &yyss1, yysize * sizeof (*yyssp),
-		    &yyvs1, yysize * sizeof (*yyvsp),
-
-		    &yystacksize);
-
-	yyss = yyss1;
-	yyvs = yyvs1;
+        /* Give user a chance to reallocate the stack.  Use copies of
+           these so that the &'s don't force the real ones into
+           memory.  */
+        yy_state_t *yyss1 = yyss;
+        YYSTYPE *yyvs1 = yyvs;
+
+        /* Each stack pointer address is followed by the size of the
+           data in use in that stack, in bytes.  This used to be a
+           conditional around just the two extra args, but that might
+           be undefined if yyoverflow is a macro.  */
+        yyoverflow (YY_("memory exhausted"),
+                    &yyss1, yysize * YYSIZEOF (*yyssp),
+                    &yyvs1, yysize * YYSIZEOF (*yyvsp),
+                    &yystacksize);
+        yyss = yyss1;
+        yyvs = yyvs1;
       }
-#else /* no yyoverflow */
-# ifndef YYSTACK_RELOCATE
-      goto yyexhaustedlab;
-# else
+# else /* defined YYSTACK_RELOCATE */
       /* Extend the stack our own way.  */
       if (YYMAXDEPTH <= yystacksize)
-	goto yyexhaustedlab;
+        YYNOMEM;
       yystacksize *= 2;
       if (YYMAXDEPTH < yystacksize)
-	yystacksize = YYMAXDEPTH;
+        yystacksize = YYMAXDEPTH;
 
       {
-	yytype_int16 *yyss1 = yyss;
-	union yyalloc *yyptr =
-	  (union yyalloc *) YYSTACK_ALLOC (YYSTACK_BYTES (yystacksize));
-	if (! yyptr)
-	  goto yyexhaustedlab;
-	YYSTACK_RELOCATE (yyss);
-	YYSTACK_RELOCATE (yyvs);
-
+        yy_state_t *yyss1 = yyss;
+        union yyalloc *yyptr =
+          YY_CAST (union yyalloc *,
+                   YYSTACK_ALLOC (YY_CAST (YYSIZE_T, YYSTACK_BYTES (yystacksize))));
+        if (! yyptr)
+          YYNOMEM;
+        YYSTACK_RELOCATE (yyss_alloc, yyss);
+        YYSTACK_RELOCATE (yyvs_alloc, yyvs);
 #  undef YYSTACK_RELOCATE
-	if (yyss1 != yyssa)
-	  YYSTACK_FREE (yyss1);
+        if (yyss1 != yyssa)
+          YYSTACK_FREE (yyss1);
       }
 # endif
-#endif /* no yyoverflow */
 
       yyssp = yyss + yysize - 1;
       yyvsp = yyvs + yysize - 1;
 
-
-      YYDPRINTF ((stderr, "Stack size increased to %lu\n",
-		  (unsigned long int) yystacksize));
+      YY_IGNORE_USELESS_CAST_BEGIN
+      YYDPRINTF ((stderr, "Stack size increased to %ld\n",
+                  YY_CAST (long, yystacksize)));
+      YY_IGNORE_USELESS_CAST_END
 
       if (yyss + yystacksize - 1 <= yyssp)
-	YYABORT;
+        YYABORT;
     }
+#endif /* !defined yyoverflow && !defined YYSTACK_RELOCATE */
 
-  YYDPRINTF ((stderr, "Entering state %d\n", yystate));
+
+  if (yystate == YYFINAL)
+    YYACCEPT;
 
   goto yybackup;
 
+
 /*-----------.
 | yybackup.  |
 `-----------*/
 yybackup:
-
   /* Do appropriate processing given the current state.  Read a
-     look-ahead token if we need one and don't already have one.  */
+     lookahead token if we need one and don't already have one.  */
 
-  /* First try to decide what to do without reference to look-ahead token.  */
+  /* First try to decide what to do without reference to lookahead token.  */
   yyn = yypact[yystate];
-  if (yyn == YYPACT_NINF)
+  if (yypact_value_is_default (yyn))
     goto yydefault;
 
-  /* Not known => get a look-ahead token if don't already have one.  */
+  /* Not known => get a lookahead token if don't already have one.  */
 
-  /* YYCHAR is either YYEMPTY or YYEOF or a valid look-ahead symbol.  */
+  /* YYCHAR is either empty, or end-of-input, or a valid lookahead.  */
   if (yychar == YYEMPTY)
     {
-      YYDPRINTF ((stderr, "Reading a token: "));
-      yychar = YYLEX;
+      YYDPRINTF ((stderr, "Reading a token\n"));
+      yychar = yylex ();
     }
 
   if (yychar <= YYEOF)
     {
-      yychar = yytoken = YYEOF;
+      yychar = YYEOF;
+      yytoken = YYSYMBOL_YYEOF;
       YYDPRINTF ((stderr, "Now at end of input.\n"));
     }
+  else if (yychar == YYerror)
+    {
+      /* The scanner already issued an error message, process directly
+         to error recovery.  But do not keep the error token as
+         lookahead, it is too special and may lead us to an endless
+         loop in error recovery. */
+      yychar = YYUNDEF;
+      yytoken = YYSYMBOL_YYerror;
+      goto yyerrlab1;
+    }
   else
     {
       yytoken = YYTRANSLATE (yychar);
@@ -1363,30 +1335,26 @@ yybackup:
   yyn = yytable[yyn];
   if (yyn <= 0)
     {
-      if (yyn == 0 || yyn == YYTABLE_NINF)
-	goto yyerrlab;
+      if (yytable_value_is_error (yyn))
+        goto yyerrlab;
       yyn = -yyn;
       goto yyreduce;
     }
 
-  if (yyn == YYFINAL)
-    YYACCEPT;
-
   /* Count tokens shifted since error; after three, turn off error
      status.  */
   if (yyerrstatus)
     yyerrstatus--;
 
-  /* Shift the look-ahead token.  */
+  /* Shift the lookahead token.  */
   YY_SYMBOL_PRINT ("Shifting", yytoken, &yylval, &yylloc);
-
-  /* Discard the shifted token unless it is eof.  */
-  if (yychar != YYEOF)
-    yychar = YYEMPTY;
-
   yystate = yyn;
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
   *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 
+  /* Discard the shifted token.  */
+  yychar = YYEMPTY;
   goto yynewstate;
 
 
@@ -1401,14 +1369,14 @@ yydefault:
 
 
 /*-----------------------------.
-| yyreduce -- Do a reduction.  |
+| yyreduce -- do a reduction.  |
 `-----------------------------*/
 yyreduce:
   /* yyn is the number of a rule to reduce with.  */
   yylen = yyr2[yyn];
 
   /* If YYLEN is nonzero, implement the default value of the action:
-     `$$ = $1'.
+     '$$ = $1'.
 
      Otherwise, the following line sets YYVAL to garbage.
      This behavior is undocumented and Bison
@@ -1421,266 +1389,573 @@ yyreduce:
   YY_REDUCE_PRINT (yyn);
   switch (yyn)
     {
-        case 4:
-#line 57 "SqlParser.y"
-    { fprintf(stdout, "Bruinbase> "); ;}
+  case 4: /* command: load_command  */
+#line 210 "SqlParser.y"
+                     { fprintf(stdout, "Bruinbase> "); }
+#line 1396 "SqlParser.tab.c"
     break;
 
-  case 5:
-#line 58 "SqlParser.y"
-    { fprintf(stdout, "Bruinbase> "); ;}
+  case 5: /* command: select_command  */
+#line 211 "SqlParser.y"
+                         { fprintf(stdout, "Bruinbase> "); }
+#line 1402 "SqlParser.tab.c"
     break;
 
-  case 7:
-#line 60 "SqlParser.y"
-    { fprintf(stdout, "Bruinbase> "); ;}
+  case 6: /* command: create_command  */
+#line 212 "SqlParser.y"
+                         { fprintf(stdout, "Bruinbase> "); }
+#line 1408 "SqlParser.tab.c"
     break;
 
-  case 8:
-#line 61 "SqlParser.y"
-    { fprintf(stdout, "Bruinbase> "); ;}
+  case 7: /* command: analyze_command  */
+#line 213 "SqlParser.y"
+                          { fprintf(stdout, "Bruinbase> "); }
+#line 1414 "SqlParser.tab.c"
     break;
 
-  case 9:
-#line 65 "SqlParser.y"
-    { return 0; ;}
+  case 8: /* command: set_command  */
+#line 214 "SqlParser.y"
+                      { fprintf(stdout, "Bruinbase> "); }
+#line 1420 "SqlParser.tab.c"
     break;
 
-  case 10:
-#line 69 "SqlParser.y"
-    { 
-	  SqlEngine::load(std::string((yyvsp[(2) - (5)].string)), std::string((yyvsp[(4) - (5)].string)), false); 
-	  free((yyvsp[(2) - (5)].string));
-	  free((yyvsp[(4) - (5)].string));
-	;}
+  case 10: /* command: error LF  */
+#line 216 "SqlParser.y"
+                   { fprintf(stdout, "Bruinbase> "); }
+#line 1426 "SqlParser.tab.c"
     break;
 
-  case 11:
-#line 74 "SqlParser.y"
-    { 
-	  SqlEngine::load(std::string((yyvsp[(2) - (7)].string)), std::string((yyvsp[(4) - (7)].string)), true); 
-	  free((yyvsp[(2) - (7)].string));
-	  free((yyvsp[(4) - (7)].string));
-	;}
+  case 11: /* command: LF  */
+#line 217 "SqlParser.y"
+             { fprintf(stdout, "Bruinbase> "); }
+#line 1432 "SqlParser.tab.c"
     break;
 
-  case 12:
-#line 82 "SqlParser.y"
-    {
+  case 12: /* quit_command: QUIT  */
+#line 221 "SqlParser.y"
+             { return 0; }
+#line 1438 "SqlParser.tab.c"
+    break;
+
+  case 13: /* load_command: LOAD table FROM STRING LF  */
+#line 225 "SqlParser.y"
+                                  { 
+	  SqlEngine::load(std::string((yyvsp[-3].string)), std::string((yyvsp[-1].string)), 0); 
+	  free((yyvsp[-3].string));
+	  free((yyvsp[-1].string));
+	}
+#line 1448 "SqlParser.tab.c"
+    break;
+
+  case 14: /* load_command: LOAD table FROM STRING WITH load_options LF  */
+#line 230 "SqlParser.y"
+                                                      { 
+	  SqlEngine::load(std::string((yyvsp[-5].string)), std::string((yyvsp[-3].string)), (yyvsp[-1].integer)); 
+	  free((yyvsp[-5].string));
+	  free((yyvsp[-3].string));
+	}
+#line 1458 "SqlParser.tab.c"
+    break;
+
+  case 15: /* load_options: load_option  */
+#line 238 "SqlParser.y"
+                    { (yyval.integer) = (yyvsp[0].integer); }
+#line 1464 "SqlParser.tab.c"
+    break;
+
+  case 16: /* load_options: load_options COMMA load_option  */
+#line 239 "SqlParser.y"
+                                         { (yyval.integer) = (yyvsp[-2].integer) | (yyvsp[0].integer); }
+#line 1470 "SqlParser.tab.c"
+    break;
+
+  case 17: /* load_option: INDEX  */
+#line 243 "SqlParser.y"
+                     { (yyval.integer) = SqlEngine::LOAD_INDEX; }
+#line 1476 "SqlParser.tab.c"
+    break;
+
+  case 18: /* load_option: INDEX ON attribute  */
+#line 244 "SqlParser.y"
+                             {
+	  (yyval.integer) = ((yyvsp[0].integer) == 2) ? SqlEngine::LOAD_VALUE_INDEX : SqlEngine::LOAD_INDEX;
+	}
+#line 1484 "SqlParser.tab.c"
+    break;
+
+  case 19: /* load_option: HASH INDEX  */
+#line 247 "SqlParser.y"
+                     { (yyval.integer) = SqlEngine::LOAD_HASH_INDEX; }
+#line 1490 "SqlParser.tab.c"
+    break;
+
+  case 20: /* load_option: DICTIONARY  */
+#line 248 "SqlParser.y"
+                     { (yyval.integer) = SqlEngine::LOAD_DICTIONARY; }
+#line 1496 "SqlParser.tab.c"
+    break;
+
+  case 21: /* load_option: COMPRESSION  */
+#line 249 "SqlParser.y"
+                      { (yyval.integer) = SqlEngine::LOAD_COMPRESSION; }
+#line 1502 "SqlParser.tab.c"
+    break;
+
+  case 22: /* load_option: CLUSTERED  */
+#line 250 "SqlParser.y"
+                     { (yyval.integer) = SqlEngine::LOAD_CLUSTERED; }
+#line 1508 "SqlParser.tab.c"
+    break;
+
+  case 23: /* create_command: CREATE INDEX ON table LPAREN attribute RPAREN LF  */
+#line 254 "SqlParser.y"
+                                                         {
+	  SqlEngine::createIndex(std::string((yyvsp[-4].string)), (yyvsp[-2].integer));
+	  free((yyvsp[-4].string));
+	}
+#line 1517 "SqlParser.tab.c"
+    break;
+
+  case 24: /* analyze_command: ANALYZE table LF  */
+#line 261 "SqlParser.y"
+                         {
+	  SqlEngine::analyze(std::string((yyvsp[-1].string)));
+	  free((yyvsp[-1].string));
+	}
+#line 1526 "SqlParser.tab.c"
+    break;
+
+  case 25: /* set_command: SET OUTPUT ID LF  */
+#line 268 "SqlParser.y"
+                         {
+	  SqlEngine::setOutputFormat(std::string((yyvsp[-1].string)));
+	  free((yyvsp[-1].string));
+	}
+#line 1535 "SqlParser.tab.c"
+    break;
+
+  case 26: /* set_command: SET ID INTEGER LF  */
+#line 272 "SqlParser.y"
+                            {
+	  SqlEngine::setParameter(std::string((yyvsp[-2].string)), atoi((yyvsp[-1].string)));
+	  free((yyvsp[-2].string));
+	  free((yyvsp[-1].string));
+	}
+#line 1545 "SqlParser.tab.c"
+    break;
+
+  case 27: /* select_command: SELECT select_list FROM table group_clause select_options LF  */
+#line 280 "SqlParser.y"
+                                                                     {
    	        std::vector<SelCond> conds;
-		runSelect((yyvsp[(2) - (5)].integer), (yyvsp[(4) - (5)].string), conds);
-		free((yyvsp[(4) - (5)].string));
-	;}
+		runSelect(*(yyvsp[-5].items), (yyvsp[-3].string), conds, (yyvsp[-2].integer), *(yyvsp[-1].options));
+		freeSelItems((yyvsp[-5].items));
+		free((yyvsp[-3].string));
+		delete (yyvsp[-1].options);
+	}
+#line 1557 "SqlParser.tab.c"
     break;
 
-  case 13:
-#line 87 "SqlParser.y"
-    {
-	        runSelect((yyvsp[(2) - (7)].integer), (yyvsp[(4) - (7)].string), *(yyvsp[(6) - (7)].conds));
-	  	free((yyvsp[(4) - (7)].string));
-	  	for (unsigned i = 0; i < (yyvsp[(6) - (7)].conds)->size(); i++) {
-		    free((*(yyvsp[(6) - (7)].conds))[i].value);
+  case 28: /* select_command: SELECT select_list FROM table WHERE conditions group_clause select_options LF  */
+#line 287 "SqlParser.y"
+                                                                                        {
+	        runSelect(*(yyvsp[-7].items), (yyvsp[-5].string), *(yyvsp[-3].conds), (yyvsp[-2].integer), *(yyvsp[-1].options));
+		freeSelItems((yyvsp[-7].items));
+	  	free((yyvsp[-5].string));
+	  	for (unsigned i = 0; i < (yyvsp[-3].conds)->size(); i++) {
+		    free((*(yyvsp[-3].conds))[i].value);
 		}
-	  	delete (yyvsp[(6) - (7)].conds);
-	;}
+	  	delete (yyvsp[-3].conds);
+		delete (yyvsp[-1].options);
+	}
+#line 1572 "SqlParser.tab.c"
     break;
 
-  case 14:
-#line 98 "SqlParser.y"
-    {
+  case 29: /* select_command: SELECT select_list FROM table COMMA table WHERE join_conditions select_options LF  */
+#line 297 "SqlParser.y"
+                                                                                            {
+	        runJoin(*(yyvsp[-8].items), (yyvsp[-6].string), (yyvsp[-4].string), *(yyvsp[-2].joins), *(yyvsp[-1].options));
+		freeSelItems((yyvsp[-8].items));
+		free((yyvsp[-6].string));
+		free((yyvsp[-4].string));
+		for (unsigned i = 0; i < (yyvsp[-2].joins)->size(); i++) {
+		    free((*(yyvsp[-2].joins))[i].table);
+		    free((*(yyvsp[-2].joins))[i].cond.value);
+		    free((*(yyvsp[-2].joins))[i].table2);
+		}
+		delete (yyvsp[-2].joins);
+		delete (yyvsp[-1].options);
+	}
+#line 1590 "SqlParser.tab.c"
+    break;
+
+  case 30: /* join_conditions: join_condition  */
+#line 313 "SqlParser.y"
+                       {
+	  (yyval.joins) = new std::vector<JoinCond>;
+	  (yyval.joins)->push_back(*(yyvsp[0].join));
+	  delete (yyvsp[0].join);
+	}
+#line 1600 "SqlParser.tab.c"
+    break;
+
+  case 31: /* join_conditions: join_conditions AND join_condition  */
+#line 318 "SqlParser.y"
+                                             {
+	  (yyvsp[-2].joins)->push_back(*(yyvsp[0].join));
+	  (yyval.joins) = (yyvsp[-2].joins);
+	  delete (yyvsp[0].join);
+	}
+#line 1610 "SqlParser.tab.c"
+    break;
+
+  case 32: /* join_condition: ID DOT attribute comparator value  */
+#line 326 "SqlParser.y"
+                                          {
+	  JoinCond* c = new JoinCond;
+	  c->table = (yyvsp[-4].string);
+	  c->cond.attr = (yyvsp[-2].integer);
+	  c->cond.comp = static_cast<SelCond::Comparator>((yyvsp[-1].integer));
+	  c->cond.value = (yyvsp[0].string);
+	  c->table2 = NULL;
+	  c->attr2 = 0;
+	  (yyval.join) = c;
+	}
+#line 1625 "SqlParser.tab.c"
+    break;
+
+  case 33: /* join_condition: ID DOT attribute EQUAL ID DOT attribute  */
+#line 336 "SqlParser.y"
+                                                  {
+	  JoinCond* c = new JoinCond;
+	  c->table = (yyvsp[-6].string);
+	  c->cond.attr = (yyvsp[-4].integer);
+	  c->cond.comp = SelCond::EQ;
+	  c->cond.value = NULL;
+	  c->table2 = (yyvsp[-2].string);
+	  c->attr2 = (yyvsp[0].integer);
+	  (yyval.join) = c;
+	}
+#line 1640 "SqlParser.tab.c"
+    break;
+
+  case 34: /* group_clause: %empty  */
+#line 349 "SqlParser.y"
+                    { (yyval.integer) = 0; }
+#line 1646 "SqlParser.tab.c"
+    break;
+
+  case 35: /* group_clause: GROUP BY attribute  */
+#line 350 "SqlParser.y"
+                             { (yyval.integer) = (yyvsp[0].integer); }
+#line 1652 "SqlParser.tab.c"
+    break;
+
+  case 36: /* select_options: limit_options  */
+#line 354 "SqlParser.y"
+                      { (yyval.options) = (yyvsp[0].options); }
+#line 1658 "SqlParser.tab.c"
+    break;
+
+  case 37: /* select_options: ORDER BY attribute direction limit_options  */
+#line 355 "SqlParser.y"
+                                                     {
+	  (yyvsp[0].options)->orderAttr = (yyvsp[-2].integer);
+	  (yyvsp[0].options)->descending = (yyvsp[-1].integer);
+	  (yyval.options) = (yyvsp[0].options);
+	}
+#line 1668 "SqlParser.tab.c"
+    break;
+
+  case 38: /* direction: %empty  */
+#line 363 "SqlParser.y"
+                    { (yyval.integer) = 0; }
+#line 1674 "SqlParser.tab.c"
+    break;
+
+  case 39: /* direction: ASC  */
+#line 364 "SqlParser.y"
+                    { (yyval.integer) = 0; }
+#line 1680 "SqlParser.tab.c"
+    break;
+
+  case 40: /* direction: DESC  */
+#line 365 "SqlParser.y"
+                    { (yyval.integer) = 1; }
+#line 1686 "SqlParser.tab.c"
+    break;
+
+  case 41: /* limit_options: %empty  */
+#line 369 "SqlParser.y"
+                    { (yyval.options) = newSelOptions(-1, 0); }
+#line 1692 "SqlParser.tab.c"
+    break;
+
+  case 42: /* limit_options: LIMIT row_count  */
+#line 370 "SqlParser.y"
+                          { (yyval.options) = newSelOptions((yyvsp[0].integer), 0); }
+#line 1698 "SqlParser.tab.c"
+    break;
+
+  case 43: /* limit_options: LIMIT row_count OFFSET row_count  */
+#line 371 "SqlParser.y"
+                                           { (yyval.options) = newSelOptions((yyvsp[-2].integer), (yyvsp[0].integer)); }
+#line 1704 "SqlParser.tab.c"
+    break;
+
+  case 44: /* row_count: INTEGER  */
+#line 375 "SqlParser.y"
+                {
+	  (yyval.integer) = atoi((yyvsp[0].string));
+	  if ((yyval.integer) < 0) {
+	    sqlerror("LIMIT and OFFSET must not be negative");
+	    (yyval.integer) = 0;
+	  }
+	  free((yyvsp[0].string));
+	}
+#line 1717 "SqlParser.tab.c"
+    break;
+
+  case 45: /* conditions: condition  */
+#line 386 "SqlParser.y"
+                  {
 	  std::vector<SelCond>* v = new std::vector<SelCond>;
-	  v->push_back(*(yyvsp[(1) - (1)].cond));
+	  v->push_back(*(yyvsp[0].cond));
 	  (yyval.conds) = v;
-          delete (yyvsp[(1) - (1)].cond);
-	;}
+          delete (yyvsp[0].cond);
+	}
+#line 1728 "SqlParser.tab.c"
     break;
 
-  case 15:
-#line 104 "SqlParser.y"
-    {
-	  (yyvsp[(1) - (3)].conds)->push_back(*(yyvsp[(3) - (3)].cond));
-	  (yyval.conds) = (yyvsp[(1) - (3)].conds);
-          delete (yyvsp[(3) - (3)].cond);
-	;}
+  case 46: /* conditions: conditions AND condition  */
+#line 392 "SqlParser.y"
+                                   {
+	  (yyvsp[-2].conds)->push_back(*(yyvsp[0].cond));
+	  (yyval.conds) = (yyvsp[-2].conds);
+          delete (yyvsp[0].cond);
+	}
+#line 1738 "SqlParser.tab.c"
     break;
 
-  case 16:
-#line 112 "SqlParser.y"
-    { 
+  case 47: /* condition: attribute comparator value  */
+#line 400 "SqlParser.y"
+                                   { 
 	  SelCond* c = new SelCond;
-	  c->attr = (yyvsp[(1) - (3)].integer);
-	  c->comp = static_cast<SelCond::Comparator>((yyvsp[(2) - (3)].integer));
-	  c->value = (yyvsp[(3) - (3)].string);
+	  c->attr = (yyvsp[-2].integer);
+	  c->comp = static_cast<SelCond::Comparator>((yyvsp[-1].integer));
+	  c->value = (yyvsp[0].string);
 	  (yyval.cond) = c;
-        ;}
+        }
+#line 1750 "SqlParser.tab.c"
     break;
 
-  case 17:
-#line 122 "SqlParser.y"
-    { (yyval.integer) = (yyvsp[(1) - (1)].integer); ;}
+  case 48: /* select_list: select_item  */
+#line 410 "SqlParser.y"
+                    {
+	  (yyval.items) = new std::vector<SelItem>;
+	  (yyval.items)->push_back(*(yyvsp[0].item));
+	  delete (yyvsp[0].item);
+	}
+#line 1760 "SqlParser.tab.c"
     break;
 
-  case 18:
-#line 123 "SqlParser.y"
-    { (yyval.integer) = 3; ;}
+  case 49: /* select_list: select_list COMMA select_item  */
+#line 415 "SqlParser.y"
+                                        {
+	  (yyvsp[-2].items)->push_back(*(yyvsp[0].item));
+	  (yyval.items) = (yyvsp[-2].items);
+	  delete (yyvsp[0].item);
+	}
+#line 1770 "SqlParser.tab.c"
     break;
 
-  case 19:
-#line 124 "SqlParser.y"
-    { (yyval.integer) = 4; ;}
+  case 50: /* select_item: attribute  */
+#line 423 "SqlParser.y"
+                  { (yyval.item) = newSelItem(SelItem::NONE, (yyvsp[0].integer)); }
+#line 1776 "SqlParser.tab.c"
     break;
 
-  case 20:
-#line 128 "SqlParser.y"
-    { 
-		if (strcasecmp((yyvsp[(1) - (1)].string), "key") == 0) (yyval.integer)=1;
-		else if (strcasecmp((yyvsp[(1) - (1)].string), "value") == 0) (yyval.integer)=2;
+  case 51: /* select_item: ID DOT attribute  */
+#line 424 "SqlParser.y"
+                           {
+	  (yyval.item) = newSelItem(SelItem::NONE, (yyvsp[0].integer));
+	  (yyval.item)->table = (yyvsp[-2].string);
+	}
+#line 1785 "SqlParser.tab.c"
+    break;
+
+  case 52: /* select_item: STAR  */
+#line 428 "SqlParser.y"
+                { (yyval.item) = newSelItem(SelItem::NONE, 3); }
+#line 1791 "SqlParser.tab.c"
+    break;
+
+  case 53: /* select_item: COUNT  */
+#line 429 "SqlParser.y"
+                { (yyval.item) = newSelItem(SelItem::COUNT, 0); }
+#line 1797 "SqlParser.tab.c"
+    break;
+
+  case 54: /* select_item: MIN LPAREN attribute RPAREN  */
+#line 430 "SqlParser.y"
+                                      { (yyval.item) = newSelItem(SelItem::MIN, (yyvsp[-1].integer)); }
+#line 1803 "SqlParser.tab.c"
+    break;
+
+  case 55: /* select_item: MAX LPAREN attribute RPAREN  */
+#line 431 "SqlParser.y"
+                                      { (yyval.item) = newSelItem(SelItem::MAX, (yyvsp[-1].integer)); }
+#line 1809 "SqlParser.tab.c"
+    break;
+
+  case 56: /* select_item: SUM LPAREN attribute RPAREN  */
+#line 432 "SqlParser.y"
+                                      { (yyval.item) = newSelItem(SelItem::SUM, (yyvsp[-1].integer)); }
+#line 1815 "SqlParser.tab.c"
+    break;
+
+  case 57: /* select_item: AVG LPAREN attribute RPAREN  */
+#line 433 "SqlParser.y"
+                                      { (yyval.item) = newSelItem(SelItem::AVG, (yyvsp[-1].integer)); }
+#line 1821 "SqlParser.tab.c"
+    break;
+
+  case 58: /* attribute: ID  */
+#line 437 "SqlParser.y"
+           { 
+		if (strcasecmp((yyvsp[0].string), "key") == 0) (yyval.integer)=1;
+		else if (strcasecmp((yyvsp[0].string), "value") == 0) (yyval.integer)=2;
 		else sqlerror("wrong attribute name. neither key or value");
-		free((yyvsp[(1) - (1)].string));
-	;}
+		free((yyvsp[0].string));
+	}
+#line 1832 "SqlParser.tab.c"
     break;
 
-  case 21:
-#line 136 "SqlParser.y"
-    { (yyval.string) = (yyvsp[(1) - (1)].string); ;}
+  case 59: /* value: INTEGER  */
+#line 445 "SqlParser.y"
+                 { (yyval.string) = (yyvsp[0].string); }
+#line 1838 "SqlParser.tab.c"
     break;
 
-  case 22:
-#line 137 "SqlParser.y"
-    { (yyval.string) = (yyvsp[(1) - (1)].string); ;}
+  case 60: /* value: STRING  */
+#line 446 "SqlParser.y"
+                 { (yyval.string) = (yyvsp[0].string); }
+#line 1844 "SqlParser.tab.c"
     break;
 
-  case 23:
-#line 141 "SqlParser.y"
-    { (yyval.string) = (yyvsp[(1) - (1)].string); ;}
+  case 61: /* table: ID  */
+#line 450 "SqlParser.y"
+           { (yyval.string) = (yyvsp[0].string); }
+#line 1850 "SqlParser.tab.c"
     break;
 
-  case 24:
-#line 145 "SqlParser.y"
-    { (yyval.integer) = SelCond::EQ; ;}
+  case 62: /* comparator: EQUAL  */
+#line 454 "SqlParser.y"
+                       { (yyval.integer) = SelCond::EQ; }
+#line 1856 "SqlParser.tab.c"
     break;
 
-  case 25:
-#line 146 "SqlParser.y"
-    { (yyval.integer) = SelCond::NE; ;}
+  case 63: /* comparator: NEQUAL  */
+#line 455 "SqlParser.y"
+                       { (yyval.integer) = SelCond::NE; }
+#line 1862 "SqlParser.tab.c"
     break;
 
-  case 26:
-#line 147 "SqlParser.y"
-    { (yyval.integer) = SelCond::LT; ;}
+  case 64: /* comparator: LESS  */
+#line 456 "SqlParser.y"
+                       { (yyval.integer) = SelCond::LT; }
+#line 1868 "SqlParser.tab.c"
     break;
 
-  case 27:
-#line 148 "SqlParser.y"
-    { (yyval.integer) = SelCond::GT; ;}
+  case 65: /* comparator: GREATER  */
+#line 457 "SqlParser.y"
+                       { (yyval.integer) = SelCond::GT; }
+#line 1874 "SqlParser.tab.c"
     break;
 
-  case 28:
-#line 149 "SqlParser.y"
-    { (yyval.integer) = SelCond::LE; ;}
+  case 66: /* comparator: LESSEQUAL  */
+#line 458 "SqlParser.y"
+                       { (yyval.integer) = SelCond::LE; }
+#line 1880 "SqlParser.tab.c"
     break;
 
-  case 29:
-#line 150 "SqlParser.y"
-    { (yyval.integer) = SelCond::GE; ;}
+  case 67: /* comparator: GREATEREQUAL  */
+#line 459 "SqlParser.y"
+                       { (yyval.integer) = SelCond::GE; }
+#line 1886 "SqlParser.tab.c"
     break;
 
 
-/* Line 1267 of yacc.c.  */
-#line 1591 "SqlParser.tab.c"
+#line 1890 "SqlParser.tab.c"
+
       default: break;
     }
-  YY_SYMBOL_PRINT ("-> $$ =", yyr1[yyn], &yyval, &yyloc);
+  /* User semantic actions sometimes alter yychar, and that requires
+     that yytoken be updated with the new translation.  We take the
+     approach of translating immediately before every use of yytoken.
+     One alternative is translating here after every semantic action,
+     but that translation would be missed if the semantic action invokes
+     YYABORT, YYACCEPT, or YYERROR immediately after altering yychar or
+     if it invokes YYBACKUP.  In the case of YYABORT or YYACCEPT, an
+     incorrect destructor might then be invoked immediately.  In the
+     case of YYERROR or YYBACKUP, subsequent parser actions might lead
+     to an incorrect destructor call or verbose syntax error message
+     before the lookahead is translated.  */
+  YY_SYMBOL_PRINT ("-> $$ =", YY_CAST (yysymbol_kind_t, yyr1[yyn]), &yyval, &yyloc);
 
   YYPOPSTACK (yylen);
   yylen = 0;
-  YY_STACK_PRINT (yyss, yyssp);
 
   *++yyvsp = yyval;
 
-
-  /* Now `shift' the result of the reduction.  Determine what state
+  /* Now 'shift' the result of the reduction.  Determine what state
      that goes to, based on the state we popped back to and the rule
      number reduced by.  */
-
-  yyn = yyr1[yyn];
-
-  yystate = yypgoto[yyn - YYNTOKENS] + *yyssp;
-  if (0 <= yystate && yystate <= YYLAST && yycheck[yystate] == *yyssp)
-    yystate = yytable[yystate];
-  else
-    yystate = yydefgoto[yyn - YYNTOKENS];
+  {
+    const int yylhs = yyr1[yyn] - YYNTOKENS;
+    const int yyi = yypgoto[yylhs] + *yyssp;
+    yystate = (0 <= yyi && yyi <= YYLAST && yycheck[yyi] == *yyssp
+               ? yytable[yyi]
+               : yydefgoto[yylhs]);
+  }
 
   goto yynewstate;
 
 
-/*------------------------------------.
-| yyerrlab -- here on detecting error |
-`------------------------------------*/
+/*--------------------------------------.
+| yyerrlab -- here on detecting error.  |
+`--------------------------------------*/
 yyerrlab:
+  /* Make sure we have latest lookahead translation.  See comments at
+     user semantic actions for why this is necessary.  */
+  yytoken = yychar == YYEMPTY ? YYSYMBOL_YYEMPTY : YYTRANSLATE (yychar);
   /* If not already recovering from an error, report this error.  */
   if (!yyerrstatus)
     {
       ++yynerrs;
-#if ! YYERROR_VERBOSE
       yyerror (YY_("syntax error"));
-#else
-      {
-	YYSIZE_T yysize = yysyntax_error (0, yystate, yychar);
-	if (yymsg_alloc < yysize && yymsg_alloc < YYSTACK_ALLOC_MAXIMUM)
-	  {
-	    YYSIZE_T yyalloc = 2 * yysize;
-	    if (! (yysize <= yyalloc && yyalloc <= YYSTACK_ALLOC_MAXIMUM))
-	      yyalloc = YYSTACK_ALLOC_MAXIMUM;
-	    if (yymsg != yymsgbuf)
-	      YYSTACK_FREE (yymsg);
-	    yymsg = (char *) YYSTACK_ALLOC (yyalloc);
-	    if (yymsg)
-	      yymsg_alloc = yyalloc;
-	    else
-	      {
-		yymsg = yymsgbuf;
-		yymsg_alloc = sizeof yymsgbuf;
-	      }
-	  }
-
-	if (0 < yysize && yysize <= yymsg_alloc)
-	  {
-	    (void) yysyntax_error (yymsg, yystate, yychar);
-	    yyerror (yymsg);
-	  }
-	else
-	  {
-	    yyerror (YY_("syntax error"));
-	    if (yysize != 0)
-	      goto yyexhaustedlab;
-	  }
-      }
-#endif
     }
 
-
-
   if (yyerrstatus == 3)
     {
-      /* If just tried and failed to reuse look-ahead token after an
-	 error, discard it.  */
+      /* If just tried and failed to reuse lookahead token after an
+         error, discard it.  */
 
       if (yychar <= YYEOF)
-	{
-	  /* Return failure if at end of input.  */
-	  if (yychar == YYEOF)
-	    YYABORT;
-	}
+        {
+          /* Return failure if at end of input.  */
+          if (yychar == YYEOF)
+            YYABORT;
+        }
       else
-	{
-	  yydestruct ("Error: discarding",
-		      yytoken, &yylval);
-	  yychar = YYEMPTY;
-	}
+        {
+          yydestruct ("Error: discarding",
+                      yytoken, &yylval);
+          yychar = YYEMPTY;
+        }
     }
 
-  /* Else will try to reuse look-ahead token after shifting the error
+  /* Else will try to reuse lookahead token after shifting the error
      token.  */
   goto yyerrlab1;
 
@@ -1689,14 +1964,13 @@ yyerrlab:
 | yyerrorlab -- error raised explicitly by YYERROR.  |
 `---------------------------------------------------*/
 yyerrorlab:
+  /* Pacify compilers when the user code never invokes YYERROR and the
+     label yyerrorlab therefore never appears in user code.  */
+  if (0)
+    YYERROR;
+  ++yynerrs;
 
-  /* Pacify compilers like GCC when the user code never invokes
-     YYERROR and the label yyerrorlab therefore never appears in user
-     code.  */
-  if (/*CONSTCOND*/ 0)
-     goto yyerrorlab;
-
-  /* Do not reclaim the symbols of the rule which action triggered
+  /* Do not reclaim the symbols of the rule whose action triggered
      this YYERROR.  */
   YYPOPSTACK (yylen);
   yylen = 0;
@@ -1709,42 +1983,42 @@ yyerrorlab:
 | yyerrlab1 -- common code for both syntax error and YYERROR.  |
 `-------------------------------------------------------------*/
 yyerrlab1:
-  yyerrstatus = 3;	/* Each real token shifted decrements this.  */
+  yyerrstatus = 3;      /* Each real token shifted decrements this.  */
 
+  /* Pop stack until we find a state that shifts the error token.  */
   for (;;)
     {
       yyn = yypact[yystate];
-      if (yyn != YYPACT_NINF)
-	{
-	  yyn += YYTERROR;
-	  if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYTERROR)
-	    {
-	      yyn = yytable[yyn];
-	      if (0 < yyn)
-		break;
-	    }
-	}
+      if (!yypact_value_is_default (yyn))
+        {
+          yyn += YYSYMBOL_YYerror;
+          if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYSYMBOL_YYerror)
+            {
+              yyn = yytable[yyn];
+              if (0 < yyn)
+                break;
+            }
+        }
 
       /* Pop the current state because it cannot handle the error token.  */
       if (yyssp == yyss)
-	YYABORT;
+        YYABORT;
 
 
       yydestruct ("Error: popping",
-		  yystos[yystate], yyvsp);
+                  YY_ACCESSING_SYMBOL (yystate), yyvsp);
       YYPOPSTACK (1);
       yystate = *yyssp;
       YY_STACK_PRINT (yyss, yyssp);
     }
 
-  if (yyn == YYFINAL)
-    YYACCEPT;
-
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
   *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 
 
   /* Shift the error token.  */
-  YY_SYMBOL_PRINT ("Shifting", yystos[yyn], yyvsp, yylsp);
+  YY_SYMBOL_PRINT ("Shifting", YY_ACCESSING_SYMBOL (yyn), yyvsp, yylsp);
 
   yystate = yyn;
   goto yynewstate;
@@ -1755,50 +2029,53 @@ yyerrlab1:
 `-------------------------------------*/
 yyacceptlab:
   yyresult = 0;
-  goto yyreturn;
+  goto yyreturnlab;
+
 
 /*-----------------------------------.
 | yyabortlab -- YYABORT comes here.  |
 `-----------------------------------*/
 yyabortlab:
   yyresult = 1;
-  goto yyreturn;
+  goto yyreturnlab;
 
-#ifndef yyoverflow
-/*-------------------------------------------------.
-| yyexhaustedlab -- memory exhaustion comes here.  |
-`-------------------------------------------------*/
+
+/*-----------------------------------------------------------.
+| yyexhaustedlab -- YYNOMEM (memory exhaustion) comes here.  |
+`-----------------------------------------------------------*/
 yyexhaustedlab:
   yyerror (YY_("memory exhausted"));
   yyresult = 2;
-  /* Fall through.  */
-#endif
+  goto yyreturnlab;
+
 
-yyreturn:
-  if (yychar != YYEOF && yychar != YYEMPTY)
-     yydestruct ("Cleanup: discarding lookahead",
-		 yytoken, &yylval);
-  /* Do not reclaim the symbols of the rule which action triggered
+/*----------------------------------------------------------.
+| yyreturnlab -- parsing is finished, clean up and return.  |
+`----------------------------------------------------------*/
+yyreturnlab:
+  if (yychar != YYEMPTY)
+    {
+      /* Make sure we have latest lookahead translation.  See comments at
+         user semantic actions for why this is necessary.  */
+      yytoken = YYTRANSLATE (yychar);
+      yydestruct ("Cleanup: discarding lookahead",
+                  yytoken, &yylval);
+    }
+  /* Do not reclaim the symbols of the rule whose action triggered
      this YYABORT or YYACCEPT.  */
   YYPOPSTACK (yylen);
   YY_STACK_PRINT (yyss, yyssp);
   while (yyssp != yyss)
     {
       yydestruct ("Cleanup: popping",
-		  yystos[*yyssp], yyvsp);
+                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp);
       YYPOPSTACK (1);
     }
 #ifndef yyoverflow
   if (yyss != yyssa)
     YYSTACK_FREE (yyss);
 #endif
-#if YYERROR_VERBOSE
-  if (yymsg != yymsgbuf)
-    YYSTACK_FREE (yymsg);
-#endif
-  /* Make sure YYID is used.  */
-  return YYID (yyresult);
-}
-
 
+  return yyresult;
+}
 
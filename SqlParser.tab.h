@@ -1,14 +1,14 @@
-/* A Bison parser, made by GNU Bison 2.3.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
-/* Skeleton interface for Bison's Yacc-like parsers in C
+/* Bison interface for Yacc-like parsers in C
 
-   Copyright (C) 1984, 1989, 1990, 2000, 2001, 2002, 2003, 2004, 2005, 2006
-   Free Software Foundation, Inc.
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
 
-   This program is free software; you can redistribute it and/or modify
+   This program is free software: you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
-   the Free Software Foundation; either version 2, or (at your option)
-   any later version.
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
 
    This program is distributed in the hope that it will be useful,
    but WITHOUT ANY WARRANTY; without even the implied warranty of
@@ -16,9 +16,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program; if not, write to the Free Software
-   Foundation, Inc., 51 Franklin Street, Fifth Floor,
-   Boston, MA 02110-1301, USA.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -33,79 +31,107 @@
    This special exception was added by the Free Software Foundation in
    version 2.2 of Bison.  */
 
-/* Tokens.  */
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
+#ifndef YY_SQL_SQLPARSER_TAB_H_INCLUDED
+# define YY_SQL_SQLPARSER_TAB_H_INCLUDED
+/* Debug traces.  */
+#ifndef YYDEBUG
+# define YYDEBUG 0
+#endif
+#if YYDEBUG
+extern int sqldebug;
+#endif
+
+/* Token kinds.  */
 #ifndef YYTOKENTYPE
 # define YYTOKENTYPE
-   /* Put the tokens into the symbol table, so that GDB and other debuggers
-      know about them.  */
-   enum yytokentype {
-     SELECT = 258,
-     FROM = 259,
-     WHERE = 260,
-     LOAD = 261,
-     WITH = 262,
-     INDEX = 263,
-     QUIT = 264,
-     COUNT = 265,
-     AND = 266,
-     OR = 267,
-     COMMA = 268,
-     STAR = 269,
-     LF = 270,
-     INTEGER = 271,
-     STRING = 272,
-     ID = 273,
-     EQUAL = 274,
-     NEQUAL = 275,
-     LESS = 276,
-     LESSEQUAL = 277,
-     GREATER = 278,
-     GREATEREQUAL = 279
-   };
+  enum yytokentype
+  {
+    YYEMPTY = -2,
+    YYEOF = 0,                     /* "end of file"  */
+    YYerror = 256,                 /* error  */
+    YYUNDEF = 257,                 /* "invalid token"  */
+    SELECT = 258,                  /* SELECT  */
+    FROM = 259,                    /* FROM  */
+    WHERE = 260,                   /* WHERE  */
+    LOAD = 261,                    /* LOAD  */
+    WITH = 262,                    /* WITH  */
+    INDEX = 263,                   /* INDEX  */
+    QUIT = 264,                    /* QUIT  */
+    COUNT = 265,                   /* COUNT  */
+    AND = 266,                     /* AND  */
+    OR = 267,                      /* OR  */
+    DICTIONARY = 268,              /* DICTIONARY  */
+    COMPRESSION = 269,             /* COMPRESSION  */
+    CREATE = 270,                  /* CREATE  */
+    ON = 271,                      /* ON  */
+    HASH = 272,                    /* HASH  */
+    CLUSTERED = 273,               /* CLUSTERED  */
+    ANALYZE = 274,                 /* ANALYZE  */
+    SET = 275,                     /* SET  */
+    OUTPUT = 276,                  /* OUTPUT  */
+    LIMIT = 277,                   /* LIMIT  */
+    OFFSET = 278,                  /* OFFSET  */
+    ORDER = 279,                   /* ORDER  */
+    BY = 280,                      /* BY  */
+    ASC = 281,                     /* ASC  */
+    DESC = 282,                    /* DESC  */
+    GROUP = 283,                   /* GROUP  */
+    MIN = 284,                     /* MIN  */
+    MAX = 285,                     /* MAX  */
+    SUM = 286,                     /* SUM  */
+    AVG = 287,                     /* AVG  */
+    COMMA = 288,                   /* COMMA  */
+    DOT = 289,                     /* DOT  */
+    STAR = 290,                    /* STAR  */
+    LPAREN = 291,                  /* LPAREN  */
+    RPAREN = 292,                  /* RPAREN  */
+    LF = 293,                      /* LF  */
+    INTEGER = 294,                 /* INTEGER  */
+    STRING = 295,                  /* STRING  */
+    ID = 296,                      /* ID  */
+    EQUAL = 297,                   /* EQUAL  */
+    NEQUAL = 298,                  /* NEQUAL  */
+    LESS = 299,                    /* LESS  */
+    LESSEQUAL = 300,               /* LESSEQUAL  */
+    GREATER = 301,                 /* GREATER  */
+    GREATEREQUAL = 302             /* GREATEREQUAL  */
+  };
+  typedef enum yytokentype yytoken_kind_t;
 #endif
-/* Tokens.  */
-#define SELECT 258
-#define FROM 259
-#define WHERE 260
-#define LOAD 261
-#define WITH 262
-#define INDEX 263
-#define QUIT 264
-#define COUNT 265
-#define AND 266
-#define OR 267
-#define COMMA 268
-#define STAR 269
-#define LF 270
-#define INTEGER 271
-#define STRING 272
-#define ID 273
-#define EQUAL 274
-#define NEQUAL 275
-#define LESS 276
-#define LESSEQUAL 277
-#define GREATER 278
-#define GREATEREQUAL 279
-
-
-
 
+/* Value type.  */
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
-typedef union YYSTYPE
-#line 33 "SqlParser.y"
+union YYSTYPE
 {
+#line 172 "SqlParser.y"
+
   int integer;
   char* string;
   SelCond* cond;
   std::vector<SelCond>* conds;
-}
-/* Line 1529 of yacc.c.  */
-#line 104 "SqlParser.tab.h"
-	YYSTYPE;
-# define yystype YYSTYPE /* obsolescent; will be withdrawn */
-# define YYSTYPE_IS_DECLARED 1
+  SelOptions* options;
+  SelItem* item;
+  std::vector<SelItem>* items;
+  JoinCond* join;
+  std::vector<JoinCond>* joins;
+
+#line 123 "SqlParser.tab.h"
+
+};
+typedef union YYSTYPE YYSTYPE;
 # define YYSTYPE_IS_TRIVIAL 1
+# define YYSTYPE_IS_DECLARED 1
 #endif
 
+
 extern YYSTYPE sqllval;
 
+
+int sqlparse (void);
+
+
+#endif /* !YY_SQL_SQLPARSER_TAB_H_INCLUDED  */
@@ -13,21 +13,160 @@ int  sqllex(void);
 void sqlerror(const char *str) { fprintf(stderr, "Error: %s\n", str); }
 extern "C" { int  sqlwrap() { return 1; } }
 
-static void runSelect(int attr, const char* table, const std::vector<SelCond>& conds)
-{
-  struct tms tmsbuf;
-  clock_t btime, etime;
-  int     bpagecnt, epagecnt;
+static struct tms tmsbuf;
+static clock_t    btime;
+static int        bpagecnt;
 
+static void startTimer()
+{
   btime = times(&tmsbuf);
   bpagecnt = PageFile::getPageReadCount();
-  SqlEngine::select(attr, table, conds);
-  etime = times(&tmsbuf);
-  epagecnt = PageFile::getPageReadCount();
+}
+
+static void reportTimer()
+{
+  clock_t etime = times(&tmsbuf);
+  int     epagecnt = PageFile::getPageReadCount();
 
   fprintf(stderr, "  -- %.3f seconds to run the select command. Read %d pages\n", ((float)(etime - btime))/sysconf(_SC_CLK_TCK), epagecnt - bpagecnt);
 }
 
+static void runSelect(const std::vector<SelItem>& items, const char* table,
+                      const std::vector<SelCond>& conds, int group, const SelOptions& options)
+{
+  for (unsigned i = 0; i < items.size(); i++) {
+    if (items[i].table != NULL && strcmp(items[i].table, table) != 0) {
+      fprintf(stderr, "Error: table %s is not in the FROM clause\n", items[i].table);
+      return;
+    }
+  }
+
+  // columns without an aggregate or GROUP BY are a plain SELECT, which
+  // returns a single column, or key and value as *
+  bool aggregates = (group != 0);
+  for (unsigned i = 0; i < items.size(); i++) {
+    if (items[i].func != SelItem::NONE) aggregates = true;
+  }
+  int attr = items[0].attr;
+  if (!aggregates && items.size() == 2 && items[0].attr == 1 && items[1].attr == 2) {
+    attr = 3;
+  } else if (!aggregates && items.size() > 1) {
+    sqlerror("the columns of a SELECT without aggregates must be a single column, *, or key, value");
+    return;
+  }
+
+  startTimer();
+  // count(*) without GROUP BY is a plain SELECT as well
+  if (!aggregates) {
+    SqlEngine::select(attr, table, conds, options);
+  } else if (group == 0 && items.size() == 1 && items[0].func == SelItem::COUNT) {
+    SqlEngine::select(4, table, conds, options);
+  } else {
+    SqlEngine::aggregate(items, table, conds, group, options);
+  }
+  reportTimer();
+}
+
+// the position of a table in the FROM clause of a join, or -1
+static int tableIndex(const char* name, const char* table1, const char* table2)
+{
+  if (name != NULL && strcmp(name, table1) == 0) return 0;
+  if (name != NULL && strcmp(name, table2) == 0) return 1;
+  return -1;
+}
+
+static void runJoin(const std::vector<SelItem>& items, const char* table1, const char* table2,
+                    const std::vector<JoinCond>& where, const SelOptions& options)
+{
+  std::vector<JoinColumn> columns;
+  std::vector<SelCond>    conds[2];
+  bool                    joined = false;
+
+  if (strcmp(table1, table2) == 0) {
+    sqlerror("a table cannot be joined with itself");
+    return;
+  }
+
+  // resolve the columns to the tables. the unqualified key is the key
+  // of both tables, and * is all columns of both.
+  for (unsigned i = 0; i < items.size(); i++) {
+    if (items[i].func == SelItem::COUNT && items.size() == 1) break;
+    if (items[i].func != SelItem::NONE) {
+      sqlerror("only columns and count(*) are supported in a join");
+      return;
+    }
+    if (items[i].attr == 3) {
+      for (int t = 0; t < 2; t++) {
+        JoinColumn key = { t, 1 }, value = { t, 2 };
+        columns.push_back(key);
+        columns.push_back(value);
+      }
+      continue;
+    }
+    JoinColumn c = { tableIndex(items[i].table, table1, table2), items[i].attr };
+    if (items[i].table == NULL && items[i].attr == 1) c.table = 0;
+    if (c.table < 0) {
+      sqlerror("a value in a join must be qualified by a table in the FROM clause");
+      return;
+    }
+    columns.push_back(c);
+  }
+
+  // the join condition pairs the keys. the others select from one table.
+  for (unsigned i = 0; i < where.size(); i++) {
+    int t = tableIndex(where[i].table, table1, table2);
+    if (where[i].table2 != NULL) {
+      int t2 = tableIndex(where[i].table2, table1, table2);
+      if (t < 0 || t2 < 0 || t == t2 || where[i].cond.attr != 1 || where[i].attr2 != 1) {
+        sqlerror("only the join condition table1.key = table2.key is supported");
+        return;
+      }
+      joined = true;
+      continue;
+    }
+    if (t < 0) {
+      fprintf(stderr, "Error: table %s is not in the FROM clause\n", where[i].table);
+      return;
+    }
+    conds[t].push_back(where[i].cond);
+  }
+  if (!joined) {
+    sqlerror("a join needs the condition table1.key = table2.key");
+    return;
+  }
+
+  startTimer();
+  SqlEngine::join(columns, table1, table2, conds[0], conds[1], options);
+  reportTimer();
+}
+
+static void freeSelItems(std::vector<SelItem>* items)
+{
+  for (unsigned i = 0; i < items->size(); i++) {
+    free((*items)[i].table);
+  }
+  delete items;
+}
+
+static SelItem* newSelItem(SelItem::Function func, int attr)
+{
+  SelItem* item = new SelItem;
+  item->func = func;
+  item->attr = attr;
+  item->table = NULL;
+  return item;
+}
+
+static SelOptions* newSelOptions(int limit, int offset)
+{
+  SelOptions* o = new SelOptions;
+  o->orderAttr = 0;
+  o->descending = false;
+  o->limit = limit;
+  o->offset = offset;
+  return o;
+}
+
 %}
 
 %union {
@@ -35,17 +174,31 @@ static void runSelect(int attr, const char* table, const std::vector<SelCond>& c
   char* string;
   SelCond* cond;
   std::vector<SelCond>* conds;
+  SelOptions* options;
+  SelItem* item;
+  std::vector<SelItem>* items;
+  JoinCond* join;
+  std::vector<JoinCond>* joins;
 }
 
 %token SELECT FROM WHERE LOAD WITH INDEX QUIT COUNT AND OR 
-%token COMMA STAR LF
+%token DICTIONARY COMPRESSION CREATE ON HASH CLUSTERED ANALYZE SET OUTPUT
+%token LIMIT OFFSET ORDER BY ASC DESC GROUP MIN MAX SUM AVG
+%token COMMA DOT STAR LPAREN RPAREN LF
 %token <string> INTEGER STRING ID
 %token EQUAL NEQUAL LESS LESSEQUAL GREATER GREATEREQUAL 
 
-%type <integer> attributes attribute comparator
+%type <integer> attribute comparator load_options load_option
 %type <string> table value
 %type <cond> condition
 %type <conds> conditions
+%type <options> select_options limit_options
+%type <integer> direction
+%type <integer> row_count group_clause
+%type <item> select_item
+%type <items> select_list
+%type <join> join_condition
+%type <joins> join_conditions
 %%
 
 commands:
@@ -56,6 +209,9 @@ commands:
 command:
         load_command { fprintf(stdout, "Bruinbase> "); }
 	| select_command { fprintf(stdout, "Bruinbase> "); }
+	| create_command { fprintf(stdout, "Bruinbase> "); }
+	| analyze_command { fprintf(stdout, "Bruinbase> "); }
+	| set_command { fprintf(stdout, "Bruinbase> "); }
 	| quit_command
 	| error LF { fprintf(stdout, "Bruinbase> "); }
 	| LF { fprintf(stdout, "Bruinbase> "); }
@@ -67,30 +223,162 @@ quit_command:
 
 load_command:
 	LOAD table FROM STRING LF { 
-	  SqlEngine::load(std::string($2), std::string($4), false); 
+	  SqlEngine::load(std::string($2), std::string($4), 0); 
 	  free($2);
 	  free($4);
 	}
-	| LOAD table FROM STRING WITH INDEX LF { 
-	  SqlEngine::load(std::string($2), std::string($4), true); 
+	| LOAD table FROM STRING WITH load_options LF { 
+	  SqlEngine::load(std::string($2), std::string($4), $6); 
 	  free($2);
 	  free($4);
 	}
 	;
 
+load_options:
+	load_option { $$ = $1; }
+	| load_options COMMA load_option { $$ = $1 | $3; }
+	;
+
+load_option:
+	INDEX        { $$ = SqlEngine::LOAD_INDEX; }
+	| INDEX ON attribute {
+	  $$ = ($3 == 2) ? SqlEngine::LOAD_VALUE_INDEX : SqlEngine::LOAD_INDEX;
+	}
+	| HASH INDEX { $$ = SqlEngine::LOAD_HASH_INDEX; }
+	| DICTIONARY { $$ = SqlEngine::LOAD_DICTIONARY; }
+	| COMPRESSION { $$ = SqlEngine::LOAD_COMPRESSION; }
+	| CLUSTERED  { $$ = SqlEngine::LOAD_CLUSTERED; }
+	;
+
+create_command:
+	CREATE INDEX ON table LPAREN attribute RPAREN LF {
+	  SqlEngine::createIndex(std::string($4), $6);
+	  free($4);
+	}
+	;
+
+analyze_command:
+	ANALYZE table LF {
+	  SqlEngine::analyze(std::string($2));
+	  free($2);
+	}
+	;
+
+set_command:
+	SET OUTPUT ID LF {
+	  SqlEngine::setOutputFormat(std::string($3));
+	  free($3);
+	}
+	| SET ID INTEGER LF {
+	  SqlEngine::setParameter(std::string($2), atoi($3));
+	  free($2);
+	  free($3);
+	}
+	;
+
 select_command:
-	SELECT attributes FROM table LF {
+	SELECT select_list FROM table group_clause select_options LF {
    	        std::vector<SelCond> conds;
-		runSelect($2, $4, conds);
+		runSelect(*$2, $4, conds, $5, *$6);
+		freeSelItems($2);
 		free($4);
+		delete $6;
 	}
-	| SELECT attributes FROM table WHERE conditions LF {
-	        runSelect($2, $4, *$6);
+	| SELECT select_list FROM table WHERE conditions group_clause select_options LF {
+	        runSelect(*$2, $4, *$6, $7, *$8);
+		freeSelItems($2);
 	  	free($4);
 	  	for (unsigned i = 0; i < $6->size(); i++) {
 		    free((*$6)[i].value);
 		}
 	  	delete $6;
+		delete $8;
+	}
+	| SELECT select_list FROM table COMMA table WHERE join_conditions select_options LF {
+	        runJoin(*$2, $4, $6, *$8, *$9);
+		freeSelItems($2);
+		free($4);
+		free($6);
+		for (unsigned i = 0; i < $8->size(); i++) {
+		    free((*$8)[i].table);
+		    free((*$8)[i].cond.value);
+		    free((*$8)[i].table2);
+		}
+		delete $8;
+		delete $9;
+	}
+	;
+
+join_conditions:
+	join_condition {
+	  $$ = new std::vector<JoinCond>;
+	  $$->push_back(*$1);
+	  delete $1;
+	}
+	| join_conditions AND join_condition {
+	  $1->push_back(*$3);
+	  $$ = $1;
+	  delete $3;
+	}
+	;
+
+join_condition:
+	ID DOT attribute comparator value {
+	  JoinCond* c = new JoinCond;
+	  c->table = $1;
+	  c->cond.attr = $3;
+	  c->cond.comp = static_cast<SelCond::Comparator>($4);
+	  c->cond.value = $5;
+	  c->table2 = NULL;
+	  c->attr2 = 0;
+	  $$ = c;
+	}
+	| ID DOT attribute EQUAL ID DOT attribute {
+	  JoinCond* c = new JoinCond;
+	  c->table = $1;
+	  c->cond.attr = $3;
+	  c->cond.comp = SelCond::EQ;
+	  c->cond.value = NULL;
+	  c->table2 = $5;
+	  c->attr2 = $7;
+	  $$ = c;
+	}
+	;
+
+group_clause:
+	/* empty */ { $$ = 0; }
+	| GROUP BY attribute { $$ = $3; }
+	;
+
+select_options:
+	limit_options { $$ = $1; }
+	| ORDER BY attribute direction limit_options {
+	  $5->orderAttr = $3;
+	  $5->descending = $4;
+	  $$ = $5;
+	}
+	;
+
+direction:
+	/* empty */ { $$ = 0; }
+	| ASC       { $$ = 0; }
+	| DESC      { $$ = 1; }
+	;
+
+limit_options:
+	/* empty */ { $$ = newSelOptions(-1, 0); }
+	| LIMIT row_count { $$ = newSelOptions($2, 0); }
+	| LIMIT row_count OFFSET row_count { $$ = newSelOptions($2, $4); }
+	;
+
+row_count:
+	INTEGER {
+	  $$ = atoi($1);
+	  if ($$ < 0) {
+	    sqlerror("LIMIT and OFFSET must not be negative");
+	    $$ = 0;
+	  }
+	  free($1);
 	}
 	;
 
@@ -118,10 +406,31 @@ condition:
         }
 	;
 
-attributes:
-	attribute { $$ = $1; }
-	| STAR  { $$ = 3; }
-	| COUNT { $$ = 4; }
+select_list:
+	select_item {
+	  $$ = new std::vector<SelItem>;
+	  $$->push_back(*$1);
+	  delete $1;
+	}
+	| select_list COMMA select_item {
+	  $1->push_back(*$3);
+	  $$ = $1;
+	  delete $3;
+	}
+	;
+
+select_item:
+	attribute { $$ = newSelItem(SelItem::NONE, $1); }
+	| ID DOT attribute {
+	  $$ = newSelItem(SelItem::NONE, $3);
+	  $$->table = $1;
+	}
+	| STAR  { $$ = newSelItem(SelItem::NONE, 3); }
+	| COUNT { $$ = newSelItem(SelItem::COUNT, 0); }
+	| MIN LPAREN attribute RPAREN { $$ = newSelItem(SelItem::MIN, $3); }
+	| MAX LPAREN attribute RPAREN { $$ = newSelItem(SelItem::MAX, $3); }
+	| SUM LPAREN attribute RPAREN { $$ = newSelItem(SelItem::SUM, $3); }
+	| AVG LPAREN attribute RPAREN { $$ = newSelItem(SelItem::AVG, $3); }
 	;
 
 attribute:
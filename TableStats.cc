@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include <cstring>
+#include <algorithm>
+#include "TableStats.h"
+#include "PageFile.h"
+
+using namespace std;
+
+// the layout of the statistics page
+struct StatsHeader {
+  int rowCount;
+  int pageCount;
+  int minKey;
+  int maxKey;
+  int boundCount;  // # histogram bounds that follow the header
+};
+
+// the layout of the value statistics page
+struct ValueStatsHeader {
+  int distinctValues;
+  int boundCount;  // # value bounds of VALUE_PREFIX + 1 bytes that follow
+};
+
+TableStats::TableStats()
+{
+  rowCount = 0;
+  pageCount = 0;
+  minKey = 0;
+  maxKey = 0;
+  distinctValues = 0;
+}
+
+RC TableStats::compute(const RecordFile& rf)
+{
+  RC             rc;
+  vector<int>    keys;
+  vector<string> values;
+  vector<int>    pkeys;
+  vector<string> pvalues;
+
+  // collect the keys and the values of all tuples, a page at a time
+  for (PageId pid = 0; pid < rf.endPid(); pid++) {
+    if ((rc = rf.readPage(pid, pkeys, pvalues)) < 0) return rc;
+    keys.insert(keys.end(), pkeys.begin(), pkeys.end());
+    values.insert(values.end(), pvalues.begin(), pvalues.end());
+  }
+  sort(keys.begin(), keys.end());
+  sort(values.begin(), values.end());
+
+  rowCount = keys.size();
+  pageCount = rf.endPid();
+  bounds.clear();
+  valueBounds.clear();
+  distinctValues = 0;
+  if (rowCount == 0) {
+    minKey = maxKey = 0;
+    return 0;
+  }
+  minKey = keys.front();
+  maxKey = keys.back();
+
+  // the buckets split the sorted keys into equal parts
+  int buckets = (rowCount < HISTOGRAM_BUCKETS) ? rowCount : HISTOGRAM_BUCKETS;
+  for (int i = 0; i < buckets; i++) {
+    bounds.push_back(keys[(long long) i * rowCount / buckets]);
+  }
+  bounds.push_back(maxKey);
+
+  // the values are summarized the same way, with the bounds cut to
+  // VALUE_PREFIX characters
+  distinctValues = 1;
+  for (int i = 1; i < rowCount; i++) {
+    if (values[i] != values[i - 1]) distinctValues++;
+  }
+  for (int i = 0; i < buckets; i++) {
+    valueBounds.push_back(values[(long long) i * rowCount / buckets].substr(0, VALUE_PREFIX));
+  }
+  valueBounds.push_back(values.back().substr(0, VALUE_PREFIX));
+
+  return 0;
+}
+
+RC TableStats::update(const RecordFile& rf, const RecordId& from)
+{
+  RC             rc;
+  vector<int>    keys;
+  vector<string> values;
+
+  // read only the pages of the tuples from "from" on
+  for (PageId pid = from.pid; pid < rf.endPid(); pid++) {
+    if ((rc = rf.readPage(pid, keys, values)) < 0) return rc;
+    for (unsigned i = (pid == from.pid) ? from.sid : 0; i < keys.size(); i++) {
+      int    key = keys[i];
+      string value = values[i].substr(0, VALUE_PREFIX);
+
+      // the first tuple of an empty table starts one bucket
+      if (rowCount++ == 0) {
+        minKey = maxKey = key;
+        bounds.assign(2, key);
+        valueBounds.assign(2, value);
+        distinctValues = 1;
+        continue;
+      }
+
+      // a tuple outside the histogram widens the first or the last bucket
+      minKey = min(minKey, key);
+      maxKey = max(maxKey, key);
+      if (!bounds.empty()) {
+        bounds.front() = min(bounds.front(), key);
+        bounds.back() = max(bounds.back(), key);
+      }
+      if (hasValueStats()) {
+        valueBounds.front() = min(valueBounds.front(), value);
+        valueBounds.back() = max(valueBounds.back(), value);
+      }
+    }
+  }
+  pageCount = rf.endPid();
+
+  return 0;
+}
+
+RC TableStats::load(const string& filename)
+{
+  PageFile    pf;
+  RC          rc;
+  char        page[PageFile::PAGE_SIZE];
+  StatsHeader header;
+
+  if ((rc = pf.open(filename, 'r')) < 0) return rc;
+  if ((rc = pf.read(0, page)) < 0) {
+    pf.close();
+    return rc;
+  }
+
+  // the bounds must fit in the page that was read
+  memcpy(&header, page, sizeof(header));
+  if (header.boundCount < 0 || header.boundCount > HISTOGRAM_BUCKETS + 1 ||
+      sizeof(header) + header.boundCount*sizeof(int) > PageFile::PAGE_SIZE) {
+    pf.close();
+    return RC_INVALID_FILE_FORMAT;
+  }
+  rowCount = header.rowCount;
+  pageCount = header.pageCount;
+  minKey = header.minKey;
+  maxKey = header.maxKey;
+  bounds.resize(header.boundCount);
+  if (header.boundCount > 0) {
+    memcpy(&bounds[0], page + sizeof(header), header.boundCount*sizeof(int));
+  }
+
+  // the statistics of an older ANALYZE have no value page
+  distinctValues = 0;
+  valueBounds.clear();
+  if (pf.endPid() < 2) {
+    pf.close();
+    return 0;
+  }
+  if ((rc = pf.read(1, page)) < 0) {
+    pf.close();
+    return rc;
+  }
+  pf.close();
+
+  ValueStatsHeader vheader;
+  memcpy(&vheader, page, sizeof(vheader));
+  if (vheader.boundCount < 0 || vheader.boundCount > HISTOGRAM_BUCKETS + 1) {
+    return RC_INVALID_FILE_FORMAT;
+  }
+  distinctValues = vheader.distinctValues;
+  for (int i = 0; i < vheader.boundCount; i++) {
+    const char* bound = page + sizeof(vheader) + i*(VALUE_PREFIX + 1);
+    valueBounds.push_back(string(bound, strnlen(bound, VALUE_PREFIX)));
+  }
+
+  return 0;
+}
+
+RC TableStats::save(const string& filename) const
+{
+  PageFile    pf;
+  RC          rc;
+  char        page[PageFile::PAGE_SIZE];
+  StatsHeader header;
+
+  header.rowCount = rowCount;
+  header.pageCount = pageCount;
+  header.minKey = minKey;
+  header.maxKey = maxKey;
+  header.boundCount = bounds.size();
+
+  memset(page, 0, PageFile::PAGE_SIZE);
+  memcpy(page, &header, sizeof(header));
+  if (!bounds.empty()) {
+    memcpy(page + sizeof(header), &bounds[0], bounds.size()*sizeof(int));
+  }
+
+  if ((rc = pf.open(filename, 'w')) < 0) return rc;
+  if ((rc = pf.write(0, page)) < 0) {
+    pf.close();
+    return rc;
+  }
+
+  ValueStatsHeader vheader;
+  vheader.distinctValues = distinctValues;
+  vheader.boundCount = valueBounds.size();
+  memset(page, 0, PageFile::PAGE_SIZE);
+  memcpy(page, &vheader, sizeof(vheader));
+  for (unsigned i = 0; i < valueBounds.size(); i++) {
+    memcpy(page + sizeof(vheader) + i*(VALUE_PREFIX + 1), valueBounds[i].c_str(),
+           valueBounds[i].size());
+  }
+  rc = pf.write(1, page);
+  pf.close();
+  return rc;
+}
+
+double TableStats::estimateRows(long long lo, long long hi) const
+{
+  if (lo > hi || bounds.size() < 2) return 0;
+
+  // add up the overlap with every bucket, assuming that the keys
+  // are spread evenly inside a bucket
+  int    buckets = bounds.size() - 1;
+  double rowsPerBucket = (double) rowCount / buckets;
+  double rows = 0;
+  for (int i = 0; i < buckets; i++) {
+    long long b0 = bounds[i];
+    long long b1 = bounds[i + 1];
+    long long from = max(lo, b0);
+    long long to = min(hi, b1);
+    if (from > to) continue;
+    rows += rowsPerBucket * (to - from + 1) / (b1 - b0 + 1);
+  }
+
+  return min(rows, (double) rowCount);
+}
+
+double TableStats::estimateValueRows(bool hasLo, const string& lo, bool loInclusive,
+                                     bool hasHi, const string& hi, bool hiInclusive) const
+{
+  if (!hasValueStats()) return rowCount;
+  if (hasLo && hasHi && (lo > hi || (lo == hi && !(loInclusive && hiInclusive)))) return 0;
+
+  // a single value is expected to be as frequent as any other
+  if (hasLo && hasHi && lo == hi) return (double) rowCount / max(distinctValues, 1);
+
+  // the values inside a bucket cannot be interpolated like the keys, so
+  // a bucket that the range covers only in part counts for half of it.
+  // the range is compared with the bounds by the prefix of its ends.
+  string p = lo.substr(0, VALUE_PREFIX);
+  string q = hi.substr(0, VALUE_PREFIX);
+  int    buckets = valueBounds.size() - 1;
+  double rowsPerBucket = (double) rowCount / buckets;
+  double rows = 0;
+  for (int i = 0; i < buckets; i++) {
+    const string& b0 = valueBounds[i];
+    const string& b1 = valueBounds[i + 1];
+    if ((hasLo && p > b1) || (hasHi && q < b0)) continue;
+    bool inside = (!hasLo || p < b0) && (!hasHi || b1 < q);
+    rows += inside ? rowsPerBucket : rowsPerBucket / 2;
+  }
+
+  return min(rows, (double) rowCount);
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef TABLESTATS_H
+#define TABLESTATS_H
+
+#include <string>
+#include <vector>
+#include "Bruinbase.h"
+#include "RecordFile.h"
+
+/**
+ * statistics of a table, gathered by ANALYZE and used to estimate
+ * the cost of the access paths of a SELECT.
+ *
+ * The keys are summarized by an equi-depth histogram: bounds[i] and
+ * bounds[i+1] are the smallest and the largest key of bucket i, and every
+ * bucket holds about the same number of tuples. The values are summarized
+ * the same way, by the first VALUE_PREFIX characters of their bounds, and
+ * by # distinct values. The key statistics are stored in the first page
+ * of the file "table.sta", and the value statistics in the second.
+ */
+class TableStats {
+ public:
+  static const int HISTOGRAM_BUCKETS = 64;  // # buckets in the histogram
+  static const int VALUE_PREFIX = 14;       // # characters of a value bound
+
+  TableStats();
+
+  /**
+   * gather the statistics of the tuples in the RecordFile.
+   * @param rf[IN] the table
+   * @return error code. 0 if no error
+   */
+  RC compute(const RecordFile& rf);
+
+  /**
+   * add the tuples appended to the RecordFile since the statistics were
+   * gathered. only the counts and the ends of the histograms change, so
+   * the estimates drift from the data until the next compute().
+   * @param rf[IN] the table
+   * @param from[IN] the first tuple not counted yet
+   * @return error code. 0 if no error
+   */
+  RC update(const RecordFile& rf, const RecordId& from);
+
+  /**
+   * read the statistics from a file.
+   * @param filename[IN] the statistics file of the table
+   * @return error code. RC_INVALID_FILE_FORMAT if the file is corrupt.
+   *         0 if no error
+   */
+  RC load(const std::string& filename);
+
+  /**
+   * write the statistics to a file.
+   * @param filename[IN] the statistics file of the table
+   * @return error code. 0 if no error
+   */
+  RC save(const std::string& filename) const;
+
+  /**
+   * estimate the number of tuples whose key is in [lo, hi].
+   * @param lo[IN] the smallest key in the range
+   * @param hi[IN] the largest key in the range
+   * @return the estimated number of tuples
+   */
+  double estimateRows(long long lo, long long hi) const;
+
+  /**
+   * estimate the number of tuples whose value is in a range.
+   * @param hasLo[IN] is the range bounded below?
+   * @param lo[IN] the lower bound of the range
+   * @param loInclusive[IN] is lo in the range?
+   * @param hasHi[IN] is the range bounded above?
+   * @param hi[IN] the upper bound of the range
+   * @param hiInclusive[IN] is hi in the range?
+   * @return the estimated number of tuples
+   */
+  double estimateValueRows(bool hasLo, const std::string& lo, bool loInclusive,
+                           bool hasHi, const std::string& hi, bool hiInclusive) const;
+
+  /**
+   * @return true if the statistics summarize the values. the statistics
+   *         of an older ANALYZE summarize only the keys.
+   */
+  bool hasValueStats() const { return valueBounds.size() >= 2; }
+
+  int getRowCount() const  { return rowCount; }
+  int getPageCount() const { return pageCount; }
+  int getMinKey() const    { return minKey; }
+  int getMaxKey() const    { return maxKey; }
+
+ private:
+  int rowCount;              // # tuples in the table
+  int pageCount;             // # pages in the table
+  int minKey;                // the smallest key
+  int maxKey;                // the largest key
+  std::vector<int> bounds;   // the bucket boundaries of the histogram
+  int distinctValues;        // # distinct values
+  std::vector<std::string> valueBounds;  // the bucket boundaries of the values
+};
+
+#endif // TABLESTATS_H
@@ -0,0 +1,461 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "ValueIndex.h"
+#include "ExternalSorter.h"
+
+using namespace std;
+
+// the header of a node page: PageId, # entries, prefix length
+static const int NODE_HEADER_SIZE = sizeof(PageId) + 2*sizeof(short);
+
+// the length of the longest common prefix of two strings
+static int commonPrefix(const string& a, const string& b);
+
+// the number of entries in a node page
+static int getEntryCount(const char* page);
+
+// compare key with the i'th key stored in the node page
+static int compareKey(const char* page, int i, const string& key);
+
+// the first entry of the node page whose key is >= key
+static int lowerBound(const char* page, const string& key);
+
+// the i'th key stored in the node page, and the pointer stored behind it
+static void readEntry(const char* page, int i, string& key, void* ptr, int ptrSize);
+
+// the size of a node holding keys[begin..end) with pointers of ptrSize bytes
+static int nodeSize(const vector<string>& keys, int begin, int end, int ptrSize);
+
+// write keys[begin..end) with their pointers into a node page
+static void writeNode(char* page, PageId first, const vector<string>& keys,
+                      const char* ptrs, int begin, int end, int ptrSize);
+
+// the (value, rid) pair of an entry as a string that sorts in the order of
+// the entries: the value, a zero byte and the rid in big-endian order
+static string encodeEntry(const string& value, const RecordId& rid);
+static void decodeEntry(const string& entry, string& value, RecordId& rid);
+
+// the leaves being packed by writeMerged()
+struct LeafPacker {
+  PageFile*        pf;
+  PageId           pid;       // the page of the leaf being filled
+  vector<string>   keys;      // the entries of the leaf being filled
+  vector<RecordId> rids;
+  vector<string>   seps;      // the separator in front of every leaf but the first
+  vector<PageId>   children;  // the PageId of the leaf behind every separator
+};
+
+// add an entry to the leaf being filled, writing the leaf when it is full
+static RC packEntry(LeafPacker& lp, const string& value, const RecordId& rid);
+
+// merge the entries of an index, if any, and the sorted entries into the
+// leaves of a new index file, and build its non-leaf levels
+static RC writeMerged(ValueIndex* old, ExternalSorter& sorter, PageFile& out,
+                      PageId& rootPid, int& treeHeight);
+
+
+ValueIndex::ValueIndex()
+{
+  mode = 'r';
+  rootPid = 1;
+  treeHeight = 1;
+}
+
+RC ValueIndex::open(const string& indexname, char mode)
+{
+  RC   rc;
+  char page[PageFile::PAGE_SIZE];
+
+  if ((rc = pf.open(indexname, mode)) < 0) return rc;
+  this->indexname = indexname;
+  this->mode = mode;
+
+  // the index is empty. initialize an empty leaf as the root.
+  if (pf.endPid() == 0) {
+    rootPid = 1;
+    treeHeight = 1;
+    vector<string> none;
+    writeNode(page, RC_END_OF_TREE, none, NULL, 0, 0, sizeof(RecordId));
+    return pf.write(rootPid, page);
+  }
+
+  // page 0 stores rootPid and treeHeight
+  if ((rc = pf.read(0, page)) < 0) {
+    pf.close();
+    return rc;
+  }
+  memcpy(&rootPid, page, sizeof(PageId));
+  memcpy(&treeHeight, page + sizeof(PageId), sizeof(int));
+
+  return 0;
+}
+
+RC ValueIndex::close()
+{
+  RC   rc;
+  char page[PageFile::PAGE_SIZE];
+
+  if (mode == 'w' || mode == 'W') {
+    memset(page, 0, PageFile::PAGE_SIZE);
+    memcpy(page, &rootPid, sizeof(PageId));
+    memcpy(page + sizeof(PageId), &treeHeight, sizeof(int));
+    if ((rc = pf.write(0, page)) < 0) return rc;
+  }
+
+  return pf.close();
+}
+
+RC ValueIndex::build(const RecordFile& rf, const string& sortPrefix, int sortMemory)
+{
+  RecordId first = { 0, 0 };
+  return merge(rf, first, sortPrefix, sortMemory);
+}
+
+RC ValueIndex::merge(const RecordFile& rf, const RecordId& from,
+                     const string& sortPrefix, int sortMemory)
+{
+  RC             rc;
+  ExternalSorter sorter(sortPrefix, 2, false, sortMemory);
+  vector<int>    keys;
+  vector<string> values;
+  RecordId       rid;
+
+  if (mode != 'w' && mode != 'W') return RC_INVALID_FILE_MODE;
+
+  // sort the (value, rid) pairs of the new records
+  for (rid.pid = from.pid; rid.pid < rf.endPid(); rid.pid++) {
+    if ((rc = rf.readPage(rid.pid, keys, values)) < 0) return rc;
+    rid.sid = (rid.pid == from.pid) ? from.sid : 0;
+    for (; rid.sid < (int) values.size(); rid.sid++) {
+      if ((rc = sorter.add(0, encodeEntry(values[rid.sid], rid))) < 0) return rc;
+    }
+  }
+  if ((rc = sorter.finish()) < 0) return rc;
+
+  // write the merged index to a new file, which replaces the index file
+  // only once it is complete
+  PageFile out;
+  string   newname = indexname + ".new";
+  remove(newname.c_str());
+  if ((rc = out.open(newname, 'w')) < 0) return rc;
+  bool hasOld = (from.pid > 0 || from.sid > 0);
+  rc = writeMerged(hasOld ? this : NULL, sorter, out, rootPid, treeHeight);
+  out.close();
+  if (rc < 0) {
+    remove(newname.c_str());
+    return rc;
+  }
+
+  pf.close();
+  if (rename(newname.c_str(), indexname.c_str()) < 0) return RC_FILE_WRITE_FAILED;
+  return open(indexname, mode);
+}
+
+RC ValueIndex::locate(const string& searchValue, IndexCursor& cursor)
+{
+  RC     rc;
+  char   page[PageFile::PAGE_SIZE];
+  string key;
+  PageId pid = rootPid;
+
+  // follow the child left of the first separator >= searchValue
+  for (int h = 1; h < treeHeight; h++) {
+    if ((rc = pf.read(pid, page)) < 0) return rc;
+    int eid = lowerBound(page, searchValue);
+    if (eid == 0) {
+      memcpy(&pid, page, sizeof(PageId));
+    } else {
+      readEntry(page, eid - 1, key, &pid, sizeof(PageId));
+    }
+  }
+
+  if ((rc = pf.read(pid, page)) < 0) return rc;
+  cursor.pid = pid;
+  cursor.eid = lowerBound(page, searchValue);
+
+  // the entry may be at the beginning of the next leaf
+  while (cursor.eid == getEntryCount(page)) {
+    memcpy(&pid, page, sizeof(PageId));
+    if (pid == RC_END_OF_TREE) return RC_NO_SUCH_RECORD;
+    if ((rc = pf.read(pid, page)) < 0) return rc;
+    cursor.pid = pid;
+    cursor.eid = 0;
+  }
+
+  return (compareKey(page, cursor.eid, searchValue) == 0) ? 0 : RC_NO_SUCH_RECORD;
+}
+
+RC ValueIndex::readForward(IndexCursor& cursor, string& value, RecordId& rid)
+{
+  RC   rc;
+  char page[PageFile::PAGE_SIZE];
+
+  if (cursor.pid == RC_END_OF_TREE) return RC_END_OF_TREE;
+  if ((rc = pf.read(cursor.pid, page)) < 0) return rc;
+
+  // skip to the next leaf at the end of a node
+  while (cursor.eid >= getEntryCount(page)) {
+    memcpy(&cursor.pid, page, sizeof(PageId));
+    cursor.eid = 0;
+    if (cursor.pid == RC_END_OF_TREE) return RC_END_OF_TREE;
+    if ((rc = pf.read(cursor.pid, page)) < 0) return rc;
+  }
+
+  readEntry(page, cursor.eid, value, &rid, sizeof(RecordId));
+  cursor.eid++;
+
+  return 0;
+}
+
+static int commonPrefix(const string& a, const string& b)
+{
+  int n = (a.size() < b.size()) ? a.size() : b.size();
+  int i = 0;
+  while (i < n && a[i] == b[i]) i++;
+  return i;
+}
+
+static int getEntryCount(const char* page)
+{
+  short count;
+  memcpy(&count, page + sizeof(PageId), sizeof(short));
+  return count;
+}
+
+// the prefix of a node page and its length
+static const char* getPrefix(const char* page, int& len)
+{
+  short plen;
+  memcpy(&plen, page + sizeof(PageId) + sizeof(short), sizeof(short));
+  len = plen;
+  return page + NODE_HEADER_SIZE;
+}
+
+// the i'th entry of a node page
+static const unsigned char* getEntry(const char* page, int i)
+{
+  int   plen;
+  short offset;
+  getPrefix(page, plen);
+  memcpy(&offset, page + NODE_HEADER_SIZE + plen + i*sizeof(short), sizeof(short));
+  return (const unsigned char*) page + offset;
+}
+
+static int compareKey(const char* page, int i, const string& key)
+{
+  int plen;
+  const char* prefix = getPrefix(page, plen);
+  const unsigned char* entry = getEntry(page, i);
+
+  // the stored key is (prefix + suffix)
+  int n = ((int) key.size() < plen) ? key.size() : plen;
+  int diff = memcmp(prefix, key.data(), n);
+  if (diff != 0) return diff;
+  if ((int) key.size() < plen) return 1;
+
+  int slen = entry[0];
+  int klen = key.size() - plen;
+  n = (klen < slen) ? klen : slen;
+  diff = memcmp(entry + 1, key.data() + plen, n);
+  if (diff != 0) return diff;
+  return slen - klen;
+}
+
+static int lowerBound(const char* page, const string& key)
+{
+  int lo = 0;
+  int hi = getEntryCount(page);
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (compareKey(page, mid, key) < 0) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+static void readEntry(const char* page, int i, string& key, void* ptr, int ptrSize)
+{
+  int plen;
+  const char* prefix = getPrefix(page, plen);
+  const unsigned char* entry = getEntry(page, i);
+
+  key.assign(prefix, plen);
+  key.append((const char*) entry + 1, entry[0]);
+  memcpy(ptr, entry + 1 + entry[0], ptrSize);
+}
+
+static int nodeSize(const vector<string>& keys, int begin, int end, int ptrSize)
+{
+  if (begin >= end) return NODE_HEADER_SIZE;
+
+  // the keys are sorted, so the first and the last share the common prefix
+  int plen = commonPrefix(keys[begin], keys[end - 1]);
+  int size = NODE_HEADER_SIZE + plen;
+  for (int i = begin; i < end; i++) {
+    size += sizeof(short) + 1 + (keys[i].size() - plen) + ptrSize;
+  }
+  return size;
+}
+
+static void writeNode(char* page, PageId first, const vector<string>& keys,
+                      const char* ptrs, int begin, int end, int ptrSize)
+{
+  short count = end - begin;
+  short plen = (count > 0) ? commonPrefix(keys[begin], keys[end - 1]) : 0;
+
+  memset(page, 0, PageFile::PAGE_SIZE);
+  memcpy(page, &first, sizeof(PageId));
+  memcpy(page + sizeof(PageId), &count, sizeof(short));
+  memcpy(page + sizeof(PageId) + sizeof(short), &plen, sizeof(short));
+  if (count > 0) memcpy(page + NODE_HEADER_SIZE, keys[begin].data(), plen);
+
+  // the offset array is followed by the entries
+  short offset = NODE_HEADER_SIZE + plen + count*sizeof(short);
+  for (int i = begin; i < end; i++) {
+    memcpy(page + NODE_HEADER_SIZE + plen + (i - begin)*sizeof(short), &offset, sizeof(short));
+
+    int slen = keys[i].size() - plen;
+    page[offset] = (char) slen;
+    memcpy(page + offset + 1, keys[i].data() + plen, slen);
+    memcpy(page + offset + 1 + slen, ptrs + i*ptrSize, ptrSize);
+    offset += 1 + slen + ptrSize;
+  }
+}
+
+static string encodeEntry(const string& value, const RecordId& rid)
+{
+  char suffix[7];
+  suffix[0] = 0;
+  for (int i = 0; i < 4; i++) suffix[1 + i] = (char) (rid.pid >> (24 - 8*i));
+  suffix[5] = (char) (rid.sid >> 8);
+  suffix[6] = (char) rid.sid;
+  return value + string(suffix, sizeof(suffix));
+}
+
+static void decodeEntry(const string& entry, string& value, RecordId& rid)
+{
+  const unsigned char* suffix = (const unsigned char*) entry.data() + entry.size() - 7;
+  value.assign(entry, 0, entry.size() - 7);
+  rid.pid = (suffix[1] << 24) | (suffix[2] << 16) | (suffix[3] << 8) | suffix[4];
+  rid.sid = (suffix[5] << 8) | suffix[6];
+}
+
+static RC packEntry(LeafPacker& lp, const string& value, const RecordId& rid)
+{
+  RC   rc;
+  char page[PageFile::PAGE_SIZE];
+
+  lp.keys.push_back(value);
+  lp.rids.push_back(rid);
+  int n = lp.keys.size();
+  if (nodeSize(lp.keys, 0, n, sizeof(RecordId)) <= PageFile::PAGE_SIZE) return 0;
+
+  // the leaf is full without the entry, which starts the next leaf
+  writeNode(page, lp.pid + 1, lp.keys, (const char*) lp.rids.data(), 0, n - 1, sizeof(RecordId));
+  if ((rc = lp.pf->write(lp.pid, page)) < 0) return rc;
+
+  // the shortest prefix of the next key that is greater than the last one
+  int len = commonPrefix(lp.keys[n - 2], lp.keys[n - 1]) + 1;
+  lp.seps.push_back(lp.keys[n - 1].substr(0, len));
+  lp.children.push_back(lp.pid + 1);
+
+  lp.pid++;
+  lp.keys.erase(lp.keys.begin(), lp.keys.end() - 1);
+  lp.rids.erase(lp.rids.begin(), lp.rids.end() - 1);
+  return 0;
+}
+
+static RC writeMerged(ValueIndex* old, ExternalSorter& sorter, PageFile& out,
+                      PageId& rootPid, int& treeHeight)
+{
+  RC          rc;
+  char        page[PageFile::PAGE_SIZE];
+  LeafPacker  lp;
+  IndexCursor cursor;
+  string      oldValue, newValue, entry;
+  RecordId    oldRid, newRid;
+  int         key;
+
+  lp.pf = &out;
+  lp.pid = 1;
+
+  // the entries of the index come before the new ones with the same
+  // value, as their records come first in the table
+  RC oldRc = RC_END_OF_TREE;
+  if (old != NULL) {
+    old->locate("", cursor);
+    oldRc = old->readForward(cursor, oldValue, oldRid);
+  }
+  RC newRc = sorter.next(key, entry);
+  if (newRc == 0) decodeEntry(entry, newValue, newRid);
+  while (oldRc == 0 || newRc == 0) {
+    if (oldRc == 0 && (newRc != 0 || oldValue <= newValue)) {
+      if ((rc = packEntry(lp, oldValue, oldRid)) < 0) return rc;
+      oldRc = old->readForward(cursor, oldValue, oldRid);
+    } else {
+      if ((rc = packEntry(lp, newValue, newRid)) < 0) return rc;
+      if ((newRc = sorter.next(key, entry)) == 0) decodeEntry(entry, newValue, newRid);
+    }
+  }
+  if (oldRc != RC_END_OF_TREE) return oldRc;
+  if (newRc != RC_END_OF_TREE) return newRc;
+
+  // the last leaf, which may be empty if the index is
+  writeNode(page, RC_END_OF_TREE, lp.keys, (const char*) lp.rids.data(), 0, lp.keys.size(), sizeof(RecordId));
+  if ((rc = out.write(lp.pid, page)) < 0) return rc;
+
+  rootPid = 1;
+  treeHeight = 1;
+
+  // build the non-leaf levels bottom up until a single node is left.
+  // the first child of a node goes to its header, and its separator
+  // moves up to the next level.
+  vector<string>& seps = lp.seps;
+  vector<PageId>& children = lp.children;
+  PageId pid = lp.pid + 1;
+  PageId first = 1;
+  while (!seps.empty()) {
+    vector<string> upSeps;
+    vector<PageId> upChildren;
+    PageId upFirst = pid;
+
+    int m = seps.size();
+    int begin = -1;
+    do {
+      // a node holds children[begin] in its header and the entries after it
+      int end = begin + 1;
+      while (end < m && nodeSize(seps, begin + 1, end + 1, sizeof(PageId)) <= PageFile::PAGE_SIZE) end++;
+
+      PageId left = (begin < 0) ? first : children[begin];
+      writeNode(page, left, seps, (const char*) children.data(), begin + 1, end, sizeof(PageId));
+      if ((rc = out.write(pid, page)) < 0) return rc;
+
+      if (end < m) {
+        upSeps.push_back(seps[end]);
+        upChildren.push_back(pid + 1);
+      }
+
+      begin = end;
+      pid++;
+    } while (begin < m);
+
+    seps.swap(upSeps);
+    children.swap(upChildren);
+    first = upFirst;
+    rootPid = upFirst;
+    treeHeight++;
+  }
+
+  // page 0 stores rootPid and treeHeight
+  memset(page, 0, PageFile::PAGE_SIZE);
+  memcpy(page, &rootPid, sizeof(PageId));
+  memcpy(page + sizeof(PageId), &treeHeight, sizeof(int));
+  return out.write(0, page);
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef VALUEINDEX_H
+#define VALUEINDEX_H
+
+#include <string>
+#include "Bruinbase.h"
+#include "PageFile.h"
+#include "RecordFile.h"
+#include "BTreeIndex.h"
+
+/**
+ * A B+tree index on the value column of a table.
+ *
+ * The keys are strings, so the entries in a node have variable length.
+ * Every node stores the longest prefix common to all of its keys once and
+ * keeps only the remaining suffixes in its entries. The separator keys of
+ * the non-leaf nodes are the shortest prefixes that tell the two child
+ * nodes apart. Both node kinds are laid out as
+ *   [PageId][# entries (short)][prefix length (short)][prefix]
+ *   [entry offsets (short) * # entries] ... [entries]
+ * where the PageId is the next leaf of a leaf node and the leftmost child
+ * of a non-leaf node. A leaf entry is [suffix length][suffix][RecordId] and
+ * a non-leaf entry is [suffix length][suffix][PageId of the child].
+ *
+ * The index is bulk-built from the table in value order, so the nodes are
+ * packed full and the leaves are stored sequentially. New records are
+ * added by merging their entries, sorted by an ExternalSorter, with the
+ * leaf chain into a new index file, which then replaces the old one.
+ */
+class ValueIndex {
+ public:
+  ValueIndex();
+
+  /**
+   * Open the index file in read or write mode.
+   * Under 'w' mode, the index file should be created if it does not exist.
+   * @param indexname[IN] the name of the index file
+   * @param mode[IN] 'r' for read, 'w' for write
+   * @return error code. 0 if no error
+   */
+  RC open(const std::string& indexname, char mode);
+
+  /**
+   * Close the index file. rootPid and treeHeight are written to page 0
+   * under 'w' mode.
+   * @return error code. 0 if no error
+   */
+  RC close();
+
+  /**
+   * Build the index over all records in the RecordFile,
+   * replacing the current content of the index.
+   * @param rf[IN] the table to index
+   * @param sortPrefix[IN] the prefix of the run files of the sort
+   * @param sortMemory[IN] # bytes the sort keeps in memory
+   * @return error code. 0 if no error
+   */
+  RC build(const RecordFile& rf, const std::string& sortPrefix, int sortMemory);
+
+  /**
+   * Add the records of the RecordFile from a RecordId on to the index,
+   * which holds the records before it. Only the new records are read
+   * and sorted. Their entries are merged with the leaf chain, in one
+   * pass, into a new index file that replaces the index file.
+   * @param rf[IN] the table to index
+   * @param from[IN] the first record that is not in the index
+   * @param sortPrefix[IN] the prefix of the run files of the sort
+   * @param sortMemory[IN] # bytes the sort keeps in memory
+   * @return error code. 0 if no error
+   */
+  RC merge(const RecordFile& rf, const RecordId& from,
+           const std::string& sortPrefix, int sortMemory);
+
+  /**
+   * Find the first index entry whose value is >= searchValue and set
+   * the cursor to it. Return 0 if the entry has searchValue and
+   * RC_NO_SUCH_RECORD otherwise.
+   * @param searchValue[IN] the value to find
+   * @param cursor[OUT] the cursor pointing to the index entry
+   * @return 0 if searchValue is found. Otherwise, an error code
+   */
+  RC locate(const std::string& searchValue, IndexCursor& cursor);
+
+  /**
+   * Read the (value, rid) pair at the location specified by the index
+   * cursor, and move forward the cursor to the next entry, following
+   * the leaf chain if needed.
+   * @param cursor[IN/OUT] the cursor pointing to a leaf-node index entry
+   * @param value[OUT] the value stored at the index cursor location
+   * @param rid[OUT] the RecordId stored at the index cursor location
+   * @return error code. RC_END_OF_TREE after the last entry. 0 if no error
+   */
+  RC readForward(IndexCursor& cursor, std::string& value, RecordId& rid);
+
+ private:
+  std::string indexname;  /// the name of the index file
+  PageFile pf;          /// the PageFile used to store the b+tree
+  char     mode;        /// the mode the file was opened in
+  PageId   rootPid;     /// the PageId of the root node
+  int      treeHeight;  /// the height of the tree. stored in page 0
+};
+
+#endif /* VALUEINDEX_H */
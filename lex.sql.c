@@ -379,8 +379,8 @@ static void yy_fatal_error (yyconst char msg[]  );
 	*yy_cp = '\0'; \
 	(yy_c_buf_p) = yy_cp;
 
-#define YY_NUM_RULES 26
-#define YY_END_OF_BUFFER 27
+#define YY_NUM_RULES 49
+#define YY_END_OF_BUFFER 50
 /* This struct is not used in this scanner,
    but its presence is necessary. */
 struct yy_trans_info
@@ -388,21 +388,39 @@ struct yy_trans_info
 	flex_int32_t yy_verify;
 	flex_int32_t yy_nxt;
 	};
-static yyconst flex_int16_t yy_accept[113] =
+static yyconst flex_int16_t yy_accept[289] =
     {   0,
-        0,    0,   27,   26,   25,   23,   26,   26,   22,   21,
-       26,   18,   24,   15,   12,   14,   20,   20,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,   25,   23,    0,
-       19,   18,   17,   13,   16,   20,   20,   20,   20,   20,
-       20,   20,   11,   20,   20,   20,   20,   20,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,   10,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,    8,    2,   20,
-        4,    7,   20,   20,    5,   20,   20,   20,   20,   20,
-
-        6,   20,    3,   20,   20,    0,    1,    0,    0,    0,
-        9,    0
+        0,    0,   50,   49,   48,   46,   49,   49,   44,   45,
+       43,   41,   49,   42,   38,   47,   35,   32,   34,   40,
+       40,   40,   40,   40,   40,   40,   40,   40,   40,   40,
+       40,   40,   40,   40,   40,   40,   40,   40,   40,   40,
+       40,   40,   40,   40,   40,   40,   40,   40,   40,   40,
+       48,   46,    0,   39,   38,   37,   33,   36,   40,   40,
+       40,   40,   19,   40,   40,   40,   40,   40,   40,   40,
+       40,   40,   40,   40,   40,   40,   40,   40,   10,   31,
+       40,   40,   40,   40,   40,   40,   40,   40,   40,   19,
+       40,   40,   40,   40,   40,   40,   40,   40,   40,   40,
+
+       40,   40,   40,   40,   40,   10,   31,   40,   40,   40,
+       40,   40,   40,   40,   30,   20,   26,   40,   40,   40,
+       40,   40,   40,   40,   40,   40,   40,   40,   40,   40,
+       24,   23,   40,   40,   40,   40,   40,   14,   25,   40,
+       40,   40,   30,   20,   26,   40,   40,   40,   40,   40,
+       40,   40,   40,   40,   40,   40,   40,   40,   24,   23,
+       40,   40,   40,   40,   40,   14,   25,   40,   40,   40,
+       40,   40,   40,   40,   21,   40,   28,    2,   40,   11,
+       40,   40,    4,   40,   40,   40,   27,   40,   40,    5,
+       40,   40,   40,   40,   40,   21,   40,   28,    2,   40,
+
+       11,   40,   40,    4,   40,   40,   40,   27,   40,   40,
+        5,   40,   40,   40,   40,   40,   40,   22,    6,   16,
+       40,   18,   40,   40,    3,   40,   40,   40,   40,   40,
+       40,   22,    6,   16,   40,   18,   40,   40,    3,   40,
+       40,   40,    0,    9,   40,   17,   15,    1,   40,   40,
+       40,    0,    9,   40,   17,   15,    1,   13,   40,   40,
+        0,   40,   13,   40,   40,    0,   40,   40,   40,   29,
+       40,   40,   40,   29,   40,   12,   40,   40,   12,   40,
+       40,   40,    7,   40,    7,    8,    8,    0
     } ;
 
 static yyconst flex_int32_t yy_ec[256] =
@@ -411,16 +429,16 @@ static yyconst flex_int32_t yy_ec[256] =
         1,    1,    4,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    2,    1,    1,    1,    1,    1,    1,    5,    6,
-        7,    8,    1,    9,   10,    1,    1,   11,   11,   11,
-       11,   11,   11,   11,   11,   11,   11,    1,   12,   13,
-       14,   15,    1,    1,   16,   17,   18,   19,   20,   21,
-       17,   22,   23,   17,   17,   24,   25,   26,   27,   17,
-       28,   29,   30,   31,   32,   17,   33,   34,   17,   17,
-        1,    1,    1,    1,   35,    1,   36,   17,   37,   38,
-
-       39,   40,   17,   41,   42,   17,   17,   43,   44,   45,
-       46,   17,   47,   48,   49,   50,   51,   17,   52,   53,
-       17,   17,    1,    1,    1,    1,    1,    1,    1,    1,
+        7,    8,    1,    9,   10,   11,    1,   12,   12,   12,
+       12,   12,   12,   12,   12,   12,   12,    1,   13,   14,
+       15,   16,    1,    1,   17,   18,   19,   20,   21,   22,
+       23,   24,   25,   26,   26,   27,   28,   29,   30,   31,
+       32,   33,   34,   35,   36,   37,   38,   39,   40,   41,
+        1,    1,    1,    1,   42,    1,   43,   44,   45,   46,
+
+       47,   48,   49,   50,   51,   26,   26,   52,   53,   54,
+       55,   56,   57,   58,   59,   60,   61,   62,   63,   64,
+       65,   66,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
@@ -437,100 +455,205 @@ static yyconst flex_int32_t yy_ec[256] =
         1,    1,    1,    1,    1
     } ;
 
-static yyconst flex_int32_t yy_meta[54] =
+static yyconst flex_int32_t yy_meta[67] =
     {   0,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    2,
-        2,    1,    1,    1,    1,    2,    2,    2,    2,    2,
-        2,    2,    2,    2,    2,    2,    2,    2,    2,    2,
-        2,    2,    2,    2,    2,    2,    2,    2,    2,    2,
-        2,    2,    2,    2,    2,    2,    2,    2,    2,    2,
-        2,    2,    2
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1
     } ;
 
-static yyconst flex_int16_t yy_base[115] =
+static yyconst flex_int16_t yy_base[289] =
     {   0,
-        0,    0,  144,  145,  141,  145,  139,  136,  145,  145,
-      129,  128,  145,   40,  145,  124,  111,    0,  109,  101,
-      105,  107,  105,  102,   98,  109,   34,   83,   81,   73,
-       77,   79,   77,   74,   70,   81,   17,  117,  145,  113,
-      145,  106,  145,  145,  145,    0,   97,   83,   91,   86,
-       93,   95,    0,   87,   85,   88,   76,   68,   54,   62,
-       57,   64,   65,   58,   56,   59,   47,    0,   70,   64,
-       69,   73,   73,   60,   70,   60,   66,   42,   36,   41,
-       45,   45,   32,   42,   32,   38,   47,    0,    0,   43,
-        0,    0,   58,   55,    0,   24,   20,   35,   32,   64,
-
-        0,   38,    0,   62,   17,   58,    0,   57,   57,   56,
-      145,  145,   59,   60
+        0,    0,   67,  443,   66,  443,   68,   71,  443,  443,
+      443,  443,   57,  443,    1,  443,  123,  443,   55,  130,
+      168,  171,  178,  104,  167,  108,  189,  180,  105,  185,
+      196,  190,  110,  195,  200,  173,  149,  181,  183,  153,
+      164,  170,  194,  184,  191,  197,  193,  182,  198,  199,
+        2,  443,    3,  443,    4,  443,  443,  443,    5,  235,
+      225,  230,    6,  220,  229,  237,  226,  242,  238,  232,
+      234,  233,  246,  240,  252,  231,  243,  249,    7,  253,
+      239,  250,  251,  248,  256,  244,  241,  236,  245,    8,
+      219,  247,  254,  223,  257,  255,  228,  258,  259,  261,
+
+      262,  260,  221,  263,  264,    9,  265,  266,  268,  269,
+      267,  275,  270,  271,   10,   11,   12,  276,  273,  280,
+      272,  274,  279,  281,  277,  287,  300,  278,  302,  305,
+       13,   14,  294,  310,  301,  298,  313,   15,   16,  303,
+      311,  285,   17,   18,   19,  282,  283,  284,  297,  299,
+      286,  288,  289,  227,  293,  304,  296,  306,   20,   21,
+      290,  307,  308,  295,  309,   22,   23,  292,  312,  317,
+      318,  325,  324,  326,   24,  320,   25,   26,  329,   27,
+      327,  328,   28,  344,  334,  332,   29,  350,  349,   30,
+      314,  315,  316,  321,  322,   31,  333,   32,   33,  330,
+
+       34,  319,  331,   35,  338,  335,  336,   36,  342,  341,
+       37,  337,  351,  352,  291,  355,  347,   38,   39,   40,
+      345,   41,  354,  357,   42,  224,  343,  348,  365,  353,
+      339,   43,   44,   45,  346,   46,  356,  358,   47,  375,
+      366,  364,  393,   48,  373,   49,   50,   51,  360,  359,
+      361,  395,   52,  367,   53,   54,   56,   58,  383,  371,
+      401,  392,   59,  363,  368,  404,  369,  394,  388,  443,
+      382,  376,  372,  443,  370,   60,  389,  384,   61,  374,
+      377,  396,   62,  378,   63,   64,   65,  443
     } ;
 
-static yyconst flex_int16_t yy_def[115] =
+static yyconst flex_int16_t yy_def[289] =
     {   0,
-      112,    1,  112,  112,  112,  112,  112,  113,  112,  112,
-      112,  112,  112,  112,  112,  112,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  112,  112,  113,
-      112,  112,  112,  112,  112,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-
-      114,  114,  114,  114,  114,  112,  114,  112,  112,  112,
-      112,    0,  112,  112
+      288,    1,  288,  288,  288,  288,  288,  288,  288,  288,
+      288,  288,  288,  288,   13,  288,  288,  288,  288,  288,
+       20,   21,   21,   21,   21,   25,   21,   21,   21,   29,
+       27,   25,   29,   29,   29,   29,   29,   29,   29,   29,
+       29,   29,   29,   29,   29,   29,   29,   29,   29,   29,
+        5,  288,    8,  288,   13,  288,  288,  288,   29,   27,
+       29,   29,   29,   29,   29,   29,   29,   29,   29,   29,
+       29,   29,   29,   29,   27,   24,   28,   29,   29,   29,
+       29,   29,   29,   29,   29,   29,   29,   29,   29,   29,
+       29,   29,   29,   29,   29,   29,   29,   29,   29,   29,
+
+       29,   29,   29,   29,   29,   29,   29,   29,   29,   29,
+       29,   29,   29,   29,   29,   29,   29,   29,   29,   28,
+       27,   29,   29,   29,   29,   29,   29,   29,   29,   29,
+       29,   29,   29,   29,   29,   29,   29,   29,   29,   25,
+       29,   29,   29,   29,   29,   29,   29,   29,   29,   29,
+       29,   29,   29,   29,   29,   29,   29,   29,   29,   29,
+       29,   29,   29,   29,   29,   29,   29,   29,   29,   21,
+       29,   25,   29,   29,   29,   29,   29,   29,   29,   29,
+       24,   29,   29,   29,   25,   29,   29,   29,   29,   29,
+       29,   29,   29,   29,   29,   29,   29,   29,   29,   29,
+
+       29,   29,   29,   29,   29,   29,   29,   29,   29,   29,
+       29,   29,   29,   29,   29,   29,   29,   29,   29,   29,
+       29,   29,   29,   29,   29,   29,   29,   29,   29,   29,
+       29,   29,   29,   29,   29,   29,   29,   29,   29,   29,
+       25,   29,  288,   29,   28,   29,   29,   29,   29,   29,
+       29,  288,   29,   29,   29,   29,   29,   29,   29,   29,
+      288,   27,   29,   29,   29,  288,   29,   29,   29,  288,
+       25,   29,   29,  288,   29,   29,   29,   21,   29,   29,
+       29,   28,   29,   29,   29,   29,   29,    0
     } ;
 
-static yyconst flex_int16_t yy_nxt[199] =
+static yyconst flex_int16_t yy_nxt[510] =
     {   0,
-        4,    5,    6,    7,    8,    4,    4,    9,   10,   11,
-       12,   13,   14,   15,   16,   17,   18,   19,   18,   20,
-       21,   18,   22,   23,   18,   18,   24,   25,   18,   26,
-       18,   18,   27,   18,    4,   28,   29,   18,   30,   31,
-       18,   32,   33,   18,   18,   34,   35,   18,   36,   18,
-       18,   37,   18,   43,   44,   56,   57,   66,   67,   40,
-       40,   46,  111,  111,  110,  109,  107,  108,  107,  106,
-      103,  105,  101,  104,  103,  102,  101,  100,   95,   99,
-       98,   92,   91,   97,   89,   88,   96,   95,   94,   93,
-       92,   91,   90,   89,   88,   87,   86,   85,   84,   83,
-
-       82,   81,   80,   79,   78,   68,   77,   76,   75,   74,
-       73,   72,   71,   70,   69,   68,   42,   41,   38,   65,
-       64,   53,   63,   62,   61,   60,   59,   58,   55,   54,
-       53,   52,   51,   50,   49,   48,   47,   45,   42,   42,
-       41,   39,   38,  112,    3,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112
-
+        4,    5,    6,    7,    8,    9,   10,   11,   12,   13,
+       14,   15,   16,   17,   18,   19,   20,   21,   22,   23,
+       24,   25,   26,   27,   28,   29,   30,   31,   29,   32,
+       29,   33,   29,   34,   29,   29,   29,   35,   29,   29,
+       29,    4,   36,   37,   38,   39,   40,   41,   42,   43,
+       44,   45,   46,   29,   47,   29,   48,   29,   49,   29,
+       29,   29,   50,   29,   29,   29,  288,   51,   55,   58,
+       52,   53,   53,   53,   53,   54,   53,   53,   53,   53,
+       53,   53,   53,   53,   53,   53,   53,   53,   53,   53,
+       53,   53,   53,   53,   53,   53,   53,   53,   53,   53,
+
+       53,   53,   53,   53,   53,   53,   53,   53,   53,   53,
+       53,   53,   53,   53,   53,   53,   53,   53,   53,   53,
+       53,   53,   53,   53,   53,   53,   53,   53,   53,   53,
+       53,   53,   53,   53,   53,   53,   53,   56,   57,   59,
+       71,   59,   69,   59,   59,   82,   59,   59,   59,   59,
+       59,   59,   59,   59,   59,   59,   59,   59,   60,   59,
+       59,   59,   59,   61,   59,   59,   62,   59,   59,   59,
+       59,   59,   59,   59,   59,   59,   59,   59,   59,   59,
+       59,   59,   59,   59,   59,   59,   59,   59,   59,   59,
+       59,   59,   59,   59,   59,   59,   59,   64,   67,   70,
+
+       65,   59,   68,   66,   59,   72,   59,   63,   73,   74,
+       59,   78,   76,   90,   75,   83,   96,   59,   79,   59,
+       77,   97,   80,   85,   86,   81,   87,   98,   59,   94,
+       84,   88,   91,   95,   89,   92,   99,  100,   93,  103,
+      105,  101,  109,  116,  110,  102,  106,  104,  112,  113,
+      107,  114,  117,  108,  115,  118,  119,  121,  111,  122,
+      123,  125,  124,  126,  120,  128,  127,  129,  130,  131,
+      133,  132,  134,  135,  136,  139,  140,  137,  141,  146,
+      144,  150,  153,  142,  159,  138,  143,  200,  174,  249,
+        0,    0,  175,  145,    0,    0,  243,  170,  181,  147,
+
+      149,  151,  158,  172,  178,  152,  156,  148,  173,  171,
+      162,  161,  154,  176,  157,  177,  160,  155,  164,  167,
+      165,  168,  179,  180,  183,  163,  182,  184,  166,  169,
+      185,  186,  187,  188,  190,  189,  191,  194,  193,  195,
+      192,  199,  201,  196,  217,  197,  203,  198,  205,  210,
+      202,  204,  213,  206,  208,  209,  212,  214,  215,  218,
+      216,  211,  220,  207,  221,  219,  222,  223,  224,  225,
+      252,  241,  242,  228,  227,  244,  245,  240,  226,  246,
+      229,  230,  233,  231,  235,  232,  238,  239,  247,  250,
+      234,  248,  236,  254,  251,  258,  237,  260,  259,  253,
+
+      261,  262,  266,  268,  269,  255,  263,  270,  271,  272,
+      274,  275,  277,  276,  278,  256,  264,  257,  282,  265,
+      267,  279,  280,  283,  286,    0,  273,  281,  284,    0,
+        0,  287,    0,    0,    0,    0,    0,    0,    0,    0,
+        0,  285,    3,  288,  288,  288,  288,  288,  288,  288,
+      288,  288,  288,  288,  288,  288,  288,  288,  288,  288,
+      288,  288,  288,  288,  288,  288,  288,  288,  288,  288,
+      288,  288,  288,  288,  288,  288,  288,  288,  288,  288,
+      288,  288,  288,  288,  288,  288,  288,  288,  288,  288,
+      288,  288,  288,  288,  288,  288,  288,  288,  288,  288,
+
+      288,  288,  288,  288,  288,  288,  288,  288,  288
     } ;
 
-static yyconst flex_int16_t yy_chk[199] =
+static yyconst flex_int16_t yy_chk[510] =
     {   0,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,   14,   14,   27,   27,   37,   37,  113,
-      113,  114,  110,  109,  108,  106,  105,  104,  102,  100,
-       99,   98,   97,   96,   94,   93,   90,   87,   86,   85,
-       84,   83,   82,   81,   80,   79,   78,   77,   76,   75,
-       74,   73,   72,   71,   70,   69,   67,   66,   65,   64,
-
-       63,   62,   61,   60,   59,   58,   57,   56,   55,   54,
-       52,   51,   50,   49,   48,   47,   42,   40,   38,   36,
-       35,   34,   33,   32,   31,   30,   29,   28,   26,   25,
-       24,   23,   22,   21,   20,   19,   17,   16,   12,   11,
-        8,    7,    5,    3,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112
-
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1,    3,    5,   13,   19,
+        7,    8,    8,    8,    8,    8,    8,    8,    8,    8,
+        8,    8,    8,    8,    8,    8,    8,    8,    8,    8,
+        8,    8,    8,    8,    8,    8,    8,    8,    8,    8,
+
+        8,    8,    8,    8,    8,    8,    8,    8,    8,    8,
+        8,    8,    8,    8,    8,    8,    8,    8,    8,    8,
+        8,    8,    8,    8,    8,    8,    8,    8,    8,    8,
+        8,    8,    8,    8,    8,    8,    8,   17,   17,   20,
+       26,   20,   24,   24,   29,   33,   20,   20,   20,   20,
+       20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
+       20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
+       20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
+       20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
+       20,   20,   20,   20,   20,   20,   21,   22,   23,   25,
+
+       22,   21,   23,   22,   21,   27,   25,   21,   28,   30,
+       22,   32,   31,   37,   30,   34,   40,   23,   32,   28,
+       31,   41,   32,   35,   35,   32,   36,   42,   27,   39,
+       34,   36,   38,   39,   36,   38,   43,   44,   38,   46,
+       47,   45,   48,   61,   49,   45,   47,   46,   50,   50,
+       47,   60,   62,   47,   60,   64,   65,   66,   49,   67,
+       68,   70,   69,   71,   65,   73,   72,   74,   75,   76,
+       78,   77,   80,   81,   82,   84,   85,   83,   86,   91,
+       88,   94,   97,   87,  103,   83,   87,  154,  121,  226,
+        0,    0,  122,   89,    0,    0,  215,  114,  128,   92,
+
+       93,   95,  102,  119,  125,   96,  100,   92,  120,  118,
+      107,  105,   98,  123,  101,  124,  104,   99,  109,  111,
+      110,  112,  126,  127,  130,  108,  129,  133,  110,  113,
+      134,  135,  136,  137,  141,  140,  142,  148,  147,  149,
+      146,  153,  155,  150,  176,  151,  157,  152,  161,  168,
+      156,  158,  171,  162,  164,  165,  170,  172,  173,  179,
+      174,  169,  182,  163,  184,  181,  185,  186,  188,  189,
+      229,  213,  214,  193,  192,  216,  217,  212,  191,  221,
+      194,  195,  202,  197,  205,  200,  209,  210,  223,  227,
+      203,  224,  206,  231,  228,  240,  207,  242,  241,  230,
+
+      243,  245,  252,  259,  260,  235,  249,  261,  262,  264,
+      266,  267,  269,  268,  271,  237,  250,  238,  277,  251,
+      254,  272,  273,  278,  282,    0,  265,  275,  280,    0,
+        0,  284,    0,    0,    0,    0,    0,    0,    0,    0,
+        0,  281,  288,  288,  288,  288,  288,  288,  288,  288,
+      288,  288,  288,  288,  288,  288,  288,  288,  288,  288,
+      288,  288,  288,  288,  288,  288,  288,  288,  288,  288,
+      288,  288,  288,  288,  288,  288,  288,  288,  288,  288,
+      288,  288,  288,  288,  288,  288,  288,  288,  288,  288,
+      288,  288,  288,  288,  288,  288,  288,  288,  288,  288,
+
+      288,  288,  288,  288,  288,  288,  288,  288,  288
     } ;
 
 static yy_state_type yy_last_accepting_state;
@@ -562,7 +685,7 @@ char* strlower(char* s)
         }
 	return s;
 }
-#line 566 "lex.sql.c"
+#line 689 "lex.sql.c"
 
 #define INITIAL 0
 
@@ -747,7 +870,7 @@ YY_DECL
 #line 17 "SqlParser.l"
 
 
-#line 751 "lex.sql.c"
+#line 874 "lex.sql.c"
 
 	if ( !(yy_init) )
 		{
@@ -800,13 +923,13 @@ yy_match:
 			while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 				{
 				yy_current_state = (int) yy_def[yy_current_state];
-				if ( yy_current_state >= 113 )
+				if ( yy_current_state >= 289 )
 					yy_c = yy_meta[(unsigned int) yy_c];
 				}
 			yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
 			++yy_cp;
 			}
-		while ( yy_base[yy_current_state] != 145 );
+		while ( yy_base[yy_current_state] != 443 );
 
 yy_find_action:
 		yy_act = yy_accept[yy_current_state];
@@ -863,106 +986,221 @@ return INDEX;
 case 7:
 YY_RULE_SETUP
 #line 25 "SqlParser.l"
-return QUIT;
+return DICTIONARY;
 	YY_BREAK
 case 8:
 YY_RULE_SETUP
 #line 26 "SqlParser.l"
-return QUIT;
+return COMPRESSION;
 	YY_BREAK
 case 9:
 YY_RULE_SETUP
 #line 27 "SqlParser.l"
-return COUNT;
+return CREATE;
 	YY_BREAK
 case 10:
 YY_RULE_SETUP
-#line 29 "SqlParser.l"
-return AND;
+#line 28 "SqlParser.l"
+return ON;
 	YY_BREAK
 case 11:
 YY_RULE_SETUP
-#line 30 "SqlParser.l"
-return OR;
+#line 29 "SqlParser.l"
+return HASH;
 	YY_BREAK
 case 12:
 YY_RULE_SETUP
-#line 31 "SqlParser.l"
-return EQUAL;
+#line 30 "SqlParser.l"
+return CLUSTERED;
 	YY_BREAK
 case 13:
 YY_RULE_SETUP
-#line 32 "SqlParser.l"
-return NEQUAL;
+#line 31 "SqlParser.l"
+return ANALYZE;
 	YY_BREAK
 case 14:
 YY_RULE_SETUP
-#line 33 "SqlParser.l"
-return GREATER;
+#line 32 "SqlParser.l"
+return SET;
 	YY_BREAK
 case 15:
 YY_RULE_SETUP
-#line 34 "SqlParser.l"
-return LESS;
+#line 33 "SqlParser.l"
+return OUTPUT;
 	YY_BREAK
 case 16:
 YY_RULE_SETUP
-#line 35 "SqlParser.l"
-return GREATEREQUAL;
+#line 34 "SqlParser.l"
+return LIMIT;
 	YY_BREAK
 case 17:
 YY_RULE_SETUP
-#line 36 "SqlParser.l"
-return LESSEQUAL;
+#line 35 "SqlParser.l"
+return OFFSET;
 	YY_BREAK
 case 18:
 YY_RULE_SETUP
-#line 38 "SqlParser.l"
-sqllval.string = strdup(sqltext); return INTEGER;
+#line 36 "SqlParser.l"
+return ORDER;
 	YY_BREAK
 case 19:
-/* rule 19 can match eol */
 YY_RULE_SETUP
-#line 39 "SqlParser.l"
-sqllval.string = strdup(sqltext+1); sqllval.string[sqlleng-2] = 0; return STRING;
+#line 37 "SqlParser.l"
+return BY;
 	YY_BREAK
 case 20:
 YY_RULE_SETUP
-#line 40 "SqlParser.l"
-sqllval.string = strlower(strdup(sqltext)); return ID;
+#line 38 "SqlParser.l"
+return ASC;
 	YY_BREAK
 case 21:
 YY_RULE_SETUP
-#line 41 "SqlParser.l"
-return COMMA;
+#line 39 "SqlParser.l"
+return DESC;
 	YY_BREAK
 case 22:
 YY_RULE_SETUP
-#line 42 "SqlParser.l"
-return STAR;
+#line 40 "SqlParser.l"
+return GROUP;
 	YY_BREAK
 case 23:
-/* rule 23 can match eol */
 YY_RULE_SETUP
-#line 43 "SqlParser.l"
-return LF;
+#line 41 "SqlParser.l"
+return MIN;
 	YY_BREAK
 case 24:
 YY_RULE_SETUP
-#line 44 "SqlParser.l"
-/* ignore semicolon */
+#line 42 "SqlParser.l"
+return MAX;
 	YY_BREAK
 case 25:
 YY_RULE_SETUP
-#line 45 "SqlParser.l"
-/* ignore white space */
+#line 43 "SqlParser.l"
+return SUM;
 	YY_BREAK
 case 26:
 YY_RULE_SETUP
+#line 44 "SqlParser.l"
+return AVG;
+	YY_BREAK
+case 27:
+YY_RULE_SETUP
+#line 45 "SqlParser.l"
+return QUIT;
+	YY_BREAK
+case 28:
+YY_RULE_SETUP
+#line 46 "SqlParser.l"
+return QUIT;
+	YY_BREAK
+case 29:
+YY_RULE_SETUP
 #line 47 "SqlParser.l"
+return COUNT;
+	YY_BREAK
+case 30:
+YY_RULE_SETUP
+#line 49 "SqlParser.l"
+return AND;
+	YY_BREAK
+case 31:
+YY_RULE_SETUP
+#line 50 "SqlParser.l"
+return OR;
+	YY_BREAK
+case 32:
+YY_RULE_SETUP
+#line 51 "SqlParser.l"
+return EQUAL;
+	YY_BREAK
+case 33:
+YY_RULE_SETUP
+#line 52 "SqlParser.l"
+return NEQUAL;
+	YY_BREAK
+case 34:
+YY_RULE_SETUP
+#line 53 "SqlParser.l"
+return GREATER;
+	YY_BREAK
+case 35:
+YY_RULE_SETUP
+#line 54 "SqlParser.l"
+return LESS;
+	YY_BREAK
+case 36:
+YY_RULE_SETUP
+#line 55 "SqlParser.l"
+return GREATEREQUAL;
+	YY_BREAK
+case 37:
+YY_RULE_SETUP
+#line 56 "SqlParser.l"
+return LESSEQUAL;
+	YY_BREAK
+case 38:
+YY_RULE_SETUP
+#line 58 "SqlParser.l"
+sqllval.string = strdup(sqltext); return INTEGER;
+	YY_BREAK
+case 39:
+/* rule 39 can match eol */
+YY_RULE_SETUP
+#line 59 "SqlParser.l"
+sqllval.string = strdup(sqltext+1); sqllval.string[sqlleng-2] = 0; return STRING;
+	YY_BREAK
+case 40:
+YY_RULE_SETUP
+#line 60 "SqlParser.l"
+sqllval.string = strlower(strdup(sqltext)); return ID;
+	YY_BREAK
+case 41:
+YY_RULE_SETUP
+#line 61 "SqlParser.l"
+return COMMA;
+	YY_BREAK
+case 42:
+YY_RULE_SETUP
+#line 62 "SqlParser.l"
+return DOT;
+	YY_BREAK
+case 43:
+YY_RULE_SETUP
+#line 63 "SqlParser.l"
+return STAR;
+	YY_BREAK
+case 44:
+YY_RULE_SETUP
+#line 64 "SqlParser.l"
+return LPAREN;
+	YY_BREAK
+case 45:
+YY_RULE_SETUP
+#line 65 "SqlParser.l"
+return RPAREN;
+	YY_BREAK
+case 46:
+/* rule 46 can match eol */
+YY_RULE_SETUP
+#line 66 "SqlParser.l"
+return LF;
+	YY_BREAK
+case 47:
+YY_RULE_SETUP
+#line 67 "SqlParser.l"
+/* ignore semicolon */
+	YY_BREAK
+case 48:
+YY_RULE_SETUP
+#line 68 "SqlParser.l"
+/* ignore white space */
+	YY_BREAK
+case 49:
+YY_RULE_SETUP
+#line 70 "SqlParser.l"
 ECHO;
 	YY_BREAK
-#line 966 "lex.sql.c"
+#line 1204 "lex.sql.c"
 case YY_STATE_EOF(INITIAL):
 	yyterminate();
 
@@ -1254,7 +1492,7 @@ static int yy_get_next_buffer (void)
 		while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 			{
 			yy_current_state = (int) yy_def[yy_current_state];
-			if ( yy_current_state >= 113 )
+			if ( yy_current_state >= 289 )
 				yy_c = yy_meta[(unsigned int) yy_c];
 			}
 		yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
@@ -1282,11 +1520,11 @@ static int yy_get_next_buffer (void)
 	while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 		{
 		yy_current_state = (int) yy_def[yy_current_state];
-		if ( yy_current_state >= 113 )
+		if ( yy_current_state >= 289 )
 			yy_c = yy_meta[(unsigned int) yy_c];
 		}
 	yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
-	yy_is_jam = (yy_current_state == 112);
+	yy_is_jam = (yy_current_state == 288);
 
 	return yy_is_jam ? 0 : yy_current_state;
 }
@@ -1959,7 +2197,5 @@ void sqlfree (void * ptr )
 
 #define YYTABLES_NAME "yytables"
 
-#line 47 "SqlParser.l"
-
-
+#line 70 "SqlParser.l"
 